@@ -0,0 +1,154 @@
+#include "forces.h"
+#include "pairwise.h"
+#include "scene.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Compares ways of computing exact gravity between every pair of bodies:
+ * one create_softened_gravity() force creator per pair, against one
+ * create_pairwise_gravity() group. Also times the group's kernel on its own,
+ * on one thread and on as many as it picks, and checks its forces against
+ * a plain double loop.
+ *
+ * Usage: all_pairs
+ */
+
+const double G = 1;
+const double SOFTENING = 1;
+const double SPREAD = 1000;
+const double POINT_SIZE = 0.5;
+const size_t SIZES[] = {100, 1000, 10000};
+const size_t NUM_SIZES = sizeof(SIZES) / sizeof(*SIZES);
+// A force creator per pair takes about 100 bytes, so 10k bodies would need 5 GB
+const size_t MAX_PAIRWISE_CREATORS = 1000;
+const double DT = 0.01;
+// Each measurement is repeated until it has taken at least this long in total
+const double MIN_BENCH_TIME = 0.5;
+
+/** Makes a tiny triangle, standing in for a point mass */
+body_t *make_point(vector_t position, double mass) {
+  list_t *shape = list_init(3, free);
+  vector_t corners[] = {{0, 1}, {-0.866, -0.5}, {0.866, -0.5}};
+  for (size_t i = 0; i < 3; i++) {
+    vector_t *corner = malloc(sizeof(*corner));
+    *corner = vec_add(position, vec_multiply(POINT_SIZE, corners[i]));
+    list_add(shape, corner);
+  }
+  return body_init(shape, mass, (rgb_color_t){1, 1, 1});
+}
+
+scene_t *make_scene(particles_t *particles, bool per_pair) {
+  scene_t *scene = scene_init();
+  list_t *group = list_init(particles->count, NULL);
+  for (size_t i = 0; i < particles->count; i++) {
+    body_t *body = make_point((vector_t){particles->x[i], particles->y[i]},
+                              particles->strength[i]);
+    scene_add_body(scene, body);
+    list_add(group, body);
+  }
+  if (per_pair) {
+    for (size_t i = 0; i < particles->count; i++) {
+      for (size_t j = i + 1; j < particles->count; j++) {
+        create_softened_gravity(scene, G, SOFTENING, list_get(group, i),
+                                list_get(group, j));
+      }
+    }
+  } else {
+    create_pairwise_gravity(scene, G, SOFTENING, group);
+  }
+  list_free(group);
+  return scene;
+}
+
+double seconds_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/** Returns the average time scene_tick() takes, in milliseconds */
+double time_ticks(scene_t *scene) {
+  size_t ticks = 0;
+  double start = seconds_now();
+  double elapsed;
+  do {
+    scene_tick(scene, DT);
+    ticks++;
+    elapsed = seconds_now() - start;
+  } while (elapsed < MIN_BENCH_TIME);
+  return elapsed / ticks * 1e3;
+}
+
+/** Returns the average time the kernel takes, in milliseconds */
+double time_kernel(particles_t *particles, size_t num_threads) {
+  size_t runs = 0;
+  double start = seconds_now();
+  double elapsed;
+  do {
+    particles_pairwise_forces(particles, G, SOFTENING, num_threads);
+    runs++;
+    elapsed = seconds_now() - start;
+  } while (elapsed < MIN_BENCH_TIME);
+  return elapsed / runs * 1e3;
+}
+
+/** The largest difference from a plain double loop, relative to the force */
+double kernel_error(particles_t *particles) {
+  particles_pairwise_forces(particles, G, SOFTENING, 0);
+  double max_error = 0;
+  for (size_t i = 0; i < particles->count; i++) {
+    double force_x = 0, force_y = 0;
+    for (size_t j = 0; j < particles->count; j++) {
+      double dx = particles->x[j] - particles->x[i];
+      double dy = particles->y[j] - particles->y[i];
+      double dist_squared = dx * dx + dy * dy + SOFTENING * SOFTENING;
+      double scale = G * particles->strength[i] * particles->strength[j] /
+                     (dist_squared * sqrt(dist_squared));
+      force_x += scale * dx;
+      force_y += scale * dy;
+    }
+    double error = hypot(particles->force_x[i] - force_x,
+                         particles->force_y[i] - force_y) /
+                   hypot(force_x, force_y);
+    if (error > max_error) {
+      max_error = error;
+    }
+  }
+  return max_error;
+}
+
+int main(void) {
+  srand(1);
+  printf("%8s %14s %14s %14s %14s %12s\n", "bodies", "pairs ms/tick",
+         "group ms/tick", "1 thread ms", "threads ms", "max error");
+  particles_t *particles = particles_init();
+  for (size_t i = 0; i < NUM_SIZES; i++) {
+    size_t count = SIZES[i];
+    particles_resize(particles, count);
+    for (size_t j = 0; j < count; j++) {
+      particles->x[j] = SPREAD * rand() / RAND_MAX;
+      particles->y[j] = SPREAD * rand() / RAND_MAX;
+      particles->strength[j] = 1 + (double)rand() / RAND_MAX;
+    }
+
+    printf("%8zu ", count);
+    if (count <= MAX_PAIRWISE_CREATORS) {
+      scene_t *scene = make_scene(particles, true);
+      printf("%14.3f ", time_ticks(scene));
+      scene_free(scene);
+    } else {
+      printf("%14s ", "-");
+    }
+    scene_t *scene = make_scene(particles, false);
+    printf("%14.3f ", time_ticks(scene));
+    scene_free(scene);
+    printf("%14.3f ", time_kernel(particles, 1));
+    printf("%14.3f ", time_kernel(particles, 0));
+    printf("%12.2e\n", kernel_error(particles));
+  }
+  particles_free(particles);
+  return 0;
+}
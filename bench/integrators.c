@@ -0,0 +1,128 @@
+#include "forces.h"
+#include "scene.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Compares the integrators in scene.h on a small softened-gravity system:
+ * a heavy star with light planets in circular orbits around it.
+ * For each integrator and time step, reports how much work one simulated
+ * second takes and how far the total energy drifts over the run.
+ * A good integrator keeps the drift small at large steps, which is what lets
+ * a simulation take fewer steps per second.
+ *
+ * Usage: integrators
+ */
+
+const double G = 1;
+const double SOFTENING = 5;
+const double STAR_MASS = 10000;
+const double PLANET_MASS = 1;
+const double ORBIT_RADII[] = {50, 80, 120, 200};
+const size_t NUM_PLANETS = sizeof(ORBIT_RADII) / sizeof(*ORBIT_RADII);
+const double BODY_SIZE = 2;
+// About 10 orbits of the innermost planet
+const double SIMULATED_TIME = 200;
+const double TIME_STEPS[] = {1.0, 0.5, 0.25, 0.1, 0.05};
+const size_t NUM_TIME_STEPS = sizeof(TIME_STEPS) / sizeof(*TIME_STEPS);
+
+const integrator_t INTEGRATORS[] = {
+    INTEGRATOR_AVERAGE_VELOCITY, INTEGRATOR_SEMI_IMPLICIT_EULER,
+    INTEGRATOR_LEAPFROG, INTEGRATOR_RK4};
+const char *INTEGRATOR_NAMES[] = {"average velocity", "semi-implicit Euler",
+                                  "leapfrog", "RK4"};
+const size_t FORCE_EVALUATIONS[] = {1, 1, 1, 4};
+const size_t NUM_INTEGRATORS = sizeof(INTEGRATORS) / sizeof(*INTEGRATORS);
+
+/** Makes a small square body centered at a point */
+body_t *make_body(double mass, vector_t center, vector_t velocity) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *corner = malloc(sizeof(*corner));
+    *corner = vec_add(center, vec_multiply(BODY_SIZE / 2, corners[i]));
+    list_add(shape, corner);
+  }
+  body_t *body = body_init(shape, mass, (rgb_color_t){0, 0, 0});
+  body_set_velocity(body, velocity);
+  return body;
+}
+
+scene_t *make_system(integrator_t integrator) {
+  scene_t *scene = scene_init();
+  scene_set_integrator(scene, integrator);
+  scene_add_body(scene, make_body(STAR_MASS, VEC_ZERO, VEC_ZERO));
+  for (size_t i = 0; i < NUM_PLANETS; i++) {
+    // Spread the planets around the star, each in a circular orbit
+    double angle = 2 * M_PI * i / NUM_PLANETS;
+    double radius = ORBIT_RADII[i];
+    double speed = sqrt(G * STAR_MASS / radius);
+    vector_t position = vec_rotate((vector_t){radius, 0}, angle);
+    vector_t velocity = vec_rotate((vector_t){0, speed}, angle);
+    scene_add_body(scene, make_body(PLANET_MASS, position, velocity));
+  }
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    for (size_t j = i + 1; j < scene_bodies(scene); j++) {
+      create_softened_gravity(scene, G, SOFTENING, scene_get_body(scene, i),
+                              scene_get_body(scene, j));
+    }
+  }
+  return scene;
+}
+
+/** Kinetic plus softened gravitational potential energy */
+double total_energy(scene_t *scene) {
+  double energy = 0;
+  size_t num_bodies = scene_bodies(scene);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = scene_get_body(scene, i);
+    vector_t velocity = body_get_velocity(body);
+    energy += 0.5 * body_get_mass(body) * vec_dot(velocity, velocity);
+    for (size_t j = i + 1; j < num_bodies; j++) {
+      body_t *other = scene_get_body(scene, j);
+      vector_t offset =
+          vec_subtract(body_get_centroid(other), body_get_centroid(body));
+      energy -= G * body_get_mass(body) * body_get_mass(other) /
+                sqrt(vec_dot(offset, offset) + SOFTENING * SOFTENING);
+    }
+  }
+  return energy;
+}
+
+double seconds_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int main(void) {
+  printf("%-20s %8s %12s %16s %14s\n", "integrator", "dt", "forces/sim s",
+         "wall us/sim s", "energy drift");
+  for (size_t i = 0; i < NUM_INTEGRATORS; i++) {
+    for (size_t j = 0; j < NUM_TIME_STEPS; j++) {
+      double dt = TIME_STEPS[j];
+      scene_t *scene = make_system(INTEGRATORS[i]);
+      double initial_energy = total_energy(scene);
+      double max_drift = 0;
+      double wall_time = 0;
+      size_t steps = (size_t)round(SIMULATED_TIME / dt);
+      for (size_t step = 0; step < steps; step++) {
+        double start = seconds_now();
+        scene_tick(scene, dt);
+        wall_time += seconds_now() - start;
+        double drift =
+            fabs((total_energy(scene) - initial_energy) / initial_energy);
+        if (drift > max_drift) {
+          max_drift = drift;
+        }
+      }
+      printf("%-20s %8.3f %12.0f %16.1f %14.3e\n", INTEGRATOR_NAMES[i], dt,
+             FORCE_EVALUATIONS[i] / dt, wall_time / SIMULATED_TIME * 1e6,
+             max_drift);
+      scene_free(scene);
+    }
+  }
+  return 0;
+}
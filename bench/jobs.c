@@ -0,0 +1,108 @@
+#include "job.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Measures the overhead of the job pool: starting and waiting for empty jobs,
+ * chains of dependent jobs, and job_parallel_for() at several grain sizes
+ * against a plain loop doing the same work.
+ *
+ * Usage: jobs
+ */
+
+const size_t NUM_EMPTY_JOBS = 10000;
+#define CHAIN_LENGTH 1000
+const size_t ARRAY_LENGTH = 1 << 20;
+const size_t GRAINS[] = {256, 4096, 65536};
+const size_t NUM_GRAINS = sizeof(GRAINS) / sizeof(*GRAINS);
+// Each measurement is repeated until it has taken at least this long in total
+const double MIN_BENCH_TIME = 0.5;
+
+double seconds_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void empty_job(void *aux) {}
+
+/** Runs NUM_EMPTY_JOBS empty jobs in one group */
+void run_empty_jobs(void *aux) {
+  job_group_t *group = job_group_init();
+  for (size_t i = 0; i < NUM_EMPTY_JOBS; i++) {
+    job_run(group, empty_job, NULL);
+  }
+  job_group_free(group);
+}
+
+/** Runs CHAIN_LENGTH empty jobs, each waiting for the one before */
+void run_chain(void *aux) {
+  job_group_t *groups[CHAIN_LENGTH];
+  groups[0] = job_group_init();
+  job_run(groups[0], empty_job, NULL);
+  for (size_t i = 1; i < CHAIN_LENGTH; i++) {
+    groups[i] = job_group_init();
+    job_run_after(groups[i], groups[i - 1], empty_job, NULL);
+  }
+  job_group_wait(groups[CHAIN_LENGTH - 1]);
+  for (size_t i = 0; i < CHAIN_LENGTH; i++) {
+    job_group_free(groups[i]);
+  }
+}
+
+/** A little arithmetic on each element, enough to be worth splitting */
+void transform_range(size_t start, size_t end, void *aux) {
+  double *values = aux;
+  for (size_t i = start; i < end; i++) {
+    values[i] = sqrt(values[i] * values[i] + 1);
+  }
+}
+
+double *grain_values;
+size_t grain;
+
+void run_parallel_for(void *aux) {
+  job_parallel_for(ARRAY_LENGTH, grain, transform_range, grain_values);
+}
+
+void run_serial_loop(void *aux) {
+  transform_range(0, ARRAY_LENGTH, grain_values);
+}
+
+/** Returns the average time func takes, in microseconds */
+double time_func(void (*func)(void *aux)) {
+  size_t runs = 0;
+  double start = seconds_now();
+  double elapsed;
+  do {
+    func(NULL);
+    runs++;
+    elapsed = seconds_now() - start;
+  } while (elapsed < MIN_BENCH_TIME);
+  return elapsed / runs * 1e6;
+}
+
+int main(void) {
+  printf("%zu threads\n", job_system_threads());
+  printf("%-28s %12.3f us/job\n", "empty jobs",
+         time_func(run_empty_jobs) / NUM_EMPTY_JOBS);
+  printf("%-28s %12.3f us/job\n", "chained jobs",
+         time_func(run_chain) / CHAIN_LENGTH);
+
+  grain_values = malloc(sizeof(double) * ARRAY_LENGTH);
+  for (size_t i = 0; i < ARRAY_LENGTH; i++) {
+    grain_values[i] = (double)rand() / RAND_MAX;
+  }
+  printf("%-28s %12.3f us\n", "serial loop", time_func(run_serial_loop));
+  for (size_t i = 0; i < NUM_GRAINS; i++) {
+    grain = GRAINS[i];
+    char label[64];
+    snprintf(label, sizeof(label), "parallel for, grain %zu", grain);
+    printf("%-28s %12.3f us\n", label, time_func(run_parallel_for));
+  }
+  free(grain_values);
+  job_system_shutdown();
+  return 0;
+}
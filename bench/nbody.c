@@ -0,0 +1,142 @@
+#include "forces.h"
+#include "quadtree.h"
+#include "scene.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Measures the cost of gravity between every pair of bodies in a group,
+ * from the 30 stars of the nbodies demo up to 100k point masses.
+ * For each size, reports the time per tick with create_nbody_gravity(),
+ * with one create_softened_gravity() per pair where that is feasible,
+ * and how far the Barnes-Hut field is from the exact sum.
+ *
+ * Usage: nbody
+ */
+
+const double G = 1;
+const double SOFTENING = 1;
+const double THETA = 0.5;
+const double DISK_RADIUS = 1000;
+const double POINT_SIZE = 0.5;
+const size_t SIZES[] = {30, 300, 3000, 30000, 100000};
+const size_t NUM_SIZES = sizeof(SIZES) / sizeof(*SIZES);
+// Larger groups would take minutes with a force creator per pair
+const size_t MAX_PAIRWISE = 3000;
+const size_t NUM_ERROR_SAMPLES = 100;
+const double DT = 0.01;
+// Ticks are repeated until they have taken at least this long in total
+const double MIN_BENCH_TIME = 0.5;
+
+/** Makes a tiny triangle, standing in for a point mass */
+body_t *make_point(vector_t position, double mass) {
+  list_t *shape = list_init(3, free);
+  vector_t corners[] = {{0, 1}, {-0.866, -0.5}, {0.866, -0.5}};
+  for (size_t i = 0; i < 3; i++) {
+    vector_t *corner = malloc(sizeof(*corner));
+    *corner = vec_add(position, vec_multiply(POINT_SIZE, corners[i]));
+    list_add(shape, corner);
+  }
+  return body_init(shape, mass, (rgb_color_t){1, 1, 1});
+}
+
+/** Places points uniformly at random in a disk */
+void random_points(vector_t *positions, double *masses, size_t num_points) {
+  for (size_t i = 0; i < num_points; i++) {
+    double radius = DISK_RADIUS * sqrt((double)rand() / RAND_MAX);
+    double angle = 2 * M_PI * rand() / RAND_MAX;
+    positions[i] = vec_rotate((vector_t){radius, 0}, angle);
+    masses[i] = 1 + (double)rand() / RAND_MAX;
+  }
+}
+
+scene_t *make_scene(vector_t *positions, double *masses, size_t num_points,
+                    bool pairwise) {
+  scene_t *scene = scene_init();
+  list_t *group = list_init(num_points, NULL);
+  for (size_t i = 0; i < num_points; i++) {
+    body_t *body = make_point(positions[i], masses[i]);
+    scene_add_body(scene, body);
+    list_add(group, body);
+  }
+  if (pairwise) {
+    for (size_t i = 0; i < num_points; i++) {
+      for (size_t j = i + 1; j < num_points; j++) {
+        create_softened_gravity(scene, G, SOFTENING, list_get(group, i),
+                                list_get(group, j));
+      }
+    }
+  } else {
+    create_nbody_gravity(scene, G, SOFTENING, THETA, group);
+  }
+  list_free(group);
+  return scene;
+}
+
+double seconds_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/** Returns the average time scene_tick() takes, in milliseconds */
+double time_ticks(scene_t *scene) {
+  size_t ticks = 0;
+  double start = seconds_now();
+  double elapsed;
+  do {
+    scene_tick(scene, DT);
+    ticks++;
+    elapsed = seconds_now() - start;
+  } while (elapsed < MIN_BENCH_TIME);
+  return elapsed / ticks * 1e3;
+}
+
+/** The average relative error of the Barnes-Hut field at some of the points */
+double field_error(vector_t *positions, double *masses, size_t num_points) {
+  quadtree_t *tree = quadtree_init();
+  quadtree_build(tree, positions, masses, num_points);
+  double total_error = 0;
+  size_t samples = num_points < NUM_ERROR_SAMPLES ? num_points
+                                                  : NUM_ERROR_SAMPLES;
+  for (size_t i = 0; i < samples; i++) {
+    vector_t position = positions[i * num_points / samples];
+    vector_t exact = quadtree_field(tree, position, 0, SOFTENING);
+    vector_t approximate = quadtree_field(tree, position, THETA, SOFTENING);
+    vector_t error = vec_subtract(approximate, exact);
+    total_error += sqrt(vec_dot(error, error) / vec_dot(exact, exact));
+  }
+  quadtree_free(tree);
+  return total_error / samples;
+}
+
+int main(void) {
+  srand(1);
+  printf("%8s %16s %16s %14s\n", "bodies", "group ms/tick", "pairs ms/tick",
+         "field error");
+  for (size_t i = 0; i < NUM_SIZES; i++) {
+    size_t num_points = SIZES[i];
+    vector_t *positions = malloc(sizeof(*positions) * num_points);
+    double *masses = malloc(sizeof(*masses) * num_points);
+    random_points(positions, masses, num_points);
+
+    scene_t *scene = make_scene(positions, masses, num_points, false);
+    double group_time = time_ticks(scene);
+    scene_free(scene);
+
+    printf("%8zu %16.3f ", num_points, group_time);
+    if (num_points <= MAX_PAIRWISE) {
+      scene = make_scene(positions, masses, num_points, true);
+      printf("%16.3f ", time_ticks(scene));
+      scene_free(scene);
+    } else {
+      printf("%16s ", "-");
+    }
+    printf("%14.2e\n", field_error(positions, masses, num_points));
+    free(positions);
+    free(masses);
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include "forces.h"
+#include "scene.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Drops a stack of boxes onto a static floor under gravity, for each number of
+ * contact solver passes and time step. Reports how much work one simulated
+ * second takes, how far the top box sinks below where it should rest, and how
+ * long the stack takes to fall asleep. A good solver holds the stack up with
+ * few passes at large steps.
+ *
+ * Usage: stack
+ */
+
+#define NUM_BOXES 8
+const double BOX_SIZE = 10;
+// Every other box is shifted sideways, so that edges do not line up exactly
+const double BOX_OFFSET = 0.5;
+const double BOX_MASS = 1;
+const double FLOOR_WIDTH = 200;
+const double GRAVITY = 500;
+const double ELASTICITY = 0.2;
+const double SIMULATED_TIME = 5;
+const size_t SOLVER_ITERATIONS[] = {1, 2, 4, 8, 16};
+const size_t NUM_SOLVER_ITERATIONS =
+    sizeof(SOLVER_ITERATIONS) / sizeof(*SOLVER_ITERATIONS);
+const double TIME_STEPS[] = {1.0 / 120, 1.0 / 60, 1.0 / 30};
+const size_t NUM_TIME_STEPS = sizeof(TIME_STEPS) / sizeof(*TIME_STEPS);
+
+/** Makes a box-shaped body centered at a point */
+body_t *make_box(vector_t center, double width, double height, double mass) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *corner = malloc(sizeof(*corner));
+    corner->x = center.x + width / 2 * corners[i].x;
+    corner->y = center.y + height / 2 * corners[i].y;
+    list_add(shape, corner);
+  }
+  return body_init(shape, mass, (rgb_color_t){0, 0, 0});
+}
+
+/** Makes a scene with the boxes stacked on a floor whose top is at y = 0 */
+scene_t *make_stack(size_t iterations, body_t *boxes[]) {
+  scene_t *scene = scene_init();
+  scene_set_sleeping(scene, true);
+  scene_set_solver_iterations(scene, iterations);
+  body_t *floor = make_box((vector_t){0, -BOX_SIZE / 2}, FLOOR_WIDTH,
+                           BOX_SIZE, INFINITY);
+  body_set_motion(floor, BODY_STATIC);
+  scene_add_body(scene, floor);
+  list_t *falling = list_init(NUM_BOXES, NULL);
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    vector_t center = {BOX_OFFSET * (i % 2), BOX_SIZE * (i + 0.5)};
+    boxes[i] = make_box(center, BOX_SIZE, BOX_SIZE, BOX_MASS);
+    scene_add_body(scene, boxes[i]);
+    list_add(falling, boxes[i]);
+    create_physics_collision(scene, ELASTICITY, boxes[i], floor);
+    for (size_t j = 0; j < i; j++) {
+      create_physics_collision(scene, ELASTICITY, boxes[j], boxes[i]);
+    }
+  }
+  create_uniform_gravity(scene, (vector_t){0, -GRAVITY}, falling, NULL, NULL);
+  list_free(falling);
+  return scene;
+}
+
+bool all_asleep(body_t *boxes[]) {
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    if (!body_is_asleep(boxes[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+double seconds_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int main(void) {
+  printf("%6s %8s %16s %10s %10s %10s\n", "passes", "dt", "wall us/sim s",
+         "final sag", "max sag", "asleep at");
+  // Where the top box's center rests if no box overlaps another
+  double resting_top = BOX_SIZE * (NUM_BOXES - 0.5);
+  for (size_t i = 0; i < NUM_SOLVER_ITERATIONS; i++) {
+    for (size_t j = 0; j < NUM_TIME_STEPS; j++) {
+      double dt = TIME_STEPS[j];
+      body_t *boxes[NUM_BOXES];
+      scene_t *scene = make_stack(SOLVER_ITERATIONS[i], boxes);
+      double wall_time = 0;
+      double max_sag = 0;
+      double asleep_at = -1;
+      size_t steps = (size_t)round(SIMULATED_TIME / dt);
+      for (size_t step = 0; step < steps; step++) {
+        double start = seconds_now();
+        scene_tick(scene, dt);
+        wall_time += seconds_now() - start;
+        double sag = resting_top - body_get_centroid(boxes[NUM_BOXES - 1]).y;
+        if (sag > max_sag) {
+          max_sag = sag;
+        }
+        if (asleep_at < 0 && all_asleep(boxes)) {
+          asleep_at = (step + 1) * dt;
+        }
+      }
+      double final_sag =
+          resting_top - body_get_centroid(boxes[NUM_BOXES - 1]).y;
+      printf("%6zu %8.4f %16.1f %10.3f %10.3f ", SOLVER_ITERATIONS[i], dt,
+             wall_time / SIMULATED_TIME * 1e6, final_sag, max_sag);
+      if (asleep_at < 0) {
+        printf("%10s\n", "never");
+      } else {
+        printf("%10.2f\n", asleep_at);
+      }
+      scene_free(scene);
+    }
+  }
+  return 0;
+}
@@ -89,6 +89,7 @@ void check_edge(scene_t *scene) {
 void emscripten_main(scene_t *scene) {
   check_edge(scene);
   sdl_render_scene(scene);
+  sdl_show();
   scene_tick(scene, time_since_last_tick());
 }
 
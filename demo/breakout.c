@@ -369,7 +369,7 @@ void add_collisions(scene_t *scene) {
 
 // Emscripten init to create screen and generate everything for the first time
 scene_t *emscripten_init(void) {
-  srand(time(NULL));
+  srand(sdl_random_seed());
   // Initialize scene
   sdl_init(VEC_ZERO, MAX);
   scene_t *scene = scene_init();
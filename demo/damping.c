@@ -127,6 +127,7 @@ void emscripten_main(scene_t *scene) {
 
   assert(scene != NULL);
   sdl_render_scene(scene);
+  sdl_show();
   scene_tick(scene, time_since_last_tick());
 }
 
@@ -2,7 +2,9 @@
 #include "polygon.h"
 #include "scene.h"
 #include "list.h"
+#include "water.h"
 
+#include "assets.h"
 #include "sdl_wrapper.h"
 #include <assert.h>
 #include <math.h>
@@ -31,7 +33,7 @@ const vector_t ZERO_VEC = {0, 0};
 #define M 6E24              // kg
 #define g 9.8               // m / s^2
 #define R (sqrt(G * M / g))/7.9 // m
-#define P 2.8E8      // buoyancy force
+#define WATER_DENSITY 0.013 // kg / pixel^2, so the duck floats
 
 #define CIRCLE_POINTS 5
 
@@ -42,7 +44,7 @@ const double WIN_TIME_THRESHOLD = 60; // idk man
 double time_until_next_obs;
 
 // Duck constants
-const size_t DUCK_INDEX = 1;
+const size_t DUCK_INDEX = 2;
 const vector_t DUCK_JUMP_VEL = {0, 500};
 const vector_t DUCK_DIVE_VEL = {0, -500};
 const vector_t DUCK_NORMAL_VEL = {300, 0};
@@ -58,7 +60,6 @@ const vector_t DUCK_MOVE_VEL = {10,0};
 const vector_t OBSTACLE_VEL = {-100, 0};
 const double OBSTACLE_MASS = INFINITY;
 const double OBSTACLE_DISAPPEAR_BOUND = -70;
-const size_t OBS_ID = 7;
 
 const double ICEBERG_W = 90;
 const double ICEBERG_H = 140;
@@ -76,12 +77,18 @@ const vector_t SHIP_STARTING_VEC = {1000 + 100, 250};
 const rgb_color_t SHIP_COLOR = (rgb_color_t){.506, 0.6375, 0.369};
 
 //Ocean Definitions
+const size_t OCEAN_INDEX = 1;
 const double OCEAN_WIDTH = 1000;
-const double OCEAN_HEIGHT = 250;
+const double OCEAN_HEIGHT = 250; // the surface's rest level
 const double OCEAN_MASS = INFINITY;
 const rgb_color_t OCEAN_COLOR = (rgb_color_t){0, 0.41, .578};
+const size_t OCEAN_COLUMNS = 200;
+const double OCEAN_WAVE_SPEED = 250;
+const double OCEAN_DAMPING = 1.5;
 
 //Wall Definitions
+// add_walls() adds this many walls, right after the duck
+const size_t NUM_WALLS = 4;
 #define WALL_ANGLE atan2(ROW_SPACING, COL_SPACING / 2)
 #define WALL_LENGTH hypot(MAX.x / 2, MAX.y)
 #define WALL_WIDTH 1.0
@@ -121,7 +128,6 @@ const double HARD_BUTTON_MASS = INFINITY;
 const rgb_color_t HARD_BUTTON_COLOR = (rgb_color_t){1, .83, .36};
 
 // Wall constants
-const size_t EARTH_INDEX = 6;
 const double BOTTOM_WALL_MASS = 100000000;
 
 
@@ -151,6 +157,14 @@ const SDL_Texture *score_texture;
 const vector_t SCORE_POSITION = {20, 500};
 const vector_t SCORE_SIZE_VECTOR = {100, 50};
 
+// Longest time to sleep on a static screen before checking for input again
+const uint32_t IDLE_WAIT_MS = 100;
+
+// Every asset the game uses, loaded in the background at startup
+const char ASSET_MANIFEST[] = "assets/manifest.txt";
+// The same assets, pre-decoded by tools/pack_assets ('make pack')
+const char ASSET_PACK[] = "assets/assets.pack";
+
 // Generates a random number between 0 and 1
 double rand_double(void) { return (double)rand() / RAND_MAX; }
 
@@ -220,7 +234,10 @@ typedef struct state {
   double num_sec_buffer;
   bool buoyancy_acting;
   bool gravity_acting;
+  size_t buoyancy_force; // ids of the forces on the duck, which are only
+  size_t gravity_force;  // enabled while the matching flag is set
   double scrolling_screen_speed;
+  water_t *water; // the ocean's surface
 
 } state_t;
 
@@ -246,12 +263,19 @@ void set_cur_scene(state_t *state, scene_type_t type) {
 // Functions to get/set duck positions (y coordinate)
 duck_pos_t get_duck_pos(state_t *state) { return state->duck_pos; }
 
+// Height of the ocean's surface under the duck
+double surface_under_duck(state_t *state) {
+  body_t *duck = scene_get_body(state->scene, DUCK_INDEX);
+  return water_get_height(state->water, body_get_centroid(duck).x);
+}
+
 void set_duck_pos(state_t *state, double duck_y) {
   state->exact_duck_pos = duck_y;
-  if(duck_y > OCEAN_HEIGHT){
+  double surface = surface_under_duck(state);
+  if(duck_y > surface){
     state->duck_pos = ABOVEWATER;
   }
-  else if(duck_y == OCEAN_HEIGHT){
+  else if(duck_y == surface){
     state->duck_pos = ATWATER;
   } else {
     state->duck_pos = UNDERWATER;
@@ -365,10 +389,26 @@ void generate_duck(scene_t *scene) {
   image_path = ("assets/single_duck.png");
   body_t *duck_body = body_init_with_info_with_image(duck_points, DUCK_MASS, DUCK_COLOR, image_path, (void *)make_type_info(DUCK));
   body_set_centroid(duck_body, (vector_t){.x = FRAME_BOTTOM_LEFT.x + DUCK_EDGE_BUFFER + DUCK_START_ADD, .y = (FRAME_TOP_RIGHT.y/2)});
+  // Jumps and dives are fast enough to skip over thin obstacles in one tick
+  body_set_bullet(duck_body, true);
   scene_add_body(scene, duck_body);
  
 }
 
+// Adds the ocean, drawn from its surface to the bottom of the screen
+void add_ocean(state_t *state) {
+  list_t *points = water_get_polygon(state->water, FRAME_BOTTOM_LEFT.y);
+  body_t *ocean = body_init_with_info(points, OCEAN_MASS, OCEAN_COLOR,
+                                      (void *)make_type_info(OCEAN));
+  scene_add_body(state->scene, ocean);
+}
+
+// Redraws the ocean's surface where the waves have moved it
+void update_ocean(state_t *state) {
+  body_t *ocean = scene_get_body(state->scene, OCEAN_INDEX);
+  body_set_shape(ocean, water_get_polygon(state->water, FRAME_BOTTOM_LEFT.y));
+}
+
 // Generates ocean cloud background
 void generate_ocean_cloud_background(scene_t *scene) {
 
@@ -378,6 +418,7 @@ void generate_ocean_cloud_background(scene_t *scene) {
   char *image_path = malloc(sizeof(char) * DEFAULT_STRING);
   image_path = ("assets/background.png");
   body_t *start_screen_bod = body_init_with_info_with_image(start_screen, DUCK_MASS, DUCK_COLOR, image_path, (void *)make_type_info(BACKGROUND));
+  body_set_static_layer(start_screen_bod, true);
   scene_add_body(scene, start_screen_bod);
  
 }
@@ -392,6 +433,7 @@ void add_iceberg(state_t *state){
   image_path = ("assets/iceberg.png");
   body_t *iceberg= body_init_with_info_with_image(rect_pts, INFINITY, DUCK_COLOR, image_path, (void *)make_type_info(BACKGROUND)); 
   body_set_centroid(iceberg, (vector_t)ICEBERG_STARTING_VEC);
+  body_set_motion(iceberg, BODY_KINEMATIC);
   body_set_velocity(iceberg, OBSTACLE_VEL);  
   scene_add_body(scene, iceberg);
 
@@ -407,6 +449,7 @@ void add_walls(scene_t *scene) {
   polygon_rotate(rect, M_PI / 2, VEC_ZERO);
   body_t *body =
       body_init_with_info(rect, INFINITY, WALL_COLOR, make_type_info(LEFT_WALL));
+  body_set_motion(body, BODY_STATIC);
   body_set_centroid(body, body_centroid(rect));
   scene_add_body(scene, body);
 
@@ -415,6 +458,7 @@ void add_walls(scene_t *scene) {
   polygon_translate(rect, (vector_t){.x = WALL_LENGTH / 2, .y = -MAX.x});
   polygon_rotate(rect, M_PI / 2, VEC_ZERO);
   body = body_init_with_info(rect, INFINITY, WALL_COLOR, make_type_info(RIGHT_WALL));
+  body_set_motion(body, BODY_STATIC);
   body_set_centroid(body, body_centroid(rect));
   scene_add_body(scene, body);
 
@@ -422,6 +466,7 @@ void add_walls(scene_t *scene) {
   rect = rect_init(MAX.x, WALL_WIDTH);
   body =
       body_init_with_info(rect, INFINITY, WALL_COLOR, make_type_info(BOTTOM_WALL));
+  body_set_motion(body, BODY_STATIC);
   body_set_centroid(body, (vector_t){.x = MAX.x / 2, .y = WALL_WIDTH / 2});
   scene_add_body(scene, body);
 
@@ -429,24 +474,12 @@ void add_walls(scene_t *scene) {
   rect = rect_init(MAX.x, WALL_WIDTH);
   polygon_translate(rect, (vector_t){MAX.x / 2, MAX.y});
   body = body_init_with_info(rect, INFINITY, WALL_COLOR, make_type_info(TOP_WALL));
+  body_set_motion(body, BODY_STATIC);
   body_set_centroid(body, body_centroid(rect));
   scene_add_body(scene, body);
 }
 
 
-// Adds a gravity body 
-void add_gravity_body(scene_t *scene) {
-  // Will be offscreen, so shape is irrelevant
-  list_t *gravity_ball = rect_init(1, 1);
-  body_t *body =
-      body_init_with_info(gravity_ball, M, WALL_COLOR, make_type_info(GRAVITY));
-
-  // Move a distnace R below the scene
-  vector_t gravity_center = {.x = MAX.x / 2, .y = -R};
-  body_set_centroid(body, gravity_center);
-  scene_add_body(scene, body);
-}
-
 // Removes everything on screen between scenes
 scene_t* remove_all(scene_t *scene) {
   size_t number_of_bodies = scene_bodies(scene);
@@ -457,12 +490,14 @@ scene_t* remove_all(scene_t *scene) {
   return scene;
 }
 
-// Generates game scene
-void generate_game_scene(scene_t *scene) {
+// Generates game scene, drawing the ocean in front of the background
+// and behind the duck
+void generate_game_scene(state_t *state) {
+  scene_t *scene = state->scene;
   generate_ocean_cloud_background(scene);
+  add_ocean(state);
   generate_duck(scene); 
   add_walls(scene);
-  add_gravity_body(scene);    
 }
 
 // Creates state given a scrolling speed and a time buffer for random obstacle generation
@@ -477,19 +512,34 @@ state_t* state_init(state_t* state, double scrolling_speed, double sec_buffer){
   return state;
 }
 
+// The index of the first obstacle or coin: they are added after the
+// background, the ocean, the duck and the walls (see generate_game_scene())
+size_t first_obstacle_index(void) {
+  return DUCK_INDEX + 1 + NUM_WALLS;
+}
+
 // Changes game to gameplay scene
 state_t* change_to_game_scene(state_t* state, game_mode_t mode){
   scene_t* scene = state->scene;
   scene = remove_all(scene);
-  generate_game_scene(scene);
+  // Waves from the last game would otherwise carry over
+  water_reset(state->water);
+  generate_game_scene(state);
+  assert(scene_bodies(scene) == first_obstacle_index());
 
-  // Add buoyancy force on duck
+  // Add gravity on the duck. A planet of mass M, R below the screen, pulls
+  // with almost the same strength anywhere on the screen.
   body_t* duck = scene_get_body(scene, DUCK_INDEX);
-  create_buoyancy(scene, G, duck,P, OCEAN_HEIGHT);
+  double gravity = G * M / (R * R);
+  list_t *floating = list_init(1, NULL);
+  list_add(floating, duck);
+  state->gravity_force = create_uniform_gravity(
+      scene, (vector_t){0, -gravity}, floating, NULL, NULL);
 
-  // Add gravity force between duck and earth
-  body_t* earth = scene_get_body(scene, EARTH_INDEX);
-  create_duck_gravity(scene, G,OCEAN_HEIGHT, duck, earth);
+  // Add buoyancy force on duck
+  state->buoyancy_force = create_buoyancy(scene, WATER_DENSITY, gravity,
+                                          state->water, floating, NULL, NULL);
+  list_free(floating);
 
   state->cur_scene = GAMEPLAY;
 
@@ -519,6 +569,7 @@ void generate_opening_scene(scene_t *scene) {
   char *image_path = malloc(sizeof(char) * DEFAULT_STRING);
   image_path = ("assets/actualhomescreen.png");
   body_t *start_screen_bod = body_init_with_info_with_image(start_screen, DUCK_MASS, DUCK_COLOR, image_path, (void *)make_type_info(BACKGROUND));
+  body_set_static_layer(start_screen_bod, true);
   scene_add_body(scene, start_screen_bod);  
 
 }
@@ -642,7 +693,8 @@ void onKey(char key, key_event_type_t type, double held_time, void *st) {
 
 // Sets moving screen 
 void set_moving_screen(state_t *state) {
-  for(size_t i = 7; i < scene_bodies(state->scene); i++) {
+  size_t num_bodies = scene_bodies(state->scene);
+  for(size_t i = first_obstacle_index(); i < num_bodies; i++) {
     body_set_x_velo(scene_get_body(state->scene, i), state->scrolling_screen_speed);
   }
 }
@@ -660,6 +712,7 @@ void generate_lose_scene(scene_t *scene) {
   char *image_path = malloc(sizeof(char) * DEFAULT_STRING);
   image_path = ("assets/gameover.png");
   body_t *end_screen_bod = body_init_with_info_with_image(start_screen, DUCK_MASS, DUCK_COLOR, image_path, (void *)make_type_info(BACKGROUND));
+  body_set_static_layer(end_screen_bod, true);
   scene_add_body(scene, end_screen_bod);
 }
 
@@ -703,6 +756,7 @@ void add_float(state_t *state){
   body_t *floaty = body_init_with_info_with_image(rect_pts, OBSTACLE_MASS, FLOAT_COLOR, image_path,
                                         (void *)make_type_info(FLOAT));
   body_set_centroid(floaty, (vector_t)FLOAT_STARTING_VEC);
+  body_set_motion(floaty, BODY_KINEMATIC);
   body_set_velocity(floaty, OBSTACLE_VEL);
   scene_add_body(scene, floaty);
 
@@ -720,6 +774,7 @@ void add_ship(state_t *state){
   body_t *ship = body_init_with_info_with_image(rect_pts, OBSTACLE_MASS, SHIP_COLOR, image_path,
                                         (void *)make_type_info(SHIP));
   body_set_centroid(ship, (vector_t)SHIP_STARTING_VEC);
+  body_set_motion(ship, BODY_KINEMATIC);
   body_set_velocity(ship, OBSTACLE_VEL);
   scene_add_body(scene, ship);
 
@@ -751,6 +806,8 @@ state_t* create_opening(){
   state->scrolling_screen_speed = 0;
   state->num_sec_buffer = 0;
   state->cur_scene = OPENING;
+  state->water = water_init(FRAME_BOTTOM_LEFT.x, OCEAN_WIDTH, OCEAN_COLUMNS,
+                            OCEAN_HEIGHT, OCEAN_WAVE_SPEED, OCEAN_DAMPING);
   return state;
 }
 
@@ -787,10 +844,14 @@ void generate_obstacles(state_t *state) {
 
 
 state_t *emscripten_init(void) {
-  srand(time(NULL));
+  srand(sdl_random_seed());
 
   // Initialize scene
   sdl_init(VEC_ZERO, FRAME_TOP_RIGHT);
+  // Use the asset pack if it has been built, and otherwise the loose files
+  if (!assets_load_pack(ASSET_PACK)) {
+    assets_preload(ASSET_MANIFEST);
+  }
   sound_init();
   splash_init();
 
@@ -809,65 +870,86 @@ state_t *emscripten_init(void) {
 void update_duck_ypos(state_t *state){
     scene_t *scene = state->scene;
     body_t *duck = scene_get_body(scene, DUCK_INDEX);
-    double duck_y = ((vector_t)body_get_centroid(duck)).y;
-    set_duck_pos(state, duck_y);
+    vector_t cur_centroid = body_get_centroid(duck);
+    double surface = surface_under_duck(state);
+
+    // Duck floating on the water rides up and down with the waves
+    if(!state->gravity_acting && !state->buoyancy_acting){
+      body_set_centroid(duck, (vector_t){cur_centroid.x, surface});
+      set_duck_pos(state, surface);
+      return;
+    }
+    set_duck_pos(state, cur_centroid.y);
     
     // If duck is in Gravity + at water level, set y velocity to 0
     if(state->gravity_acting ){
-      if(duck_y < OCEAN_HEIGHT){
+      if(cur_centroid.y < surface){
         state->gravity_acting = false;
-        vector_t cur_centroid = body_get_centroid(duck);
-        body_set_centroid(duck, (vector_t){cur_centroid.x, OCEAN_HEIGHT});
-        set_duck_pos(state, OCEAN_HEIGHT);
+        body_set_centroid(duck, (vector_t){cur_centroid.x, surface});
+        set_duck_pos(state, surface);
         body_set_velocity(duck, ZERO_VEC);
       }
     }
     // If duck is in Buoyancy + at water level, set y velocity to 0
     if(state->buoyancy_acting ){
-      if(duck_y > OCEAN_HEIGHT){
+      if(cur_centroid.y > surface){
         state->buoyancy_acting = false;
-        vector_t cur_centroid = body_get_centroid(duck);
-        body_set_centroid(duck, (vector_t){cur_centroid.x, OCEAN_HEIGHT});
-        set_duck_pos(state, OCEAN_HEIGHT);
+        body_set_centroid(duck, (vector_t){cur_centroid.x, surface});
+        set_duck_pos(state, surface);
         body_set_velocity(duck, ZERO_VEC);
       
       }
     }
 }
 
+// Gravity only pulls the duck down after it jumps, and buoyancy only pushes
+// it up after it dives, until it is back at the surface
+void update_duck_forces(state_t *state) {
+  scene_set_force_enabled(state->scene, state->gravity_force,
+                          state->gravity_acting);
+  scene_set_force_enabled(state->scene, state->buoyancy_force,
+                          state->buoyancy_acting);
+}
+
+// Moves the ocean's waves on, letting the duck splash as it dives in
+void update_water(state_t *state, double dt) {
+  body_t *duck = scene_get_body(state->scene, DUCK_INDEX);
+  water_disturb(state->water, get_body_points(duck),
+                body_get_velocity(duck).y, dt);
+  water_tick(state->water, dt);
+  update_ocean(state);
+}
+
 // Generates text for gameplay (score, timer)
 void generate_gameplay_text(state_t *state){
-  TTF_Font *score_font = TTF_OpenFont("assets/verdana.ttf",
-        FONT_SIZE);
+  font_t *score_font = assets_get_font("assets/verdana.ttf", FONT_SIZE);
     char *score_string = malloc(DEFAULT_STRING * sizeof(char));
     sprintf(score_string, "Score %zu", state->num_coins);
-    SDL_Texture *score_tex = sdl_make_text(score_string, score_font, ORANGE_COLOR);
-    sdl_render_text(score_tex, SCORE_POSITION, SCORE_SIZE_VECTOR);
+    sdl_draw_text(score_string, score_font, ORANGE_COLOR, SCORE_POSITION,
+        SCORE_SIZE_VECTOR);
+    free(score_string);
 
-    TTF_Font *timer_font = TTF_OpenFont("assets/verdana.ttf",
-        FONT_SIZE);
+    font_t *timer_font = assets_get_font("assets/verdana.ttf", FONT_SIZE);
     char *timer_string = malloc(DEFAULT_STRING * sizeof(char));
 
 
     sprintf(timer_string, "Time %f", state->time_elap);
-    SDL_Texture *timer_tex = sdl_make_text(timer_string, timer_font, ORANGE_COLOR);
     vector_t new_pos = {20, 450};
     vector_t new_size_vec = {190, SCORE_SIZE_VECTOR.y};
-    sdl_render_text(timer_tex, new_pos, new_size_vec);
-    TTF_CloseFont(score_font); 
-    TTF_CloseFont(timer_font); 
+    sdl_draw_text(timer_string, timer_font, ORANGE_COLOR, new_pos, new_size_vec);
+    free(timer_string);
 }
 
 // Generates text for lose screen (score)
 void generate_lose_text(state_t *state){
-    TTF_Font *score_font = TTF_OpenFont("assets/ARCADECLASSIC.TTF",
+    font_t *score_font = assets_get_font("assets/ARCADECLASSIC.TTF",
     FONT_SIZE);
     char *score_string = malloc(DEFAULT_STRING * sizeof(char));
     sprintf(score_string, "Score %zu", state->num_coins);
     vector_t new_pos = {869, 500};
-    SDL_Texture *score_tex = sdl_make_text(score_string, score_font, ORANGE_COLOR);
-    sdl_render_text(score_tex, new_pos, SCORE_SIZE_VECTOR);
-    TTF_CloseFont(score_font); 
+    sdl_draw_text(score_string, score_font, ORANGE_COLOR, new_pos,
+        SCORE_SIZE_VECTOR);
+    free(score_string);
     state->time_elap = 0.0;
 }
 
@@ -877,6 +959,12 @@ void emscripten_main(state_t *state){
   scene_t *scene = state->scene;
   scene_type_t scene_type = state->cur_scene;
 
+  // Menu screens only change on input, so don't redraw them until it arrives
+  if (!sdl_needs_redraw(scene)) {
+    sdl_wait_for_input(IDLE_WAIT_MS);
+    return;
+  }
+
   // If state is in gameplay mode
   if (scene_type == GAMEPLAY) {
     
@@ -890,8 +978,10 @@ void emscripten_main(state_t *state){
     state->time_elap += dt;
     state->time_of_last_obstacle += dt;
 
-    // Updates duck y position
+    // Updates the waves, then the duck's y position on them
+    update_water(state, dt);
     update_duck_ypos(state);
+    update_duck_forces(state);
     
     // Move to lose screen if duck pushed off screen
     if(duck_pushed_off_screen(state)){
@@ -902,7 +992,7 @@ void emscripten_main(state_t *state){
   
   
   // Scene tick + rendering
-  scene_tick(scene, dt);
+  scene_advance(scene, dt);
   sdl_render_scene(scene);
   
   // Text implementation depending on gameplay/lose modes
@@ -918,6 +1008,7 @@ void emscripten_main(state_t *state){
 
 void emscripten_free(state_t *state) {
   scene_free(state->scene);
+  water_free(state->water);
   free(state);
 }
 
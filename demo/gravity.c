@@ -35,7 +35,7 @@ const double ELASTICITY_START_RANGE = 90;
  * @return size_t
  */
 size_t rand_num_points() {
-  srand(time(NULL));
+  srand(sdl_random_seed());
   size_t num_points = 0;
   while (num_points <= 2) {
     num_points = rand() % MAX_NUM_POINTS;
@@ -190,6 +190,7 @@ void emscripten_main(scene_t *scene) {
   assert(scene != NULL);
 
   sdl_render_scene(scene);
+  sdl_show();
 
   scene_tick(scene, time_since_last_tick());
 
@@ -18,7 +18,12 @@ const int MAX_NUM_POINTS = 10;
 const double ACCELERATION = 9.81;
 const double MASS = 50;
 const int NUM_STARS = 30;
-const double G = 6.6743 * 20;
+// Twice the original constant, which applied gravity to each pair twice
+const double G = 6.6743 * 40;
+// Stars closer than this feel a smoothed-out pull rather than a huge one
+const double SOFTENING = 5;
+// Barnes-Hut opening angle; only matters for large numbers of stars
+const double THETA = 0.5;
 
 /**
  * @brief Given a desired number of points, return a list of the star points
@@ -93,7 +98,7 @@ size_t rand_num_points() {
  * @return list_t
  */
 list_t *get_stars_list() {
-  srand(time(NULL));
+  srand(sdl_random_seed());
   list_t *stars = list_init(NUM_STARS, (free_func_t)body_free);
   for (size_t i = 0; i < NUM_STARS; i++) {
     list_t *star_points = get_star_points(rand_num_points());
@@ -105,24 +110,6 @@ list_t *get_stars_list() {
   return stars;
 }
 
-/**
- * @brief Given a list of stars, add to gravity lists for each pair of stars
- *
- * @param scene
- * @param stars
- */
-void add_gravity(scene_t *scene, list_t *stars) {
-  for (size_t i = 0; i < list_size(stars); i++) {
-    for (size_t j = 0; j < list_size(stars); j++) {
-      if (i != j) {
-        body_t *body_1 = list_get(stars, i);
-        body_t *body_2 = list_get(stars, j);
-        create_newtonian_gravity(scene, G, body_1, body_2);
-      }
-    }
-  }
-}
-
 /**
  * @brief Initializes scene
  *
@@ -130,6 +117,8 @@ void add_gravity(scene_t *scene, list_t *stars) {
  */
 scene_t *emscripten_init() {
   scene_t *scene = scene_init();
+  // Leapfrog keeps the orbits stable with the default time step
+  scene_set_integrator(scene, INTEGRATOR_LEAPFROG);
   // Initialize sdl
   sdl_init(FRAME_BOTTOM_LEFT, FRAME_TOP_RIGHT);
 
@@ -138,7 +127,7 @@ scene_t *emscripten_init() {
   for (size_t i = 0; i < list_size(stars); i++) {
     scene_add_body(scene, list_get(stars, i));
   }
-  add_gravity(scene, stars);
+  create_nbody_gravity(scene, G, SOFTENING, THETA, stars);
 
   sdl_render_scene(scene);
   sdl_at_scene(scene);
@@ -154,7 +143,8 @@ void emscripten_main(scene_t *scene) {
 
   assert(scene != NULL);
   sdl_render_scene(scene);
-  scene_tick(scene, time_since_last_tick());
+  sdl_show();
+  scene_advance(scene, time_since_last_tick());
 }
 
 /**
@@ -324,7 +324,7 @@ scene_t *emscripten_init() {
   // first elem is pacman, rest are pellets
   scene_add_body(scene, pacman);
 
-  srand(time(NULL));
+  srand(sdl_random_seed());
 
   for (size_t i = 0; i < NUM_PELLETS; i++) {
 
@@ -373,6 +373,7 @@ scene_t *emscripten_init() {
 void emscripten_main(scene_t *scene) {
   assert(scene != NULL);
   sdl_render_scene(scene);
+  sdl_show();
   scene_tick(scene, time_since_last_tick());
   check_hit_pellet(scene);
   if (check_pacman_off_screen(scene) != INSIDE) {
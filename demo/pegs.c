@@ -117,6 +117,7 @@ void freeze(body_t *ball, body_t *target, vector_t axis, void *aux) {
   body_remove(ball);
   body_t *frozen = get_ball(body_get_centroid(ball), VEC_ZERO);
   *((body_type_t *)body_get_info(frozen)) = FROZEN;
+  body_set_motion(frozen, BODY_STATIC);
   scene_t *scene = aux;
   scene_add_body(scene, frozen);
 
@@ -170,6 +171,7 @@ void add_pegs(scene_t *scene) {
       list_t *polygon = circle_init(PEG_RADIUS);
       body_t *body = body_init_with_info(polygon, INFINITY, PEG_COLOR,
                                          make_type_info(WALL));
+      body_set_motion(body, BODY_STATIC);
       body_set_centroid(body, get_peg_center(i, j));
       scene_add_body(scene, body);
     }
@@ -184,18 +186,21 @@ void add_walls(scene_t *scene) {
   polygon_rotate(rect, WALL_ANGLE, VEC_ZERO);
   body_t *body =
       body_init_with_info(rect, INFINITY, WALL_COLOR, make_type_info(WALL));
+  body_set_motion(body, BODY_STATIC);
   scene_add_body(scene, body);
 
   rect = rect_init(WALL_LENGTH, WALL_WIDTH);
   polygon_translate(rect, (vector_t){.x = MAX.x - WALL_LENGTH / 2, .y = 0.0});
   polygon_rotate(rect, -WALL_ANGLE, (vector_t){.x = MAX.x, .y = 0.0});
   body = body_init_with_info(rect, INFINITY, WALL_COLOR, make_type_info(WALL));
+  body_set_motion(body, BODY_STATIC);
   scene_add_body(scene, body);
 
   // Ground is special; it freezes balls when they touch it
   rect = rect_init(MAX.x, WALL_WIDTH);
   body =
       body_init_with_info(rect, INFINITY, WALL_COLOR, make_type_info(FROZEN));
+  body_set_motion(body, BODY_STATIC);
   body_set_centroid(body, (vector_t){.x = MAX.x / 2, .y = WALL_WIDTH / 2});
   scene_add_body(scene, body);
 }
@@ -206,10 +211,14 @@ typedef struct state {
 } state_t;
 
 state_t *emscripten_init(void) {
-  srand(time(NULL));
+  srand(sdl_random_seed());
   // Initialize scene
   sdl_init(VEC_ZERO, MAX);
   scene_t *scene = scene_init();
+  // Every ball checks for collisions with every peg, so split them across cores
+  scene_set_threads(scene, 0);
+  // Pegs and walls never move, so let them sleep instead of integrating them
+  scene_set_sleeping(scene, true);
   // Add elements to the scene
   add_gravity_body(scene);
   add_pegs(scene);
@@ -233,6 +242,7 @@ void emscripten_main(state_t *state) {
   }
   scene_tick(state->scene, dt);
   sdl_render_scene(state->scene);
+  sdl_show();
 }
 
 void emscripten_free(state_t *state) {
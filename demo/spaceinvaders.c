@@ -59,7 +59,8 @@ enum off_screen {
 enum body_type { PLAYER = 0, ENEMY = 1, PLAYER_BULLET = 2, ENEMY_BULLET = 3 };
 
 // Time variable
-static clock_t prev_time = 0;
+// Simulated time since an enemy last shot, in seconds
+static double time_since_shot = 0;
 const int TIME_PER_SHOOT = 3;
 
 list_t *get_player_points(double center_x, double center_y) {
@@ -220,7 +221,7 @@ void onKey(char key, key_event_type_t type, double held_time, void *sc) {
 }
 
 scene_t *emscripten_init() {
-  srand(time(NULL));
+  srand(sdl_random_seed());
   scene_t *scene = scene_init();
   sdl_init(FRAME_BOTTOM_LEFT, FRAME_TOP_RIGHT);
 
@@ -291,10 +292,11 @@ int get_num_enemies(scene_t *scene) {
   return counter;
 }
 
-bool check_shoot_bullet() {
-  clock_t cur_time = clock();
-  if ((cur_time - prev_time) / CLOCKS_PER_SEC == TIME_PER_SHOOT) {
-    prev_time = cur_time;
+bool check_shoot_bullet(double dt) {
+  // Count simulated time rather than clock(), so headless runs repeat exactly
+  time_since_shot += dt;
+  if (time_since_shot >= TIME_PER_SHOOT) {
+    time_since_shot = 0;
     return true;
   }
   return false;
@@ -391,6 +393,7 @@ void update_enemy_pos(scene_t *scene) {
 void emscripten_main(scene_t *scene) {
   assert(scene != NULL);
   sdl_render_scene(scene);
+  sdl_show();
 
   // If num of enemies is 0, done with game
   if (get_num_enemies(scene) == 0) {
@@ -404,11 +407,12 @@ void emscripten_main(scene_t *scene) {
 
   update_enemy_pos(scene);
   check_player_bullet_collision(scene);
-  scene_tick(scene, time_since_last_tick());
+  double dt = time_since_last_tick();
+  scene_tick(scene, dt);
 
   // Randomly choose an enemy to shoot a bullet
   // Pick random number from 1 to get_num_enemies(scene)
-  if (check_shoot_bullet()) {
+  if (check_shoot_bullet(dt)) {
     int r = rand() % get_num_enemies(scene) + 1;
     shoot_bullet(scene, r);
   }
@@ -0,0 +1,118 @@
+#ifndef __ASSETS_H__
+#define __ASSETS_H__
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_ttf.h>
+
+/**
+ * A font at a particular size, either opened from a TTF file
+ * or taken from a pre-rendered atlas in an asset pack.
+ */
+typedef struct font font_t;
+
+/**
+ * Starts loading every asset listed in a manifest file in the background.
+ * The manifest lists one file path per line; blank lines and lines starting
+ * with '#' are ignored, as is anything after the path (tools/pack_assets
+ * reads font sizes from there). PNG images and WAV sounds are decoded, and
+ * TTF fonts are read into memory, on a pool of worker threads (in the browser,
+ * which has no threads, one asset is loaded each frame instead).
+ *
+ * Should be called once, after sdl_init() and before the first frame.
+ * Opens the audio device, since sounds are decoded into its format.
+ *
+ * @param manifest_path the path of the manifest, e.g. "assets/manifest.txt"
+ */
+void assets_preload(const char *manifest_path);
+
+/**
+ * Memory-maps an asset pack made by tools/pack_assets (see pack.h),
+ * or in the browser, reads it into memory.
+ * Images, font atlases and sounds in the pack are then used straight from
+ * the mapped file, without opening or decoding any other files.
+ * Assets that are not in the pack are loaded from their own files when needed.
+ * Use instead of assets_preload(); call once after sdl_init().
+ *
+ * @param pack_path the path of the pack, e.g. "assets/assets.pack"
+ * @return true if the pack was mapped, false if it is missing or invalid
+ */
+bool assets_load_pack(const char *pack_path);
+
+/**
+ * Gets the next preloaded image that has finished decoding
+ * and has not been taken yet, without waiting.
+ * Used by the renderer to upload images as they arrive.
+ *
+ * @param path set to the path of the image from the manifest
+ * @param premultiplied set to whether the image's colors are premultiplied
+ *   by its alpha, in which case it must be drawn with a matching blend mode
+ * @return the decoded image, owned by the caller,
+ *   or NULL if no new image is ready
+ */
+SDL_Surface *assets_take_image(const char **path, bool *premultiplied);
+
+/**
+ * Gets a preloaded image by path, waiting for it to finish decoding if needed.
+ *
+ * @param path the path of the image, as listed in the manifest
+ * @param premultiplied set to whether the image's colors are premultiplied
+ * @return the decoded image, owned by the caller, or NULL if the image
+ *   is not in the manifest, failed to decode or was already taken
+ */
+SDL_Surface *assets_get_image(const char *path, bool *premultiplied);
+
+/**
+ * Gets a font at a given size. Uses the pre-rendered atlas from the asset pack
+ * if there is one, and otherwise opens the font from preloaded data if
+ * possible. Fonts are cached, so this is cheap to call every frame.
+ *
+ * @param path the path of the TTF file
+ * @param size the point size of the font
+ * @return the font, owned by the asset manager, or NULL if it could not be
+ *   opened
+ */
+font_t *assets_get_font(const char *path, int size);
+
+/**
+ * Renders a line of text.
+ *
+ * @param font a font returned by assets_get_font()
+ * @param text the text to render
+ * @param color the color of the text
+ * @return the rendered text, owned by the caller,
+ *   or NULL if it could not be rendered
+ */
+SDL_Surface *assets_render_text(font_t *font, const char *text,
+                                SDL_Color color);
+
+/**
+ * Gets a preloaded sound by path, waiting for it to finish decoding if needed.
+ *
+ * @param path the path of the sound, as listed in the manifest
+ * @return the decoded sound, owned by the caller,
+ *   or NULL if the sound is not in the manifest or failed to decode
+ */
+Mix_Chunk *assets_get_sound(const char *path);
+
+/**
+ * Gets a preloaded sound by path without waiting for it to finish decoding.
+ *
+ * @param path the path of the sound, as listed in the manifest
+ * @param pending set to whether the sound is still being decoded, in which
+ *   case NULL is returned and it can be asked for again later
+ * @return the decoded sound, owned by the caller, or NULL if the sound is
+ *   pending, not in the manifest or failed to decode
+ */
+Mix_Chunk *assets_poll_sound(const char *path, bool *pending);
+
+/**
+ * Tells the asset manager that a frame has been shown.
+ * Once the first frame has been shown and every asset has loaded,
+ * prints how long startup took and how long each asset took to load.
+ * In the browser, this also loads the next asset.
+ */
+void assets_frame_shown(void);
+
+#endif // #ifndef __ASSETS_H__
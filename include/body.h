@@ -14,13 +14,26 @@
  */
 typedef struct body body_t;
 
+/**
+ * How the scene moves a body. See body_set_motion().
+ */
+typedef enum {
+  // Moved by its forces, impulses and velocity. The default.
+  BODY_DYNAMIC,
+  // Moved by its velocity alone, like a body of infinite mass.
+  // The default for bodies of infinite mass.
+  BODY_KINEMATIC,
+  // Never moved by the scene, though it can be placed with the setters.
+  BODY_STATIC,
+} body_motion_t;
+
 /**
  * Allocates memory for a body with the given parameters.
  * The body is initially at rest.
  * Asserts that the mass is positive and that the required memory is allocated.
  *
  * @param shape a list of vectors describing the initial shape of the body
- * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param mass the mass of the body (if INFINITY, makes the body kinematic)
  * @param color the color of the body, used to draw it on the screen
  * @return a pointer to the newly allocated body
  */
@@ -50,6 +63,35 @@ void body_free(body_t *body);
 
 char *body_get_image_path(body_t *bod);
 
+/**
+ * Marks whether a body belongs to the static layer.
+ * Static layer bodies (e.g. full-screen backgrounds) rarely change on screen,
+ * so the renderer draws them once into a cached texture instead of every frame.
+ * Changing such a body with a setter, removing or freeing it redraws the
+ * layer (see body_get_static_layer_generation()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param is_static whether the body should be drawn into the static layer
+ */
+void body_set_static_layer(body_t *body, bool is_static);
+
+/**
+ * Returns whether a body was marked with body_set_static_layer().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return true if the body is drawn from the cached static layer
+ */
+bool body_is_static_layer(body_t *body);
+
+/**
+ * Returns a number that changes whenever a body is put on or taken off the
+ * static layer, or a static layer body is moved, rotated, reshaped, recolored,
+ * removed or freed. The renderer redraws the static layer when it changes.
+ *
+ * @return the current generation of the static layer
+ */
+size_t body_get_static_layer_generation(void);
+
 /**
  * Gets the current shape of a body.
  * Returns a newly allocated vector list, which must be list_free()d.
@@ -86,6 +128,22 @@ vector_t body_get_velocity(body_t *body);
  */
 double body_get_mass(body_t *body);
 
+/**
+ * Gets the electric charge of a body, used by create_coulomb_force().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the charge set with body_set_charge(), initially 0
+ */
+double body_get_charge(body_t *body);
+
+/**
+ * Sets the electric charge of a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param charge the new charge; bodies with the same sign repel
+ */
+void body_set_charge(body_t *body, double charge);
+
 /**
  * Gets the display color of a body.
  *
@@ -97,12 +155,24 @@ rgb_color_t body_get_color(body_t *body);
 /**
  * Translates a body to a new position.
  * The position is specified by the position of the body's center of mass.
+ * The body jumps there: it is not drawn moving from its previous position
+ * (see body_get_interpolated_centroid()).
  *
  * @param body a pointer to a body returned from body_init()
  * @param x the body's new centroid
  */
 void body_set_centroid(body_t *body, vector_t x);
 
+/**
+ * Moves a body's center of mass to a new position as part of its motion.
+ * Unlike body_set_centroid(), the body's previous position is kept,
+ * so it is drawn moving smoothly between the two.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param x the body's new centroid
+ */
+void body_move_centroid(body_t *body, vector_t x);
+
 /**
  * Changes a body's velocity (the time-derivative of its position).
  *
@@ -111,10 +181,20 @@ void body_set_centroid(body_t *body, vector_t x);
  */
 void body_set_velocity(body_t *body, vector_t v);
 
+/**
+ * Gets the current orientation of a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's angle in radians, relative to its initial shape
+ */
+double body_get_angle(body_t *body);
+
 /**
  * Changes a body's orientation in the plane.
  * The body is rotated about its center of mass.
  * Note that the angle is *absolute*, not relative to the current orientation.
+ * The body turns at once: it is not drawn turning from its previous angle
+ * (see body_get_interpolated_angle()).
  *
  * @param body a pointer to a body returned from body_init()
  * @param angle the body's new angle in radians. Positive is counterclockwise.
@@ -151,6 +231,176 @@ void body_add_force(body_t *body, vector_t force);
  */
 void body_add_impulse(body_t *body, vector_t impulse);
 
+/**
+ * Sets a body's slot: its index in the arrays passed to
+ * body_accumulate_into(). Scenes number their bodies this way
+ * before applying forces on several threads.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param slot the body's index
+ */
+void body_set_slot(body_t *body, size_t slot);
+
+/**
+ * Gets a body's slot, as set by body_set_slot().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's index
+ */
+size_t body_get_slot(body_t *body);
+
+/**
+ * Arrays of forces and impulses indexed by body slot; see body_set_slot().
+ */
+typedef struct body_sums {
+  vector_t *forces;   // a force for each slot, or NULL to use the bodies
+  vector_t *impulses; // an impulse for each slot, or NULL
+  size_t num_slots;   // every body that gets a force must have a smaller slot
+} body_sums_t;
+
+/**
+ * Makes body_add_force() and body_add_impulse() on the calling thread add to
+ * the given arrays, at each body's slot, instead of to the bodies themselves.
+ * This lets several threads apply forces to the same bodies at once,
+ * each into its own arrays, which are then added up in a fixed order.
+ *
+ * @param sums the arrays to add to, or all NULL to add to the bodies again
+ * @return the arrays the thread was adding to before, to put back afterwards.
+ *   A thread waiting for jobs may run another job in the middle of its own
+ *   (see job.h), so it cannot assume it was adding to the bodies.
+ */
+body_sums_t body_accumulate_into(body_sums_t sums);
+
+/**
+ * Adds the impulses applied to a body since the last tick to its velocity,
+ * and resets them. Used by the integrators in scene_tick().
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_apply_impulses(body_t *body);
+
+/**
+ * Gets the acceleration caused by the forces applied to a body
+ * since this was last called, and resets the forces.
+ * Used by the integrators in scene_tick().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the sum of the forces divided by the body's mass
+ */
+vector_t body_take_acceleration(body_t *body);
+
+/**
+ * Gets the velocity a body will have once the forces and impulses added to it
+ * so far are applied over a tick. Used by the contact solver to find the
+ * impulses that stop bodies moving into each other by the end of the tick.
+ * Forces still being added up on other threads (see body_accumulate_into())
+ * are not included.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param dt the length of the tick, in seconds
+ * @return the velocity the body will have after the tick
+ */
+vector_t body_predict_velocity(body_t *body, double dt);
+
+/**
+ * Gets the width of a body's shape (see polygon_width()), which is computed
+ * the first time it is needed, since moving and rotating the body keep it.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the width of the body's shape
+ */
+double body_get_width(body_t *body);
+
+/**
+ * Marks a body as a bullet, to be swept along its path each tick so that it
+ * cannot pass through the bodies it collides with, however fast it moves.
+ * Bodies that move farther than about their width in a tick are swept
+ * anyway (see scene_tick()); this is for bodies that must never be missed.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param bullet whether the body is a bullet
+ */
+void body_set_bullet(body_t *body, bool bullet);
+
+/**
+ * Returns whether a body is a bullet. See body_set_bullet().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is a bullet
+ */
+bool body_is_bullet(body_t *body);
+
+/**
+ * Sets how the scene moves a body. Only dynamic bodies are pushed by forces
+ * and impulses; the rest collide as if their mass were infinite, and forces
+ * added to them are ignored. A static body is also never checked for
+ * collisions with other static bodies, or with sleeping ones. Wakes the body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param motion how the body should move from now on
+ */
+void body_set_motion(body_t *body, body_motion_t motion);
+
+/**
+ * Gets how the scene moves a body. See body_set_motion().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return how the body moves
+ */
+body_motion_t body_get_motion(body_t *body);
+
+/**
+ * Returns whether a body is asleep (see scene_set_sleeping()).
+ * Sleeping bodies are not moved, and are not checked for collisions
+ * with other sleeping bodies.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is asleep
+ */
+bool body_is_asleep(body_t *body);
+
+/**
+ * Returns how many times a body has been placed directly, by
+ * body_set_centroid(), body_set_rotation(), body_set_rotation_relative()
+ * or body_set_shape(), rather than moved by the scene. Lets collisions
+ * notice when a static or sleeping body has been moved.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the number of times the body has been placed
+ */
+size_t body_get_placements(body_t *body);
+
+/**
+ * Wakes a body if it is asleep. Setting a body's position, velocity,
+ * rotation or shape wakes it too.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_wake(body_t *body);
+
+/**
+ * Decides whether a sleeping body stays asleep this tick, once its forces
+ * and impulses have been applied. It wakes if it was given an impulse,
+ * or if its net force has changed since it fell asleep: a body resting under
+ * gravity stays asleep, but one whose spring is pulled does not. If it stays
+ * asleep, its forces are dropped. Used by the integrators in scene_tick().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is asleep and should not be moved this tick
+ */
+bool body_check_sleep(body_t *body);
+
+/**
+ * Puts a body to sleep once it has been slow, with a nearly constant
+ * velocity, for long enough. Called after the body has been moved each tick.
+ * Only dynamic bodies sleep: kinematic bodies keep moving at their velocity,
+ * however slow.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param dt the length of the tick, in seconds
+ */
+void body_update_sleep(body_t *body, double dt);
+
 /**
  * Updates the body after a given time interval has elapsed.
  * Sets acceleration and velocity according to the forces and impulses
@@ -174,14 +424,62 @@ void body_tick(body_t *body, double dt);
 list_t *get_body_points(body_t *body);
 
 /**
- * Changes a body's orientation in the plane.
- * The body is rotated about its center of mass.
- * Note that the angle is *absolute*, not relative to the current orientation.
+ * Remembers a body's current position and angle as its previous state,
+ * for drawing it between ticks (see scene_advance()).
  *
  * @param body a pointer to a body returned from body_init()
- * @param angle the body's new angle in radians. Positive is counterclockwise.
  */
+void body_save_state(body_t *body);
 
+/**
+ * Gets a position between a body's previous state and its current centroid.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param alpha 0 for the previous state, 1 for the current centroid
+ * @return the interpolated centroid
+ */
+vector_t body_get_interpolated_centroid(body_t *body, double alpha);
+
+/**
+ * Gets an angle between a body's previous state and its current angle.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param alpha 0 for the previous state, 1 for the current angle
+ * @return the interpolated angle in radians
+ */
+double body_get_interpolated_angle(body_t *body, double alpha);
+
+/**
+ * Gets the triangles that make up a body's shape, for filling it on screen.
+ * The shape is triangulated with polygon_triangulate() the first time this is
+ * called and cached until the shape is replaced with body_set_shape().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param num_triangles set to the number of triangles
+ * @return 3 * num_triangles indices into the body's points; owned by the body
+ */
+size_t *body_get_triangles(body_t *body, size_t *num_triangles);
+
+/**
+ * Gets a key identifying the shape of a body, independent of where the body
+ * has been moved and how it has been rotated since it was created.
+ * Bodies created from the same list of vertices share a key, which lets the
+ * renderer draw them all from one cached texture.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's shape key, or 0 if the shape has been replaced with
+ *   body_set_shape() and so may keep changing
+ */
+size_t body_get_shape_key(body_t *body);
+
+/**
+ * Rotates a body further about its center of mass.
+ * Unlike body_set_rotation(), the angle is relative to the current orientation.
+ * Like it, the body turns at once, without being drawn turning.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param angle the angle to rotate by in radians. Positive is counterclockwise.
+ */
 void body_set_rotation_relative(body_t *body, double angle);
 
 /**
@@ -256,43 +554,6 @@ void body_remove(body_t *body);
  */
 bool body_is_removed(body_t *body);
 
-/**
- * @brief Finds the edges associated with the shape of a body
- *
- * @param list_t*
- * @return list_t*
- */
-list_t *find_edges(list_t *sh);
-
-/**
- * @brief Given a list of edges, returns the corresponding axes
- * (i.e., perpendicular lines)
- *
- * @param edges
- * @return list_t*
- */
-list_t *find_axes(list_t *edges);
-
-/**
- * @brief Given a body and an axis, find min/max projection points on axis
- *
- * @param body
- * @param axis
- * @return vector_t - contains the min and max values of projection
- */
-vector_t body_proj_on_axis(list_t *sh, vector_t *axis);
-
-/**
- * @brief Check if the projections of the bodies on the axis intersect
- * (collision on that axis)
- *
- * @param shape1
- * @param shape2
- * @param axis
- * @return non -1 - the amount of overlap on the axis
- * @return -1 - no collision on axis
- */
-double check_overlap_axis(list_t *shape1, list_t *shape2, vector_t *axis);
 /**
  * Gets the information associated with a body.
  *
@@ -8,6 +8,7 @@
 /**
  * Represents the status of a collision between two shapes.
  * The shapes are either not colliding, or they are colliding along some axis.
+ * If collided is false, the other fields are undefined.
  */
 typedef struct {
   /** Whether the two shapes are colliding */
@@ -16,9 +17,26 @@ typedef struct {
    * If the shapes are colliding, the axis they are colliding on.
    * This is a unit vector pointing from the first shape towards the second.
    * Normal impulses are applied along this axis.
-   * If collided is false, this value is undefined.
    */
   vector_t axis;
+  /**
+   * How far the shapes overlap along the axis: moving the second shape
+   * this far along it, or the first this far against it, separates them.
+   */
+  double depth;
+  /**
+   * Where the shapes touch: 2 points where an edge lies along an edge,
+   * otherwise 1. Each is a vertex of one shape inside the other, or the end
+   * of the part of an edge that lies along the other shape's edge.
+   */
+  vector_t contacts[2];
+  /**
+   * Which edges and vertices made each contact point. Stays the same from
+   * one tick to the next while the shapes slide along each other, so that
+   * a contact can be recognized again.
+   */
+  size_t features[2];
+  size_t num_contacts;
 } collision_info_t;
 
 /**
@@ -29,9 +47,41 @@ typedef struct {
  *
  * @param shape1 the first shape
  * @param shape2 the second shape
- * @return whether the shapes are colliding, and if so, the collision axis.
- * The axis should be a unit vector pointing from shape1 towards shape2.
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * depth and contact points. The axis is a unit vector pointing from shape1
+ * towards shape2.
  */
 collision_info_t find_collision(list_t *shape1, list_t *shape2);
 
+/**
+ * Same as find_collision(), but leaves the shapes alone and allocates nothing,
+ * so it can test bodies' own vertex lists (see get_body_points()),
+ * from several threads at once.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ *   depth and contact points
+ */
+collision_info_t find_shape_collision(list_t *shape1, list_t *shape2);
+
+/**
+ * Finds when two convex polygons first touched while moving in straight
+ * lines to where they are now, e.g. over the last tick. Since the motion is
+ * swept rather than sampled, a shape that passed right through the other
+ * still counts. Leaves the shapes alone and allocates nothing.
+ *
+ * @param shape1 the first shape, where it ended up
+ * @param motion1 how far the first shape moved
+ * @param shape2 the second shape, where it ended up
+ * @param motion2 how far the second shape moved
+ * @param axis if the shapes first touched after the start of the motion,
+ *   set to the unit normal they touched along, pointing from shape1
+ *   towards shape2
+ * @return the fraction of the motion, from 0 to 1, at which the shapes first
+ *   touched, or INFINITY if they never did
+ */
+double find_time_of_impact(list_t *shape1, vector_t motion1, list_t *shape2,
+                           vector_t motion2, vector_t *axis);
+
 #endif // #ifndef __COLLISION_H__
@@ -1,7 +1,10 @@
 #ifndef __FORCES_H__
 #define __FORCES_H__
 
+#include "collision.h"
+#include "island.h"
 #include "scene.h"
+#include "water.h"
 
 /**
  * A function called when a collision occurs.
@@ -14,6 +17,185 @@
 typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
                                     void *aux);
 
+/**
+ * A condition for a force to act on a body, e.g. only while it is in the air.
+ * In a scene using several threads (see scene_set_threads()), it may be called
+ * from any of them, so it should not change anything.
+ * @param body the body the force would act on
+ * @param aux the auxiliary value passed when the force was created
+ * @return whether the force should act on the body this tick
+ */
+typedef bool (*force_condition_t)(body_t *body, void *aux);
+
+/**
+ * The kinds of force a scene holds. The scene keeps its forces sorted by kind,
+ * so that each kind is applied by its own loop over all forces of that kind.
+ */
+typedef enum force_kind {
+  FORCE_GRAVITY,   // see create_newtonian_gravity()
+  FORCE_SPRING,    // see create_spring()
+  FORCE_DRAG,      // see create_drag()
+  FORCE_COLLISION, // see create_collision()
+  FORCE_CREATOR    // any other force_creator_t, e.g. forces on groups of bodies
+} force_kind_t;
+
+/**
+ * A force held by a scene. The scene stores its forces in one array,
+ * with each force's parameters stored in the force itself.
+ */
+struct force {
+  force_kind_t kind;
+  bool enabled; // see scene_set_force_enabled()
+  size_t id;    // set by scene_add_force()
+  // The bodies the force acts on; body2 is NULL for drag. The force is
+  // removed when either body is removed. Not used by FORCE_CREATOR.
+  body_t *body1;
+  body_t *body2;
+  union {
+    struct {
+      double G;
+      double softening; // see create_softened_gravity(), or 0
+    } gravity;
+    double spring_k;
+    double drag_gamma;
+    struct {
+      collision_handler_t handler;
+      void *aux;
+      free_func_t freer; // frees aux, or NULL
+      bool colliding;    // whether the bodies collided last tick
+      bool started;      // whether they started colliding this tick
+      collision_info_t info; // see forces_detect_collisions()
+      // Both bodies' body_get_placements() when they were last checked,
+      // and whether either has been placed since
+      size_t placements;
+      bool placed;
+      // Each contact point's impulse from the solver last tick, and the
+      // features that touched there, to warm-start from
+      double impulses[2];
+      size_t features[2];
+      size_t num_impulses;
+      double bounce; // how fast the bodies should separate this tick
+    } collision;
+    struct {
+      force_creator_t forcer;
+      void *aux;
+      free_func_t freer; // frees aux, or NULL
+      list_t *bodies;    // see scene_add_bodies_force_creator(); owned
+      bool group;        // see scene_add_group_force_creator()
+      bool thread_safe;  // see scene_set_force_thread_safe()
+    } creator;
+  };
+};
+
+/**
+ * Applies an array of forces, sorted by kind, to their bodies.
+ * Disabled forces are skipped.
+ * Same as forces_detect_collisions(), forces_apply_concurrent() for the whole
+ * array, then forces_apply_serial(), all on the calling thread.
+ *
+ * @param forces the forces to apply
+ * @param count the number of forces
+ */
+void forces_apply(force_t *forces, size_t count);
+
+/**
+ * Checks every pair of bodies with a collision force for a collision, and
+ * records the result in the force for forces_apply_serial() to respond to.
+ * Pairs of still bodies are only checked again once one has been placed
+ * (see body_get_placements()). Nothing else is changed, so with many pairs the checks can be spread over
+ * the job pool (see job.h) with the same results.
+ *
+ * @param forces the forces to check, sorted by kind
+ * @param count the number of forces
+ * @param parallel whether to use the job pool
+ */
+void forces_detect_collisions(force_t *forces, size_t count, bool parallel);
+
+/**
+ * Applies the part of an array of forces, sorted by kind,
+ * that can run on several threads at once: one slice of each kind.
+ * Collisions are skipped; see forces_detect_collisions().
+ * Force creators are skipped unless they are thread-safe.
+ *
+ * Threads applying different parts should each collect their forces with
+ * body_accumulate_into().
+ *
+ * @param forces the forces to apply
+ * @param count the number of forces
+ * @param part which slice of each kind to apply, from 0 to num_parts - 1
+ * @param num_parts the number of slices each kind is split into
+ */
+void forces_apply_concurrent(force_t *forces, size_t count, size_t part,
+                             size_t num_parts);
+
+/**
+ * Applies the rest of an array of forces after forces_detect_collisions(),
+ * and forces_apply_concurrent() for every part: calls the handlers of bodies
+ * that started colliding, and the force creators that are not thread-safe,
+ * one at a time, all in the order they were added.
+ *
+ * @param forces the forces to apply
+ * @param count the number of forces
+ * @param islands if not NULL, physics collisions (see
+ *   create_physics_collision()) are added to these islands instead of
+ *   resolved, for forces_resolve_islands(). The bodies' slots must be set.
+ */
+void forces_apply_serial(force_t *forces, size_t count, islands_t *islands);
+
+/**
+ * Resolves the physics collisions forces_apply_serial() added to islands
+ * (see island.h) with sequential impulses: each pass visits an island's
+ * contact points in the order the forces were added, changing each point's
+ * impulse so the bodies will not be moving into each other at the end of
+ * the tick, given the forces and impulses on them so far. Bodies that start
+ * colliding bounce off each other instead. Each point starts from its
+ * impulse last tick if the same edge and vertex are touching, so stacks
+ * settle over a few ticks rather than each tick starting from nothing.
+ * Overlapping bodies are then moved apart, without changing their
+ * velocities, by most of the overlap, so that they separate over a tick or
+ * two. Islands where nothing will be moving only have their overlaps
+ * corrected.
+ *
+ * @param forces the forces passed to forces_apply_serial()
+ * @param islands the islands passed to forces_apply_serial()
+ * @param iterations the number of passes over each island's contacts
+ * @param dt the length of the tick, to predict the bodies' velocities
+ * @param parallel whether to resolve islands on the job pool at once
+ */
+void forces_resolve_islands(force_t *forces, islands_t *islands,
+                            size_t iterations, double dt, bool parallel);
+
+/**
+ * Finds the pairs of bodies with a physics collision (see
+ * create_physics_collision()) that passed through each other during a tick,
+ * too fast for forces_detect_collisions() to see them overlap, by sweeping
+ * their shapes along their paths (see find_time_of_impact()). Collisions with
+ * other handlers are triggers, which bodies pass straight through, so they
+ * are not swept. Only pairs with a bullet (see body_set_bullet()) or that
+ * moved farther than about their combined width are swept.
+ * For each dynamic body in such a pair, finds how far along its path it
+ * should be put back to so that the pair is seen colliding next tick.
+ *
+ * @param forces the forces to check, sorted by kind
+ * @param count the number of forces
+ * @param motions how far each body moved during the tick, by slot
+ * @param num_slots the number of slots in motions and impacts.
+ *   Bodies with other slots are skipped.
+ * @param impacts the fraction of its motion each body should be put back to,
+ *   by slot. Lowered for bodies that hit something; should start at 1.
+ */
+void forces_find_impacts(force_t *forces, size_t count,
+                         const vector_t *motions, size_t num_slots,
+                         double *impacts);
+
+/**
+ * Frees everything a force owns (e.g. its aux value), but not the force itself
+ * or its bodies.
+ *
+ * @param force the force being removed from its scene
+ */
+void force_free(force_t *force);
+
 /**
  * Adds a force creator to a scene that applies gravity between two bodies.
  * The force creator will be called each tick
@@ -27,21 +209,112 @@ typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
  * @param G the gravitational proportionality constant
  * @param body1 the first body
  * @param body2 the second body
+ * @return the id of the new force, for scene_set_force_enabled()
+ */
+size_t create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
+                                body_t *body2);
+
+/**
+ * Adds a force creator to a scene that applies Plummer-softened gravity
+ * between two bodies: G m1 m2 r / (|r|^2 + softening^2)^(3/2).
+ * Unlike create_newtonian_gravity(), the force stays finite and smooth
+ * as the bodies pass close to each other, with no cutoff,
+ * so close encounters do not need tiny time steps.
+ * The matching potential energy is -G m1 m2 / sqrt(|r|^2 + softening^2).
+ *
+ * @param scene the scene containing the bodies
+ * @param G the gravitational proportionality constant
+ * @param softening the length below which the force is smoothed out
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return the id of the new force, for scene_set_force_enabled()
  */
-void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
-                              body_t *body2);
+size_t create_softened_gravity(scene_t *scene, double G, double softening,
+                               body_t *body1, body_t *body2);
 
 
 /**
- * @brief Adds a force creator to a scene that acts like a buoyancy force  
- * 
- * @param scene 
- * @param G 
- * @param body1 
- * @param p 
- * @param water_level 
+ * Adds one force creator to a scene that applies softened gravity
+ * (see create_softened_gravity()) between every pair of bodies in a group.
+ * This is much cheaper than a force creator per pair: small groups sum over
+ * each pair once, and groups of BARNES_HUT_MIN_BODIES or more use a quadtree
+ * (see quadtree.h), which takes O(n log n) time instead of O(n^2).
+ * Bodies removed from the scene are dropped from the group.
+ *
+ * @param scene the scene containing the bodies
+ * @param G the gravitational proportionality constant
+ * @param softening the Plummer softening length; should be positive
+ *   unless bodies never get close
+ * @param theta the Barnes-Hut opening angle: groups of bodies whose width
+ *   divided by their distance is below this act as one mass.
+ *   0.5 is typical; smaller is more accurate but slower.
+ * @param bodies the bodies in the group, which must have finite masses.
+ *   The list is copied and does not need to outlive this call.
+ * @return the id of the new force, for scene_set_force_enabled()
  */
-void create_buoyancy(scene_t *scene, double G, body_t *body1, double p, double water_level);
+size_t create_nbody_gravity(scene_t *scene, double G, double softening,
+                            double theta, list_t *bodies);
+
+/**
+ * Adds one force creator to a scene that applies exact softened gravity
+ * between every pair of bodies in a group. Gives the same forces as
+ * create_softened_gravity() on every pair, but copies the bodies into
+ * contiguous arrays and computes each pair once with a tiled, vectorized
+ * kernel (see pairwise.h), split across threads for large groups.
+ * Use create_nbody_gravity() instead when an approximation is good enough.
+ * Bodies removed from the scene are dropped from the group.
+ *
+ * @param scene the scene containing the bodies
+ * @param G the gravitational proportionality constant
+ * @param softening the Plummer softening length
+ * @param bodies the bodies in the group. The list is copied.
+ * @return the id of the new force, for scene_set_force_enabled()
+ */
+size_t create_pairwise_gravity(scene_t *scene, double G, double softening,
+                               list_t *bodies);
+
+/**
+ * Adds one force creator to a scene that applies Coulomb's law between
+ * every pair of bodies in a group: k q1 q2 / (|r|^2 + softening^2) in size,
+ * pushing bodies whose charges have the same sign apart
+ * and pulling opposite charges together.
+ * Charges are set with body_set_charge(). Computed like
+ * create_pairwise_gravity().
+ *
+ * @param scene the scene containing the bodies
+ * @param k the Coulomb constant
+ * @param softening the Plummer softening length
+ * @param bodies the bodies in the group. The list is copied.
+ * @return the id of the new force, for scene_set_force_enabled()
+ */
+size_t create_coulomb_force(scene_t *scene, double k, double softening,
+                            list_t *bodies);
+
+/**
+ * Adds a force creator to a scene that pushes a group of floating bodies up
+ * out of water, with a force equal to the weight of the water they displace:
+ * density * g * (area below the surface).
+ * Under each body, the surface is taken to be flat at its average height
+ * there (see water_get_mean_height()), so bodies ride up and down on waves.
+ * The submerged area is found exactly by clipping each body's polygon against
+ * the surface (see polygon_clip_below()), for every body in one pass
+ * and without allocating memory.
+ * Bodies removed from the scene are dropped from the group.
+ *
+ * @param scene the scene containing the bodies
+ * @param density the mass of water per unit area
+ * @param g the strength of gravity, which the force is proportional to
+ * @param water the water's surface. Not freed by the scene, so it must
+ *   outlive the force.
+ * @param bodies the floating bodies. The list is copied.
+ * @param condition if non-NULL, the force only acts on a body
+ *   while this returns true for it
+ * @param aux an auxiliary value to pass to condition. Not freed by the scene.
+ * @return the id of the new force, for scene_set_force_enabled()
+ */
+size_t create_buoyancy(scene_t *scene, double density, double g,
+                       water_t *water, list_t *bodies,
+                       force_condition_t condition, void *aux);
 /**
  * Adds a force creator to a scene that acts like a spring between two bodies.
  * The force creator will be called each tick
@@ -52,8 +325,9 @@ void create_buoyancy(scene_t *scene, double G, body_t *body1, double p, double w
  * @param k the Hooke's constant for the spring
  * @param body1 the first body
  * @param body2 the second body
+ * @return the id of the new force, for scene_set_force_enabled()
  */
-void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2);
+size_t create_spring(scene_t *scene, double k, body_t *body1, body_t *body2);
 
 /**
  * Adds a force creator to a scene that applies a drag force on a body.
@@ -65,8 +339,9 @@ void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2);
  * @param gamma the proportionality constant between force and velocity
  *   (higher gamma means more drag)
  * @param body the body to slow down
+ * @return the id of the new force, for scene_set_force_enabled()
  */
-void create_drag(scene_t *scene, double gamma, body_t *body);
+size_t create_drag(scene_t *scene, double gamma, body_t *body);
 
 /**
  * Adds a force creator to a scene that calls a given collision handler
@@ -82,10 +357,11 @@ void create_drag(scene_t *scene, double gamma, body_t *body);
  * @param handler a function to call whenever the bodies collide
  * @param aux an auxiliary value to pass to the handler
  * @param freer if non-NULL, a function to call in order to free aux
+ * @return the id of the new force, for scene_set_force_enabled()
  */
-void create_collision(scene_t *scene, body_t *body1, body_t *body2,
-                      collision_handler_t handler, void *aux,
-                      free_func_t freer);
+size_t create_collision(scene_t *scene, body_t *body1, body_t *body2,
+                        collision_handler_t handler, void *aux,
+                        free_func_t freer);
 
 /**
  * Adds a force creator to a scene that destroys two bodies when they collide.
@@ -96,8 +372,10 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
  * @param scene the scene containing the bodies
  * @param body1 the first body
  * @param body2 the second body
+ * @return the id of the new force, for scene_set_force_enabled()
  */
-void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2);
+size_t create_destructive_collision(scene_t *scene, body_t *body1,
+                                    body_t *body2);
 
 
 
@@ -108,42 +386,42 @@ void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2);
  * This should be represented as an on-collision callback
  * registered with create_collision().
  *
- * You may remember from project01 that you should avoid applying impulses
- * multiple times while the bodies are still colliding.
- * You should also have a special case that allows either body1 or body2
- * to have mass INFINITY, as this is useful for simulating walls.
+ * The bodies bounce when they start colliding. While they stay in contact,
+ * they are kept from moving into each other, and pushed apart if they
+ * overlap (see forces_resolve_islands()). Bodies that are not dynamic
+ * (see body_set_motion()) are treated as having infinite mass.
  *
  * @param scene the scene containing the bodies
  * @param elasticity the "coefficient of restitution" of the collision;
  * 0 is a perfectly inelastic collision and 1 is a perfectly elastic collision
  * @param body1 the first body
  * @param body2 the second body
+ * @return the id of the new force, for scene_set_force_enabled()
  */
-void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
-                              body_t *body2);
-
-/**
- * @brief apply impulses
- *
- * @param body1
- * @param body2
- * @param axis
- * @param elasticity
- */
-void apply_impulse(body_t *body1, body_t *body2, vector_t axis,
-                   double elasticity);
+size_t create_physics_collision(scene_t *scene, double elasticity,
+                                body_t *body1, body_t *body2);
 
 
 /**
- * @brief Create gravity force specifically for the duck that accounts for water level
- * 
- * @param scene 
- * @param G 
- * @param water_level 
- * @param body1 
- * @param body2 
+ * Adds a force creator to a scene that accelerates a group of bodies
+ * at a constant rate, like gravity near the surface of a planet.
+ * Each body gets a force of its mass times the acceleration,
+ * so no planet body or distance calculation is needed.
+ * Bodies with infinite mass are skipped, and bodies removed from the scene
+ * are dropped from the group.
+ *
+ * @param scene the scene containing the bodies
+ * @param acceleration the acceleration, e.g. (0, -9.8)
+ * @param bodies the bodies to accelerate. The list is copied.
+ * @param condition if non-NULL, the force only acts on a body
+ *   while this returns true for it
+ * @param aux an auxiliary value to pass to condition. Not freed by the scene,
+ *   so it must outlive the force creator.
+ * @return the id of the new force, for scene_set_force_enabled()
  */
-void create_duck_gravity(scene_t *scene, double G, double water_level, body_t *body1, body_t *body2);
+size_t create_uniform_gravity(scene_t *scene, vector_t acceleration,
+                              list_t *bodies, force_condition_t condition,
+                              void *aux);
 
 
 void play_sound(int channel, char *sound_file);
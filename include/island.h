@@ -0,0 +1,94 @@
+#ifndef __ISLAND_H__
+#define __ISLAND_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Contacts between bodies, grouped into islands: sets of bodies connected
+ * through contacts, found with union-find. Bodies that cannot move, such as
+ * walls, do not connect the islands they touch, since nothing one island does
+ * to them reaches the other. Different islands never share a body that moves,
+ * so they can be resolved at the same time.
+ *
+ * Bodies are identified by their slot (see body_set_slot()),
+ * and contacts by any index the caller chooses.
+ */
+typedef struct islands islands_t;
+
+/**
+ * Allocates memory for an empty set of islands.
+ *
+ * @return the new islands
+ */
+islands_t *islands_init(void);
+
+/**
+ * Releases the memory allocated for a set of islands.
+ *
+ * @param islands a pointer returned from islands_init()
+ */
+void islands_free(islands_t *islands);
+
+/**
+ * Removes every contact, putting each body back in an island of its own.
+ *
+ * @param islands a pointer returned from islands_init()
+ * @param num_bodies the number of body slots the next contacts can use
+ */
+void islands_clear(islands_t *islands, size_t num_bodies);
+
+/**
+ * Adds a contact between two bodies, joining their islands.
+ * A contact between two bodies that cannot move is ignored,
+ * since it never needs resolving.
+ *
+ * @param islands a pointer returned from islands_init()
+ * @param contact the index of the contact
+ * @param slot1 the slot of the first body
+ * @param fixed1 whether the first body cannot move
+ * @param slot2 the slot of the second body
+ * @param fixed2 whether the second body cannot move
+ */
+void islands_add_contact(islands_t *islands, size_t contact, size_t slot1,
+                         bool fixed1, size_t slot2, bool fixed2);
+
+/**
+ * Groups the contacts added since islands_clear() by island.
+ * Islands are numbered in the order of their first contacts, and each
+ * island's contacts are kept in the order they were added.
+ *
+ * @param islands a pointer returned from islands_init()
+ * @return the number of islands with at least one contact
+ */
+size_t islands_build(islands_t *islands);
+
+/**
+ * Gets the number of islands found by the last islands_build().
+ *
+ * @param islands a pointer returned from islands_init()
+ * @return the number of islands with at least one contact
+ */
+size_t islands_count(islands_t *islands);
+
+/**
+ * Gets the contacts in an island.
+ *
+ * @param islands a pointer returned from islands_init()
+ * @param island the index of the island, less than islands_count()
+ * @param num_contacts set to the number of contacts in the island
+ * @return the indices of the island's contacts, valid until islands_clear()
+ */
+const size_t *islands_get_contacts(islands_t *islands, size_t island,
+                                   size_t *num_contacts);
+
+/**
+ * Gets the number of bodies in an island that can move.
+ *
+ * @param islands a pointer returned from islands_init()
+ * @param island the index of the island, less than islands_count()
+ * @return the number of bodies that can move in the island
+ */
+size_t islands_get_size(islands_t *islands, size_t island);
+
+#endif // #ifndef __ISLAND_H__
@@ -0,0 +1,138 @@
+#ifndef __JOB_H__
+#define __JOB_H__
+
+#include <stddef.h>
+
+/**
+ * A pool of worker threads shared by everything that runs work in parallel:
+ * force evaluation, all-pairs gravity, asset loading and so on.
+ *
+ * Each worker keeps its own double-ended queue of jobs. It runs the newest job
+ * in its own queue first, which is usually the one whose memory is still in
+ * its cache; when it runs out, it steals the oldest job from another queue.
+ * Threads outside the pool share one more queue.
+ *
+ * Jobs are run in groups, which can be waited for. A thread waiting for a
+ * group runs queued jobs itself until the group is done, so jobs may run and
+ * wait for jobs of their own without tying up the pool. Because of this, a job
+ * that sets thread-local state must put it back before it waits or returns.
+ *
+ * In the browser, and on machines with one core, there are no workers:
+ * every job runs on the thread that starts it, before job_run() returns.
+ */
+
+/**
+ * A function run as a job.
+ * @param aux the auxiliary value passed when the job was started
+ */
+typedef void (*job_func_t)(void *aux);
+
+/**
+ * A function run on part of a range by job_parallel_for().
+ * @param start the first index in the part
+ * @param end one past the last index in the part
+ * @param aux the auxiliary value passed to job_parallel_for()
+ */
+typedef void (*job_range_func_t)(size_t start, size_t end, void *aux);
+
+/**
+ * A set of jobs that can be waited for together.
+ */
+typedef struct job_group job_group_t;
+
+/**
+ * Starts the worker threads. Optional: the first job starts one worker per
+ * CPU core except the calling thread's. Does nothing if the pool is running.
+ *
+ * @param num_workers the number of worker threads, or 0 to decide
+ *   automatically. The threads calling job_group_wait() run jobs too,
+ *   so 1 fewer than the number of cores keeps every core busy.
+ */
+void job_system_init(size_t num_workers);
+
+/**
+ * Runs every job left in the queues, then stops the worker threads.
+ * The pool starts again if more jobs are started.
+ */
+void job_system_shutdown(void);
+
+/**
+ * Gets how many threads can run jobs at once: the workers and
+ * the thread waiting for them. Starts the pool if it is not running.
+ *
+ * @return the number of workers plus 1
+ */
+size_t job_system_threads(void);
+
+/**
+ * Allocates memory for an empty group of jobs.
+ *
+ * @return the new group
+ */
+job_group_t *job_group_init(void);
+
+/**
+ * Waits for a group's jobs to finish, then releases its memory.
+ *
+ * @param group a pointer returned from job_group_init()
+ */
+void job_group_free(job_group_t *group);
+
+/**
+ * Queues a job to run on any thread.
+ *
+ * @param group the group to add the job to
+ * @param func the function to run
+ * @param aux an auxiliary value to pass to func
+ */
+void job_run(job_group_t *group, job_func_t func, void *aux);
+
+/**
+ * Queues a long job, such as decoding a file, to run in the background.
+ * Background jobs are only run by workers with nothing else to do, oldest
+ * first, and never by a thread in job_group_wait(), so a thread waiting for
+ * its own jobs is not held up by someone else's long one. One worker is
+ * always left free for other jobs. Without workers, the job runs on the
+ * calling thread before this returns.
+ *
+ * @param group the group to add the job to
+ * @param func the function to run
+ * @param aux an auxiliary value to pass to func
+ */
+void job_run_background(job_group_t *group, job_func_t func, void *aux);
+
+/**
+ * Queues a job to run once every job in another group has finished,
+ * including jobs added to that group after this call.
+ *
+ * @param group the group to add the job to
+ * @param dependency the group that must finish first
+ * @param func the function to run
+ * @param aux an auxiliary value to pass to func
+ */
+void job_run_after(job_group_t *group, job_group_t *dependency,
+                   job_func_t func, void *aux);
+
+/**
+ * Runs queued jobs until every job in a group has finished.
+ *
+ * @param group a pointer returned from job_group_init()
+ */
+void job_group_wait(job_group_t *group);
+
+/**
+ * Calls a function on every part of the range [0, count) and waits for them.
+ * The range is split in halves until the parts are no larger than the grain
+ * size, and idle threads steal the largest parts left, so uneven work still
+ * spreads evenly.
+ *
+ * @param count the length of the range
+ * @param grain the largest part to hand one call. Should be large enough
+ *   that a part takes at least a few microseconds.
+ * @param func the function to call on each part
+ * @param aux an auxiliary value to pass to func
+ */
+void job_parallel_for(size_t count, size_t grain, job_range_func_t func,
+                      void *aux);
+
+#endif // #ifndef __JOB_H__
@@ -0,0 +1,66 @@
+#ifndef __PACK_H__
+#define __PACK_H__
+
+#include <stdint.h>
+
+/**
+ * The asset pack format, written by tools/pack_assets.c and read by assets.c.
+ *
+ * A pack is a pack_header_t, followed by num_entries pack_entry_t's,
+ * followed by the data of each entry. Each entry's data starts at a multiple
+ * of PACK_ALIGNMENT bytes from the start of the file, so that it can be used
+ * directly once the file is memory-mapped. All numbers are little-endian.
+ *
+ * The data of each kind of entry is:
+ * - PACK_IMAGE: width * height RGBA pixels, 4 bytes each, row by row from the
+ *   top left. If flags has PACK_PREMULTIPLIED, the colors are multiplied by
+ *   the alpha.
+ * - PACK_FONT: an atlas of the printable ASCII characters rendered at
+ *   font_size points. PACK_NUM_GLYPHS pack_glyph_t's (one per character from
+ *   PACK_FIRST_GLYPH), followed by width * height bytes of coverage
+ *   (0 = transparent, 255 = opaque), with every glyph side by side in one row.
+ * - PACK_SOUND: signed 16-bit PCM samples at frequency Hz, with channels
+ *   interleaved.
+ */
+
+// Identifies a pack file
+#define PACK_MAGIC "DUCKPACK"
+#define PACK_VERSION 2
+#define PACK_PATH_LENGTH 120
+#define PACK_ALIGNMENT 16
+#define PACK_FIRST_GLYPH 32
+#define PACK_NUM_GLYPHS 95
+
+typedef enum { PACK_IMAGE, PACK_FONT, PACK_SOUND } pack_kind_t;
+
+// Set in pack_entry_t.flags if an image's colors are premultiplied by alpha
+#define PACK_PREMULTIPLIED 1
+
+typedef struct pack_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_entries;
+} pack_header_t;
+
+typedef struct pack_entry {
+  char path[PACK_PATH_LENGTH]; // the file the entry was made from
+  uint32_t kind;               // a pack_kind_t
+  uint32_t flags;
+  uint64_t offset; // where the data starts, from the start of the pack
+  uint64_t size;   // the length of the data in bytes
+  uint32_t width;  // of the image or atlas, in pixels
+  uint32_t height;
+  uint32_t font_size;
+  uint32_t frequency;
+  uint32_t channels;
+  uint32_t reserved;
+} pack_entry_t;
+
+typedef struct pack_glyph {
+  uint32_t x;       // left edge of the glyph in the atlas
+  uint32_t width;   // of the glyph in the atlas
+  uint32_t advance; // how far the glyph moves the cursor, which can be less
+                    // than its width, so that the next glyph overlaps it
+} pack_glyph_t;
+
+#endif // #ifndef __PACK_H__
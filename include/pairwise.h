@@ -0,0 +1,71 @@
+#ifndef __PAIRWISE_H__
+#define __PAIRWISE_H__
+
+#include <stddef.h>
+
+/**
+ * Point particles stored as parallel arrays, for computing exact
+ * inverse-square forces (gravity or electrostatics) between every pair.
+ * Keeping each coordinate contiguous lets the compiler vectorize the
+ * inner loop, and lets the kernel work through the pairs in cache-sized tiles.
+ *
+ * Fill in x, y and strength for count particles after particles_resize(),
+ * then call particles_pairwise_forces() to fill in force_x and force_y.
+ */
+typedef struct particles {
+  size_t count;
+  double *x;
+  double *y;
+  double *strength; // the mass or charge of each particle
+  double *force_x;  // outputs of particles_pairwise_forces()
+  double *force_y;
+  size_t capacity;
+  // Separate force sums for each thread, so threads never write the same memory
+  double *thread_forces;
+  size_t thread_capacity;
+} particles_t;
+
+/**
+ * Allocates memory for an empty set of particles.
+ *
+ * @return the new particles, with count 0
+ */
+particles_t *particles_init(void);
+
+/**
+ * Releases the memory allocated for a set of particles.
+ *
+ * @param particles a pointer returned from particles_init()
+ */
+void particles_free(particles_t *particles);
+
+/**
+ * Sets the number of particles, growing the arrays if needed.
+ * The values in the arrays are unspecified afterwards.
+ *
+ * @param particles a pointer returned from particles_init()
+ * @param count the new number of particles
+ */
+void particles_resize(particles_t *particles, size_t count);
+
+/**
+ * Computes the force on each particle from every other particle exactly:
+ * coupling * s_i * s_j * r / (|r|^2 + softening^2)^(3/2), where s is the
+ * strength and r points from particle i to particle j.
+ * A positive coupling attracts (gravity: G and masses); a negative one makes
+ * strengths of the same sign repel (Coulomb's law: -k and charges).
+ *
+ * Each pair is computed once and applied to both particles.
+ * With many particles, the work is split across the threads of the job pool
+ * (see job.h), except in the browser, which has none.
+ *
+ * @param particles a pointer returned from particles_init()
+ * @param coupling the signed force constant
+ * @param softening the Plummer softening length. Particles at exactly the same
+ *   position exert no force on each other, even if this is 0.
+ * @param num_threads the most threads to use, or 0 to decide automatically
+ */
+void particles_pairwise_forces(particles_t *particles, double coupling,
+                               double softening, size_t num_threads);
+
+#endif // #ifndef __PAIRWISE_H__
@@ -80,4 +80,43 @@ void polygon_translate(list_t *polygon, vector_t translation);
  */
 void polygon_rotate(list_t *polygon, double angle, vector_t point);
 
+/**
+ * Splits a polygon into triangles by ear clipping.
+ * Works for convex and concave polygons wound in either direction.
+ * Since the triangles are given by vertex index, they stay valid
+ * when the polygon is translated or rotated.
+ *
+ * @param polygon the list of vertices that make up the polygon
+ * @param triangles an array with room for 3 * (list_size(polygon) - 2)
+ *   indices, which is filled with the indices of each triangle's vertices
+ * @return the number of triangles, or 0 if the polygon has under 3 vertices
+ */
+size_t polygon_triangulate(list_t *polygon, size_t *triangles);
+
+/**
+ * Computes the area and centroid of the part of a polygon below a horizontal
+ * line, e.g. the part of a body under water. Clips the polygon against the
+ * line and sums the clipped polygon's area in a single pass over the
+ * vertices, without building the clipped polygon or allocating memory.
+ *
+ * @param polygon the list of vertices that make up the polygon,
+ * wound in either direction
+ * @param level the y coordinate of the line
+ * @param centroid if the area is not 0, set to the centroid of the part
+ *   below the line
+ * @return the area below the line
+ */
+double polygon_clip_below(list_t *polygon, double level, vector_t *centroid);
+
+/**
+ * Computes the width of a convex polygon: the shortest distance between two
+ * parallel lines that hold it, one of which always runs along an edge.
+ * Does not change when the polygon is translated or rotated.
+ *
+ * @param polygon the list of vertices that make up the polygon,
+ * wound in either direction
+ * @return the polygon's width, or 0 if it has under 3 vertices
+ */
+double polygon_width(list_t *polygon);
+
 #endif // #ifndef __POLYGON_H__
@@ -0,0 +1,63 @@
+#ifndef __QUADTREE_H__
+#define __QUADTREE_H__
+
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * A quadtree over a set of point masses, for approximating the gravitational
+ * field of all of them at once (the Barnes-Hut algorithm).
+ * Each node stores the total mass and center of mass of the points in it,
+ * so a far-away node can stand in for all of its points.
+ * The tree keeps its memory between builds, so rebuilding it every tick
+ * does not allocate once it has grown to fit.
+ */
+typedef struct quadtree quadtree_t;
+
+/**
+ * Allocates memory for an empty quadtree.
+ *
+ * @return the new quadtree
+ */
+quadtree_t *quadtree_init(void);
+
+/**
+ * Releases the memory allocated for a quadtree.
+ *
+ * @param tree a pointer to a quadtree returned from quadtree_init()
+ */
+void quadtree_free(quadtree_t *tree);
+
+/**
+ * Rebuilds a quadtree over a set of point masses.
+ * The points are copied, so the arrays may change afterwards.
+ *
+ * @param tree a pointer to a quadtree returned from quadtree_init()
+ * @param positions the position of each point
+ * @param masses the mass of each point, which must be finite
+ * @param num_points the number of points
+ */
+void quadtree_build(quadtree_t *tree, const vector_t *positions,
+                    const double *masses, size_t num_points);
+
+/**
+ * Approximates the gravitational field of the points at a position,
+ * without the gravitational constant:
+ * the sum of m r / (|r|^2 + softening^2)^(3/2) over the points,
+ * where r points from the position to each point.
+ * A point exactly at the position adds nothing.
+ *
+ * A node is treated as a single mass at its center of mass when its width
+ * divided by its distance is less than theta. Smaller values of theta are
+ * more accurate and slower; 0 sums over every point exactly.
+ *
+ * @param tree a pointer to a quadtree built with quadtree_build()
+ * @param position where to find the field
+ * @param theta the opening angle, usually around 0.5
+ * @param softening the Plummer softening length, or 0 for none
+ * @return the field, which times G and a body's mass is the force on it
+ */
+vector_t quadtree_field(quadtree_t *tree, vector_t position, double theta,
+                        double softening);
+
+#endif // #ifndef __QUADTREE_H__
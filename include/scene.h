@@ -29,6 +29,27 @@ scene_type_t *get_curr_scene(scene_t *scene);
  */
 scene_type_t *set_curr_scene(scene_t *scene, scene_type_t *type);
 
+/**
+ * The ways scene_tick() can move bodies according to the forces on them.
+ * Force creators are called once per force evaluation, so they should only
+ * depend on the bodies' positions and velocities.
+ */
+typedef enum {
+  // The default. Updates each body's velocity, then moves it by the average
+  // of its old and new velocities (see body_tick()). One force evaluation.
+  INTEGRATOR_AVERAGE_VELOCITY,
+  // Updates velocity, then moves by the new velocity. First order,
+  // but symplectic, so orbits do not spiral. One force evaluation.
+  INTEGRATOR_SEMI_IMPLICIT_EULER,
+  // Moves half a step, updates velocity, then moves the other half
+  // (position Verlet). Second order and symplectic, so energy errors stay
+  // bounded with larger steps. One force evaluation.
+  INTEGRATOR_LEAPFROG,
+  // Classic fourth-order Runge-Kutta. Most accurate per step, but energy
+  // slowly drifts over long runs. Four force evaluations.
+  INTEGRATOR_RK4
+} integrator_t;
+
 /**
  * A function which adds some forces or impulses to bodies,
  * e.g. from collisions, gravity, or spring forces.
@@ -36,6 +57,11 @@ scene_type_t *set_curr_scene(scene_t *scene, scene_type_t *type);
  */
 typedef void (*force_creator_t)(void *aux);
 
+/**
+ * A force held by a scene, defined in forces.h.
+ */
+typedef struct force force_t;
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
@@ -96,6 +122,50 @@ void scene_remove_body2(scene_t *scene, size_t index);
  */
 void scene_remove_body(scene_t *scene, size_t index);
 
+/**
+ * Adds a force to a scene, to be applied every time scene_tick() is called.
+ * The scene keeps its forces in one array sorted by kind,
+ * so that all forces of a kind are applied together.
+ * Each tick, the built-in forces and thread-safe force creators (see
+ * scene_set_force_thread_safe()) are applied first. Collision handlers and
+ * the other force creators then run in the order they were added, so each
+ * sees the forces applied by those added before it, and by every built-in
+ * force and thread-safe creator.
+ * Forces added while the scene's forces are being applied,
+ * e.g. by a collision handler, start acting on the next tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param force the force, which is copied. Its id is ignored,
+ *   and it starts enabled.
+ * @return the id of the force, for scene_set_force_enabled()
+ */
+size_t scene_add_force(scene_t *scene, const force_t *force);
+
+/**
+ * Turns a force on or off without removing it from the scene.
+ * Does nothing if the force has been removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param id the id returned when the force was added
+ * @param enabled whether the force should act
+ */
+void scene_set_force_enabled(scene_t *scene, size_t id, bool enabled);
+
+/**
+ * Marks a force creator as safe to call on a worker thread
+ * (see scene_set_threads()): it only reads bodies and its own aux value,
+ * and only changes them with body_add_force() and body_add_impulse().
+ * Force creators are not thread-safe until marked, and run on the thread
+ * calling scene_tick() after the other forces. Built-in forces such as
+ * springs and gravity between pairs are always thread-safe.
+ * Does nothing if the force has been removed or is not a force creator.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param id the id returned when the force creator was added
+ * @param thread_safe whether the force creator may run on a worker thread
+ */
+void scene_set_force_thread_safe(scene_t *scene, size_t id, bool thread_safe);
+
 /**
  * Adds a force creator to a scene,
  * to be invoked every time scene_tick() is called.
@@ -105,9 +175,10 @@ void scene_remove_body(scene_t *scene, size_t index);
  * @param forcer a force creator function
  * @param aux an auxiliary value to pass to forcer when it is called
  * @param freer if non-NULL, a function to call in order to free aux
+ * @return the id of the force, for scene_set_force_enabled()
  */
-void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux,
-                             free_func_t freer);
+size_t scene_add_force_creator(scene_t *scene, force_creator_t forcer,
+                               void *aux, free_func_t freer);
 
 /**
  * Adds a force creator to a scene,
@@ -122,22 +193,161 @@ void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux,
  * @param bodies the list of bodies affected by the force creator.
  *   The force creator will be removed if any of these bodies are removed.
  *   This list does not own the bodies, so its freer should be NULL.
+ *   The scene takes ownership of the list.
+ * @param freer if non-NULL, a function to call in order to free aux
+ * @return the id of the force, for scene_set_force_enabled()
+ */
+size_t scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
+                                      void *aux, list_t *bodies,
+                                      free_func_t freer);
+
+/**
+ * Adds a force creator to a scene that acts on a whole group of bodies,
+ * e.g. gravity between every pair of them.
+ * Unlike scene_add_bodies_force_creator(), removing a body from the scene
+ * does not remove the force creator; the body is removed from the group
+ * instead, so the force creator only ever sees bodies still in the scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param group the bodies the force creator acts on, usually also referenced
+ *   by aux. The scene takes ownership of the list, but not the bodies,
+ *   so its freer should be NULL.
  * @param freer if non-NULL, a function to call in order to free aux
+ * @return the id of the force, for scene_set_force_enabled()
  */
-void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
-                                    void *aux, list_t *bodies,
-                                    free_func_t freer);
+size_t scene_add_group_force_creator(scene_t *scene, force_creator_t forcer,
+                                     void *aux, list_t *group,
+                                     free_func_t freer);
 
 /**
  * Executes a tick of a given scene over a small time interval.
- * This requires executing all the force creators
- * and then ticking each body (see body_tick()).
+ * This requires executing all the force creators and then moving each body
+ * with the scene's integrator (see scene_set_integrator()).
+ * Bodies that moved fast enough to pass through a body they collide with
+ * are put back to where they hit it (see forces_find_impacts()), so the
+ * collision is handled next tick. Bodies marked as removed are then freed.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param dt the time elapsed since the last tick, in seconds
  */
 void scene_tick(scene_t *scene, double dt);
 
+/**
+ * Sets how scene_tick() moves the bodies. See integrator_t.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param integrator the integration scheme to use from now on
+ */
+void scene_set_integrator(scene_t *scene, integrator_t integrator);
+
+/**
+ * Lets bodies that have come to rest fall asleep (see body_update_sleep()).
+ * Sleeping bodies are not moved, and pairs of sleeping bodies are not checked
+ * for collisions, so a scene that is mostly at rest costs little to tick.
+ * Walls and other bodies that never move fall asleep the same way.
+ * Forces on a sleeping body are ignored unless they change. It wakes when
+ * an awake body starts to collide with it or pushes into it, when it is
+ * given an impulse, or when its position or velocity is set. Bodies resting
+ * on a sleeping body treat it as fixed. When a sleeping or static body is
+ * placed with a setter, the bodies touching it before or after wake.
+ * Bodies never fall asleep with INTEGRATOR_RK4.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param enabled whether bodies may fall asleep. false (the default)
+ *   wakes every body.
+ */
+void scene_set_sleeping(scene_t *scene, bool enabled);
+
+/**
+ * Sets how many passes the contact solver makes over each group of touching
+ * bodies per tick (see forces_resolve_islands()). More passes let impulses
+ * travel further through stacks and piles, so they jitter and sink less,
+ * at the cost of more time per tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of passes, at least 1. The default is 4.
+ */
+void scene_set_solver_iterations(scene_t *scene, size_t iterations);
+
+/**
+ * Sets how many threads scene_tick() splits the scene's forces across.
+ * Each kind of force is divided evenly between the threads, which add up
+ * their forces separately; the sums are then added to the bodies in a fixed
+ * order, so a scene ticks the same way every run. Checks for collisions are
+ * shared out in small batches instead, since each only writes its own result
+ * and some pairs take much longer than others. Collision handlers, and force
+ * creators not marked with scene_set_force_thread_safe(), then run
+ * one at a time on the calling thread, in the order they were added
+ * (see scene_add_force()).
+ * Scenes with few forces are always applied on one thread, as is every scene
+ * in the browser. The threads come from the shared pool in job.h.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param num_threads the number of threads, 1 (the default) to apply forces
+ *   on the calling thread only, or 0 for as many as the pool has
+ */
+void scene_set_threads(scene_t *scene, size_t num_threads);
+
+/**
+ * Sets the fixed time step used by scene_advance().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param timestep the length of each tick, in seconds
+ * @param max_substeps the most ticks one call to scene_advance() may run.
+ *   Limits how much work a slow frame can cause, at the cost of the
+ *   simulation running slower than real time.
+ */
+void scene_set_timestep(scene_t *scene, double timestep, size_t max_substeps);
+
+/**
+ * Advances a scene by the time that has passed, in ticks of a fixed length
+ * (1/120 s unless changed with scene_set_timestep()). Time left over that is
+ * too short for a full tick carries over to the next call, so the physics
+ * behave the same at any frame rate.
+ *
+ * Each tick saves the bodies' previous positions (see body_save_state()),
+ * so that the renderer can draw the bodies part of the way between their
+ * previous and current positions.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param dt the time elapsed since the last call, in seconds
+ * @return how far the current time is between the last two ticks, from 0 to 1
+ */
+double scene_advance(scene_t *scene, double dt);
+
+/**
+ * Gets how far between the previous and current states of the bodies
+ * the scene should be drawn, as returned by the last scene_advance().
+ * After scene_tick(), this is 1 (the current state).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the interpolation factor, from 0 to 1
+ */
+double scene_get_interpolation(scene_t *scene);
+
+/**
+ * Gets the number of contact islands in the last force evaluation: groups of
+ * bodies that started touching each other, resolved independently of the
+ * other groups. Bodies that cannot move, such as walls, separate islands.
+ * For profiling.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of islands
+ */
+size_t scene_get_num_islands(scene_t *scene);
+
+/**
+ * Gets the number of bodies that can move in one of the contact islands
+ * of the last force evaluation (see scene_get_num_islands()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param index the index of the island, less than scene_get_num_islands()
+ * @return the number of bodies in the island, not counting walls and such
+ */
+size_t scene_get_island_size(scene_t *scene, size_t index);
+
 /**
  * @brief Given a body and scene, finds the index of the body in scene
  *
@@ -145,7 +355,7 @@ void scene_tick(scene_t *scene, double dt);
 int scene_get_index(scene_t *scene, body_t *body);
 
 /**
- * @brief Removes last force from scene
+ * @brief Removes the most recently added force from scene
  * 
  * @param scene 
  */
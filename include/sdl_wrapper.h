@@ -13,6 +13,7 @@
 #include <SDL2/SDL_audio.h>
 #include <SDL2/SDL_mixer.h>
 #include "sdl_wrapper.h"
+#include "assets.h"
 #include "body.h"
 #include "list.h"
 #include "scene.h"
@@ -30,6 +31,12 @@ typedef enum {
   BUTTON_RIGHT = 7
 } arrow_key_t;
 
+// File formats that frames can be saved in by sdl_save_frame()
+typedef enum {
+  FRAME_PNG, // a PNG image
+  FRAME_RAW  // RGBA bytes, one row after another from the top left, no header
+} frame_format_t;
+
 
 /**
  * The possible types of key events.
@@ -110,18 +117,173 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color);
 /**
  * Displays the rendered frame on the SDL window.
  * Must be called after drawing the polygons in order to show them.
+ * When rendering on a separate thread, this instead hands the frame
+ * to the render thread and returns without waiting for it to be drawn.
  */
 void sdl_show(void);
 
 /**
  * Draws all bodies in a scene.
- * This internally calls sdl_clear(), sdl_draw_polygon(), and sdl_show(),
- * so those functions should not be called directly.
+ * This internally calls sdl_clear() and draws each body,
+ * so sdl_clear() and sdl_draw_polygon() should not be called directly.
+ * Call sdl_show() afterwards to display the frame.
+ *
+ * The bodies are first copied into a frame snapshot. When rendering on a
+ * separate thread (see sdl_run_threaded()), only the copy is made here and
+ * the snapshot is drawn by the render thread once sdl_show() publishes it,
+ * so the scene may be modified as soon as this returns.
  *
  * @param scene the scene to draw
  */
 void sdl_render_scene(scene_t *scene);
 
+/**
+ * Draws a line of text as part of the current frame.
+ * Unlike sdl_make_text() and sdl_render_text(), this also works when
+ * rendering on a separate thread. Call after sdl_render_scene().
+ *
+ * @param string the text to draw; may be freed once this returns
+ * @param font the font to render the text with, from assets_get_font()
+ * @param color the color of the text
+ * @param position the top left corner of the text, measured from the
+ *   bottom left of the window
+ * @param size the width and height to stretch the text to, in pixels
+ */
+void sdl_draw_text(char *string, font_t *font, rgb_color_t color,
+                   vector_t position, vector_t size);
+
+/**
+ * Runs a simulation on a separate thread while the calling thread renders.
+ * The simulation should call the sdl_* functions as usual; each frame it
+ * passes to sdl_render_scene() and sdl_show() is handed to the calling
+ * thread, which draws the most recent one and presents it in step with
+ * the display, so slow frames no longer stall the simulation and vice versa.
+ * Must be called from the main thread, which also handles window events.
+ * Does nothing useful in the browser, which has no threads.
+ *
+ * @param simulate the simulation loop, which should return once it is done
+ * @param aux the argument to pass to simulate
+ */
+void sdl_run_threaded(SDL_ThreadFunction simulate, void *aux);
+
+/**
+ * Draws every frame into an offscreen surface with SDL's software renderer
+ * instead of a window, using the dummy video and audio drivers,
+ * so the demos can run without a display (e.g. for benchmarks).
+ * Rendering goes through the same functions as usual.
+ * Also makes every frame redraw and time_since_last_tick() report a fixed
+ * 60 FPS time step. Runs are then reproducible as long as the demo seeds
+ * with sdl_random_seed() and any input comes from sdl_play_input().
+ * Must be called before sdl_init().
+ */
+void sdl_enable_headless(void);
+
+/**
+ * Returns whether sdl_enable_headless() has been called.
+ *
+ * @return true if frames are drawn offscreen
+ */
+bool sdl_is_headless(void);
+
+/**
+ * Writes the last frame presented by sdl_show() to a file.
+ * Only available in headless mode.
+ *
+ * @param path the file to write
+ * @param format the format to write the frame in
+ * @return true if the frame was written
+ */
+bool sdl_save_frame(const char *path, frame_format_t format);
+
+/**
+ * Writes every frame presented from now on to a numbered file
+ * (frame_00000.png, frame_00001.png, ... or .rgba for raw frames).
+ * Only available in headless mode. When rendering on a separate thread,
+ * frames that the render thread skips are not written.
+ *
+ * @param directory an existing directory to write the frames to,
+ *   or NULL to stop dumping frames
+ * @param format the format to write the frames in
+ */
+void sdl_dump_frames(const char *directory, frame_format_t format);
+
+/**
+ * Gets the number of frames that have been put on screen
+ * (or drawn offscreen, in headless mode).
+ *
+ * @return the number of frames presented so far
+ */
+size_t sdl_frames_presented(void);
+
+/**
+ * Replays input from a script, so that headless runs can play through a demo
+ * the same way every time. Each line of the script is one event:
+ *
+ * ```
+ * # <frame> key_down|key_repeat|key_up <key>
+ * 30 key_down up
+ * 31 key_up up
+ * # <frame> mouse_down|mouse_up left|right <x> <y>, in window pixels
+ * 90 mouse_down left 150 400
+ * # <frame> quit
+ * 600 quit
+ * ```
+ *
+ * Keys are left, up, right, down, space, or a single character. An event is
+ * handled by the given call to sdl_is_done(), counting from 0, through the
+ * same handlers as real input. Lines starting with # are ignored, and frames
+ * must not decrease from one line to the next.
+ *
+ * @param path the script to read
+ * @return true if the script was read; otherwise an error is printed
+ *   and no input is replayed
+ */
+bool sdl_play_input(const char *path);
+
+/**
+ * Makes sdl_random_seed() return the given seed from now on,
+ * so that demos generate the same scenes on every run.
+ *
+ * @param seed the seed to use
+ */
+void sdl_set_random_seed(unsigned seed);
+
+/**
+ * Gets the seed demos should pass to srand(): the one given to
+ * sdl_set_random_seed(), or else the current time.
+ *
+ * @return the random seed
+ */
+unsigned sdl_random_seed(void);
+
+/**
+ * Forces the static layer (see body_set_static_layer()) to be redrawn
+ * on the next call to sdl_render_scene().
+ * Only needed when a static body is changed without its setters, e.g. by
+ * editing the points of its shape directly; everything else is detected
+ * automatically (see body_get_static_layer_generation()).
+ */
+void sdl_invalidate_static_layer(void);
+
+/**
+ * Returns whether the next frame could differ from the one last shown.
+ * This is false only when the scene consists entirely of static layer bodies,
+ * the static layer is up to date and no input has arrived since sdl_show(),
+ * in which case the caller can skip rendering the frame entirely.
+ *
+ * @param scene the scene that would be drawn
+ * @return true if the frame should be rendered
+ */
+bool sdl_needs_redraw(scene_t *scene);
+
+/**
+ * Blocks until an input event arrives or the timeout elapses.
+ * Used to idle while sdl_needs_redraw() is false. Does nothing in the browser.
+ *
+ * @param timeout_ms the maximum number of milliseconds to wait
+ */
+void sdl_wait_for_input(uint32_t timeout_ms);
+
 /**
  * Registers a function to be called every time a key is pressed.
  * Overwrites any existing handler.
@@ -155,7 +317,8 @@ void sdl_on_mouse(mouse_handler_t handler);
 
 /**
  * Gets the amount of time that has passed since the last time
- * this function was called, in seconds.
+ * this function was called, in seconds, measured with a monotonic
+ * high-resolution clock. Pass it to scene_advance().
  *
  * @return the number of seconds that have elapsed
  */
@@ -170,17 +333,56 @@ void sdl_at_scene(void *scene);
 
 void sdl_render_image(char *image_info_path, body_t *bod);
 
+/**
+ * Destroys every image texture loaded by sdl_render_image(), e.g. before
+ * exiting. Must be called on the thread that draws.
+ */
+void sdl_free_images(void);
+
 SDL_Texture *sdl_make_text(char *string, TTF_Font *font, rgb_color_t color);
 
 void sdl_render_text(SDL_Texture *textTexture, vector_t position, vector_t size);
 
+/**
+ * Opens the audio device, if it is not open already.
+ *
+ * @return true if the audio device is open
+ */
+bool sdl_open_audio(void);
+
+/**
+ * Registers a sound effect so that it can be played with sdl_play_sound().
+ * Opens the audio device the first time it is called.
+ * The sound is taken from the asset manager (see assets_preload()) once it
+ * has been decoded, and until then sdl_play_sound() skips it.
+ * Sounds that were not preloaded are decoded straight away.
+ *
+ * @param path the WAV (or other format supported by SDL_mixer) file to load
+ * @return the id to pass to sdl_play_sound(), or -1 if there is no audio
+ */
+int sdl_load_sound(const char *path);
+
+/**
+ * Plays a sound effect loaded by sdl_load_sound().
+ * The sound starts when the current frame is shown, on its own mixer channel,
+ * so it overlaps other sounds instead of cutting them off. If every channel
+ * is busy, the sound that has played the longest is stopped to make room.
+ * Never blocks, so it is safe to call from collision handlers.
+ *
+ * @param sound the id returned by sdl_load_sound()
+ */
+void sdl_play_sound(int sound);
 
+// Plays the sound loaded by sound_init()
 void play_coin();
 
+// Plays the sound loaded by splash_init()
 void play_splash();
 
+// Loads the coin sound
 void sound_init();
 
+// Loads the splash sound
 void splash_init();
 
 
@@ -0,0 +1,101 @@
+#ifndef __WATER_H__
+#define __WATER_H__
+
+#include "list.h"
+#include <stddef.h>
+
+/**
+ * The surface of a stretch of water, simulated as a height field:
+ * the height of the surface at evenly spaced columns, which move under the
+ * damped wave equation. Waves travel along the surface, reflect off its ends
+ * and die down, and the surface slowly settles back to its rest level.
+ */
+typedef struct water water_t;
+
+/**
+ * Allocates memory for a flat water surface at its rest level.
+ *
+ * @param left the x coordinate of the left end of the water
+ * @param right the x coordinate of the right end of the water
+ * @param num_columns the number of columns to simulate the surface with
+ * @param rest_level the y coordinate of the surface when it is still
+ * @param wave_speed how fast waves travel along the surface
+ * @param damping how quickly waves die down, as a fraction of the surface's
+ *   vertical velocity lost per second
+ * @return a pointer to the newly allocated water
+ */
+water_t *water_init(double left, double right, size_t num_columns,
+                    double rest_level, double wave_speed, double damping);
+
+/**
+ * Makes a water surface flat and still at its rest level again,
+ * e.g. when a new game starts.
+ *
+ * @param water a pointer returned from water_init()
+ */
+void water_reset(water_t *water);
+
+/**
+ * Releases the memory allocated for a water surface.
+ *
+ * @param water a pointer returned from water_init()
+ */
+void water_free(water_t *water);
+
+/**
+ * Moves the surface forward in time.
+ * Large time steps are split into as many smaller steps
+ * as the wave speed needs to stay stable.
+ *
+ * @param water a pointer returned from water_init()
+ * @param dt the number of seconds elapsed
+ */
+void water_tick(water_t *water, double dt);
+
+/**
+ * Gets the height of the surface at a point, interpolated between columns.
+ * Beyond the ends of the water, the height at the nearest end is used.
+ *
+ * @param water a pointer returned from water_init()
+ * @param x the x coordinate to sample the surface at
+ * @return the y coordinate of the surface
+ */
+double water_get_height(water_t *water, double x);
+
+/**
+ * Gets the average height of the surface over a range of x coordinates,
+ * e.g. under a floating body.
+ *
+ * @param water a pointer returned from water_init()
+ * @param left the x coordinate of the left end of the range
+ * @param right the x coordinate of the right end of the range
+ * @return the average y coordinate of the surface
+ */
+double water_get_mean_height(water_t *water, double left, double right);
+
+/**
+ * Splashes the water a body pushes out of its way as it sinks through the
+ * surface: the water beside it rises, starting waves spreading out from the
+ * body. Does nothing unless the body is moving down and its polygon crosses
+ * the surface, so a body only splashes as it goes in.
+ *
+ * @param water a pointer returned from water_init()
+ * @param polygon the list of vertices that make up the body
+ * @param velocity the body's vertical velocity, negative if sinking
+ * @param dt the number of seconds the body has been moving for,
+ *   usually the same as passed to the next water_tick()
+ */
+void water_disturb(water_t *water, list_t *polygon, double velocity,
+                   double dt);
+
+/**
+ * Builds a polygon covering the water from its surface down to a given depth,
+ * for drawing the water. The surface has a vertex at each column.
+ *
+ * @param water a pointer returned from water_init()
+ * @param bottom the y coordinate of the bottom of the polygon
+ * @return a new counterclockwise list of vertices, which the caller owns
+ */
+list_t *water_get_polygon(water_t *water, double bottom);
+
+#endif // #ifndef __WATER_H__
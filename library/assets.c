@@ -0,0 +1,690 @@
+#include "assets.h"
+#include "job.h"
+#include "pack.h"
+#include "sdl_wrapper.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <SDL2/SDL_image.h>
+#ifndef __EMSCRIPTEN__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Longest line read from the manifest
+#define MAX_MANIFEST_LINE 1024
+const size_t INITIAL_ASSET_COUNT = 16;
+
+typedef enum { ASSET_IMAGE, ASSET_FONT, ASSET_SOUND, ASSET_OTHER } asset_kind_t;
+
+typedef enum {
+  ASSET_PENDING, // no thread has started loading the asset
+  ASSET_LOADING,
+  ASSET_LOADED,
+  ASSET_FAILED
+} asset_state_t;
+
+/**
+ * A file listed in the manifest, and what it was loaded into.
+ * Only the thread that loads an asset may touch it while it is ASSET_LOADING;
+ * the other fields are guarded by asset_lock.
+ */
+typedef struct asset {
+  char *path;
+  asset_kind_t kind;
+  asset_state_t state;
+  SDL_Surface *image;
+  void *font_data; // contents of the font file, kept for as long as it is open
+  size_t font_size;
+  Mix_Chunk *sound;
+  bool taken; // whether the image or sound has been handed out
+  double load_ms;
+} asset_t;
+
+typedef struct font {
+  char *path;
+  int size;
+  TTF_Font *ttf;              // NULL if the font comes from the pack
+  const pack_entry_t *atlas;  // NULL if the font was opened from a TTF file
+} font_t;
+
+const char *ASSET_KIND_NAMES[] = {"image", "font", "sound", "other"};
+
+asset_t *assets = NULL;
+size_t num_assets = 0;
+/**
+ * Assets before this index are no longer pending.
+ */
+size_t next_asset = 0;
+/**
+ * The number of assets that have finished loading (or failed to).
+ */
+size_t assets_finished = 0;
+/**
+ * Guards the state of every asset, next_asset and assets_finished.
+ */
+SDL_mutex *asset_lock = NULL;
+/**
+ * Signalled whenever an asset finishes loading.
+ */
+SDL_cond *asset_loaded = NULL;
+/**
+ * Whether assets are loaded by background jobs on the job pool's workers,
+ * rather than one per frame
+ */
+bool loading_in_background = false;
+/**
+ * The jobs loading assets, one per asset. Never waited for: the game waits
+ * for each asset it needs on asset_loaded instead.
+ */
+job_group_t *asset_jobs = NULL;
+/**
+ * Fonts opened so far. Only used by the thread that draws text.
+ */
+font_t **fonts = NULL;
+size_t num_fonts = 0;
+
+/**
+ * The memory-mapped asset pack, if assets_load_pack() was called.
+ */
+const uint8_t *pack = NULL;
+size_t pack_size = 0;
+const pack_entry_t *pack_entries = NULL;
+size_t num_pack_entries = 0;
+/**
+ * Whether each image in the pack has been handed out. Guarded by asset_lock.
+ */
+bool *pack_taken = NULL;
+
+/**
+ * Startup timings, in milliseconds since assets_preload() was called.
+ */
+uint64_t preload_start = 0;
+// What assets were read from: "manifest" or "pack"
+const char *asset_source = "manifest";
+double manifest_ms = 0;
+double all_loaded_ms = -1;
+double first_frame_ms = -1;
+bool report_printed = false;
+
+/** Milliseconds since assets_preload() was called */
+double ms_since_preload(void) {
+  return (SDL_GetPerformanceCounter() - preload_start) * 1e3 /
+         SDL_GetPerformanceFrequency();
+}
+
+/** Guesses what kind of asset a file is from its extension */
+asset_kind_t get_asset_kind(const char *path) {
+  const char *extension = strrchr(path, '.');
+  if (extension == NULL) {
+    return ASSET_OTHER;
+  }
+  if (strcasecmp(extension, ".png") == 0) {
+    return ASSET_IMAGE;
+  }
+  if (strcasecmp(extension, ".ttf") == 0) {
+    return ASSET_FONT;
+  }
+  if (strcasecmp(extension, ".wav") == 0) {
+    return ASSET_SOUND;
+  }
+  return ASSET_OTHER;
+}
+
+/** Adds every file listed in the manifest to assets */
+void read_manifest(const char *manifest_path) {
+  FILE *manifest = fopen(manifest_path, "r");
+  if (manifest == NULL) {
+    fprintf(stderr, "Could not open asset manifest %s\n", manifest_path);
+    return;
+  }
+  size_t capacity = INITIAL_ASSET_COUNT;
+  assets = malloc(sizeof(*assets) * capacity);
+  assert(assets != NULL);
+  char line[MAX_MANIFEST_LINE];
+  while (fgets(line, sizeof(line), manifest) != NULL) {
+    line[strcspn(line, " \t\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    if (num_assets == capacity) {
+      capacity *= 2;
+      assets = realloc(assets, sizeof(*assets) * capacity);
+      assert(assets != NULL);
+    }
+    char *path = malloc(strlen(line) + 1);
+    assert(path != NULL);
+    strcpy(path, line);
+    assets[num_assets++] = (asset_t){.path = path,
+                                     .kind = get_asset_kind(path),
+                                     .state = ASSET_PENDING};
+  }
+  fclose(manifest);
+}
+
+/** Loads one asset. Called without holding asset_lock. */
+void load_asset(asset_t *asset) {
+  uint64_t start = SDL_GetPerformanceCounter();
+  bool loaded = true;
+  switch (asset->kind) {
+  case ASSET_IMAGE:
+    asset->image = IMG_Load(asset->path);
+    loaded = asset->image != NULL;
+    break;
+  case ASSET_FONT:
+    // FreeType is not thread safe, so fonts are only read here
+    // and opened by assets_get_font()
+    asset->font_data = SDL_LoadFile(asset->path, &asset->font_size);
+    loaded = asset->font_data != NULL;
+    break;
+  case ASSET_SOUND:
+    asset->sound = Mix_LoadWAV(asset->path);
+    loaded = asset->sound != NULL;
+    break;
+  case ASSET_OTHER:
+    break;
+  }
+  asset->load_ms = (SDL_GetPerformanceCounter() - start) * 1e3 /
+                   SDL_GetPerformanceFrequency();
+  if (!loaded) {
+    fprintf(stderr, "Could not load asset %s\n", asset->path);
+  }
+
+  SDL_LockMutex(asset_lock);
+  asset->state = loaded ? ASSET_LOADED : ASSET_FAILED;
+  assets_finished++;
+  if (assets_finished == num_assets) {
+    all_loaded_ms = ms_since_preload();
+  }
+  SDL_CondBroadcast(asset_loaded);
+  SDL_UnlockMutex(asset_lock);
+}
+
+/**
+ * Marks the next pending asset as loading and returns it,
+ * or returns NULL if none are left. Must hold asset_lock.
+ */
+asset_t *claim_next_asset(void) {
+  while (next_asset < num_assets && assets[next_asset].state != ASSET_PENDING) {
+    next_asset++;
+  }
+  if (next_asset == num_assets) {
+    return NULL;
+  }
+  asset_t *asset = &assets[next_asset++];
+  asset->state = ASSET_LOADING;
+  return asset;
+}
+
+/**
+ * Loads the next pending asset, if the game has not already loaded it.
+ * Each job loads one asset, so no job runs for the whole manifest.
+ */
+void asset_job(void *aux) {
+  SDL_LockMutex(asset_lock);
+  asset_t *asset = claim_next_asset();
+  SDL_UnlockMutex(asset_lock);
+  if (asset != NULL) {
+    load_asset(asset);
+  }
+}
+
+/** Creates the lock and condition variable shared by the loading threads */
+void start_preload(void) {
+  // assets_preload() may be called after assets_load_pack() fails
+  if (asset_lock != NULL) {
+    return;
+  }
+  preload_start = SDL_GetPerformanceCounter();
+  asset_lock = SDL_CreateMutex();
+  asset_loaded = SDL_CreateCond();
+}
+
+void assets_preload(const char *manifest_path) {
+  start_preload();
+  // Sounds are converted to the device's format as they are decoded
+  sdl_open_audio();
+  read_manifest(manifest_path);
+  manifest_ms = ms_since_preload();
+  if (num_assets == 0) {
+    all_loaded_ms = manifest_ms;
+  }
+
+  // Only on the workers, in the background so that the game's own jobs
+  // never wait behind them: this thread goes on to draw the first frames.
+  // In the browser there are no workers.
+  loading_in_background = job_system_threads() > 1 && num_assets > 0;
+  if (!loading_in_background) {
+    return;
+  }
+  asset_jobs = job_group_init();
+  for (size_t i = 0; i < num_assets; i++) {
+    job_run_background(asset_jobs, asset_job, NULL);
+  }
+}
+
+/**
+ * Checks that an entry's data lies inside the pack, and that everything the
+ * loader reads for its kind (see pack.h) lies inside the entry's data
+ */
+bool is_valid_pack_entry(const pack_entry_t *entry, const uint8_t *data,
+                         size_t size) {
+  if (entry->offset > size || entry->size > size - entry->offset ||
+      entry->offset % PACK_ALIGNMENT != 0 ||
+      memchr(entry->path, '\0', PACK_PATH_LENGTH) == NULL) {
+    return false;
+  }
+  // Widths and heights have 32 bits, so their product cannot overflow
+  uint64_t num_pixels = (uint64_t)entry->width * entry->height;
+  switch (entry->kind) {
+  case PACK_IMAGE:
+    return num_pixels * 4 <= entry->size;
+  case PACK_FONT: {
+    uint64_t glyphs_size = PACK_NUM_GLYPHS * sizeof(pack_glyph_t);
+    if (glyphs_size + num_pixels > entry->size) {
+      return false;
+    }
+    const pack_glyph_t *glyphs = (const pack_glyph_t *)(data + entry->offset);
+    for (size_t i = 0; i < PACK_NUM_GLYPHS; i++) {
+      if ((uint64_t)glyphs[i].x + glyphs[i].width > entry->width) {
+        return false;
+      }
+    }
+    return true;
+  }
+  case PACK_SOUND:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/** Checks that a mapped file is a pack whose index and data fit inside it */
+bool is_valid_pack(const uint8_t *data, size_t size) {
+  if (size < sizeof(pack_header_t)) {
+    return false;
+  }
+  const pack_header_t *header = (const pack_header_t *)data;
+  if (memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != PACK_VERSION ||
+      header->num_entries >
+          (size - sizeof(*header)) / sizeof(pack_entry_t)) {
+    return false;
+  }
+  const pack_entry_t *entries = (const pack_entry_t *)(header + 1);
+  for (uint32_t i = 0; i < header->num_entries; i++) {
+    if (!is_valid_pack_entry(&entries[i], data, size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Maps a whole file into memory, read-only, or returns NULL if it cannot be.
+ * The browser's in-memory file system has no pages to share,
+ * so there the file is read into memory instead.
+ */
+void *map_file(const char *path, size_t *size) {
+#ifdef __EMSCRIPTEN__
+  return SDL_LoadFile(path, size);
+#else
+  int file = open(path, O_RDONLY);
+  if (file < 0) {
+    return NULL;
+  }
+  struct stat info;
+  void *data = MAP_FAILED;
+  if (fstat(file, &info) == 0 && info.st_size > 0) {
+    data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  }
+  close(file);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  *size = info.st_size;
+  return data;
+#endif
+}
+
+/** Releases a file mapped by map_file() */
+void unmap_file(void *data, size_t size) {
+#ifdef __EMSCRIPTEN__
+  SDL_free(data);
+#else
+  munmap(data, size);
+#endif
+}
+
+bool assets_load_pack(const char *pack_path) {
+  start_preload();
+  sdl_open_audio();
+
+  // The pack is the only file opened; everything else points into it
+  size_t size;
+  void *data = map_file(pack_path, &size);
+  if (data == NULL) {
+    return false;
+  }
+  if (!is_valid_pack(data, size)) {
+    fprintf(stderr, "Invalid asset pack %s\n", pack_path);
+    unmap_file(data, size);
+    return false;
+  }
+
+  asset_source = "pack";
+  pack = data;
+  pack_size = size;
+  pack_entries = (const pack_entry_t *)(pack + sizeof(pack_header_t));
+  num_pack_entries = ((const pack_header_t *)pack)->num_entries;
+  pack_taken = calloc(num_pack_entries, sizeof(*pack_taken));
+  assert(pack_taken != NULL);
+  manifest_ms = ms_since_preload();
+  all_loaded_ms = manifest_ms;
+  return true;
+}
+
+/**
+ * Finds an entry of the asset pack by path and kind, and for fonts, size.
+ * Returns its index, or -1 if it is not in the pack.
+ */
+int find_pack_entry(const char *path, pack_kind_t kind, int font_size) {
+  for (size_t i = 0; i < num_pack_entries; i++) {
+    const pack_entry_t *entry = &pack_entries[i];
+    if (entry->kind == kind && strcmp(entry->path, path) == 0 &&
+        (kind != PACK_FONT || entry->font_size == (uint32_t)font_size)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/** Wraps the pixels of a packed image in a surface, without copying them */
+SDL_Surface *get_pack_image(size_t index, bool *premultiplied) {
+  const pack_entry_t *entry = &pack_entries[index];
+  *premultiplied = entry->flags & PACK_PREMULTIPLIED;
+  return SDL_CreateRGBSurfaceWithFormatFrom(
+      (void *)(pack + entry->offset), entry->width, entry->height, 32,
+      entry->width * 4, SDL_PIXELFORMAT_RGBA32);
+}
+
+/** Finds an asset by path, or returns NULL if it is not in the manifest */
+asset_t *find_asset(const char *path) {
+  for (size_t i = 0; i < num_assets; i++) {
+    if (strcmp(assets[i].path, path) == 0) {
+      return &assets[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Finds an asset by path and waits until it has finished loading.
+ * If no thread has started loading it yet, loads it on this thread.
+ * Returns NULL if the asset is not in the manifest.
+ */
+asset_t *wait_for_asset(const char *path) {
+  asset_t *asset = find_asset(path);
+  if (asset == NULL) {
+    return NULL;
+  }
+
+  SDL_LockMutex(asset_lock);
+  if (asset->state == ASSET_PENDING) {
+    asset->state = ASSET_LOADING;
+    SDL_UnlockMutex(asset_lock);
+    load_asset(asset);
+    SDL_LockMutex(asset_lock);
+  }
+  while (asset->state == ASSET_LOADING) {
+    SDL_CondWait(asset_loaded, asset_lock);
+  }
+  SDL_UnlockMutex(asset_lock);
+  return asset;
+}
+
+SDL_Surface *assets_take_image(const char **path, bool *premultiplied) {
+  if (asset_lock == NULL) {
+    return NULL;
+  }
+  SDL_Surface *image = NULL;
+  SDL_LockMutex(asset_lock);
+  for (size_t i = 0; i < num_pack_entries && image == NULL; i++) {
+    if (pack_entries[i].kind == PACK_IMAGE && !pack_taken[i]) {
+      pack_taken[i] = true;
+      image = get_pack_image(i, premultiplied);
+      *path = pack_entries[i].path;
+    }
+  }
+  for (size_t i = 0; i < num_assets && image == NULL; i++) {
+    asset_t *asset = &assets[i];
+    if (asset->kind == ASSET_IMAGE && asset->state == ASSET_LOADED &&
+        !asset->taken) {
+      asset->taken = true;
+      image = asset->image;
+      *path = asset->path;
+      *premultiplied = false;
+    }
+  }
+  SDL_UnlockMutex(asset_lock);
+  return image;
+}
+
+/**
+ * Hands out the image or sound of an asset the first time it is requested.
+ */
+void *take_asset(asset_t *asset, void *loaded) {
+  SDL_LockMutex(asset_lock);
+  if (asset->taken || asset->state != ASSET_LOADED) {
+    loaded = NULL;
+  }
+  asset->taken = true;
+  SDL_UnlockMutex(asset_lock);
+  return loaded;
+}
+
+SDL_Surface *assets_get_image(const char *path, bool *premultiplied) {
+  *premultiplied = false;
+  int index = find_pack_entry(path, PACK_IMAGE, 0);
+  if (index >= 0) {
+    SDL_LockMutex(asset_lock);
+    bool taken = pack_taken[index];
+    pack_taken[index] = true;
+    SDL_UnlockMutex(asset_lock);
+    return taken ? NULL : get_pack_image(index, premultiplied);
+  }
+  asset_t *asset = wait_for_asset(path);
+  return asset == NULL ? NULL : take_asset(asset, asset->image);
+}
+
+/**
+ * Wraps the samples of a packed sound in a chunk, without copying them,
+ * or returns NULL if the sound is not in the pack.
+ */
+Mix_Chunk *get_pack_sound(const char *path) {
+  // Packed samples can only be played as they are if the device matches them
+  int index = find_pack_entry(path, PACK_SOUND, 0);
+  int frequency, channels;
+  Uint16 format;
+  if (index >= 0 && Mix_QuerySpec(&frequency, &format, &channels) != 0) {
+    const pack_entry_t *entry = &pack_entries[index];
+    if (frequency == (int)entry->frequency && format == AUDIO_S16LSB &&
+        channels == (int)entry->channels) {
+      return Mix_QuickLoad_RAW((Uint8 *)(pack + entry->offset), entry->size);
+    }
+  }
+  return NULL;
+}
+
+Mix_Chunk *assets_get_sound(const char *path) {
+  Mix_Chunk *sound = get_pack_sound(path);
+  if (sound != NULL) {
+    return sound;
+  }
+  asset_t *asset = wait_for_asset(path);
+  return asset == NULL ? NULL : take_asset(asset, asset->sound);
+}
+
+Mix_Chunk *assets_poll_sound(const char *path, bool *pending) {
+  *pending = false;
+  Mix_Chunk *sound = get_pack_sound(path);
+  asset_t *asset = sound == NULL ? find_asset(path) : NULL;
+  if (asset == NULL) {
+    return sound;
+  }
+  SDL_LockMutex(asset_lock);
+  *pending = asset->state == ASSET_PENDING || asset->state == ASSET_LOADING;
+  SDL_UnlockMutex(asset_lock);
+  return *pending ? NULL : take_asset(asset, asset->sound);
+}
+
+font_t *assets_get_font(const char *path, int size) {
+  for (size_t i = 0; i < num_fonts; i++) {
+    if (fonts[i]->size == size && strcmp(fonts[i]->path, path) == 0) {
+      return fonts[i];
+    }
+  }
+
+  TTF_Font *ttf = NULL;
+  const pack_entry_t *atlas = NULL;
+  int index = find_pack_entry(path, PACK_FONT, size);
+  if (index >= 0) {
+    atlas = &pack_entries[index];
+  } else {
+    asset_t *asset = wait_for_asset(path);
+    if (asset != NULL && asset->font_data != NULL) {
+      SDL_RWops *data = SDL_RWFromConstMem(asset->font_data, asset->font_size);
+      ttf = TTF_OpenFontRW(data, 1, size);
+    } else {
+      ttf = TTF_OpenFont(path, size);
+    }
+    if (ttf == NULL) {
+      return NULL;
+    }
+  }
+
+  font_t *font = malloc(sizeof(*font));
+  assert(font != NULL);
+  font->path = malloc(strlen(path) + 1);
+  assert(font->path != NULL);
+  strcpy(font->path, path);
+  font->size = size;
+  font->ttf = ttf;
+  font->atlas = atlas;
+  fonts = realloc(fonts, sizeof(*fonts) * (num_fonts + 1));
+  assert(fonts != NULL);
+  fonts[num_fonts++] = font;
+  return font;
+}
+
+/** Draws text from the glyphs in a packed font atlas */
+SDL_Surface *render_atlas_text(const pack_entry_t *atlas, const char *text,
+                               SDL_Color color) {
+  const pack_glyph_t *glyphs = (const pack_glyph_t *)(pack + atlas->offset);
+  const uint8_t *coverage = (const uint8_t *)(glyphs + PACK_NUM_GLYPHS);
+
+  // Characters without a glyph are drawn as '?'
+  size_t length = strlen(text);
+  int width = 0, cursor = 0;
+  for (size_t i = 0; i < length; i++) {
+    unsigned glyph = (unsigned char)text[i] - PACK_FIRST_GLYPH;
+    if (glyph >= PACK_NUM_GLYPHS) {
+      glyph = '?' - PACK_FIRST_GLYPH;
+    }
+    if (cursor + (int)glyphs[glyph].width > width) {
+      width = cursor + glyphs[glyph].width;
+    }
+    cursor += glyphs[glyph].advance;
+  }
+  if (width == 0) {
+    return NULL;
+  }
+
+  SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+      0, width, atlas->height, 32, SDL_PIXELFORMAT_RGBA32);
+  if (surface == NULL) {
+    return NULL;
+  }
+  cursor = 0;
+  for (size_t i = 0; i < length; i++) {
+    unsigned glyph = (unsigned char)text[i] - PACK_FIRST_GLYPH;
+    if (glyph >= PACK_NUM_GLYPHS) {
+      glyph = '?' - PACK_FIRST_GLYPH;
+    }
+    for (uint32_t y = 0; y < atlas->height; y++) {
+      const uint8_t *source = &coverage[y * atlas->width + glyphs[glyph].x];
+      uint8_t *pixel = (uint8_t *)surface->pixels + y * surface->pitch +
+                       cursor * 4;
+      for (uint32_t x = 0; x < glyphs[glyph].width; x++, pixel += 4) {
+        // Where glyphs overlap, keep whichever covers the pixel more
+        uint8_t alpha = source[x] * color.a / 255;
+        pixel[0] = color.r;
+        pixel[1] = color.g;
+        pixel[2] = color.b;
+        pixel[3] = alpha > pixel[3] ? alpha : pixel[3];
+      }
+    }
+    cursor += glyphs[glyph].advance;
+  }
+  return surface;
+}
+
+SDL_Surface *assets_render_text(font_t *font, const char *text,
+                                SDL_Color color) {
+  if (font->atlas != NULL) {
+    return render_atlas_text(font->atlas, text, color);
+  }
+  return TTF_RenderText_Blended(font->ttf, text, color);
+}
+
+/** Prints how long startup took and how long each asset took to load */
+void print_startup_report(void) {
+  double total_ms[ASSET_OTHER + 1] = {0};
+  for (size_t i = 0; i < num_assets; i++) {
+    total_ms[assets[i].kind] += assets[i].load_ms;
+  }
+  printf("Startup: %s read after %.1f ms, first frame after %.1f ms, "
+         "%zu assets loaded after %.1f ms (%s)\n",
+         asset_source, manifest_ms, first_frame_ms,
+         num_assets + num_pack_entries, all_loaded_ms,
+         loading_in_background ? "background jobs" : "one per frame");
+  for (int kind = ASSET_IMAGE; kind <= ASSET_OTHER; kind++) {
+    if (total_ms[kind] > 0) {
+      printf("  %-6s %8.1f ms total\n", ASSET_KIND_NAMES[kind], total_ms[kind]);
+    }
+  }
+  for (size_t i = 0; i < num_assets; i++) {
+    printf("  %-6s %8.1f ms  %s%s\n", ASSET_KIND_NAMES[assets[i].kind],
+           assets[i].load_ms, assets[i].path,
+           assets[i].state == ASSET_FAILED ? " (failed)" : "");
+  }
+}
+
+void assets_frame_shown(void) {
+  if (asset_lock == NULL || report_printed) {
+    return;
+  }
+  if (first_frame_ms < 0) {
+    first_frame_ms = ms_since_preload();
+  }
+
+  SDL_LockMutex(asset_lock);
+  // Without worker threads, spread loading over the first frames
+  asset_t *asset = loading_in_background ? NULL : claim_next_asset();
+  SDL_UnlockMutex(asset_lock);
+  if (asset != NULL) {
+    load_asset(asset);
+  }
+
+  SDL_LockMutex(asset_lock);
+  bool all_loaded = assets_finished == num_assets;
+  SDL_UnlockMutex(asset_lock);
+  if (all_loaded) {
+    print_startup_report();
+    report_printed = true;
+  }
+}
@@ -1,36 +1,93 @@
 #include "body.h"
 #include "color.h"
 #include "list.h"
+#include "polygon.h"
 #include "vector.h"
 #include <assert.h>
 #include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
 const int INITIAL_LIST_SIZE = 10;
+// Local vertex coordinates are rounded to this fraction of a unit before
+// hashing, so bodies built from the same shape at different positions match
+const double SHAPE_KEY_PRECISION = 1e4;
+// A body falls asleep once it has moved slower than BODY_SLEEP_SPEED, with
+// its velocity changing by less than BODY_SLEEP_ACCELERATION per second,
+// for BODY_SLEEP_TIME seconds
+const double BODY_SLEEP_SPEED = 1;
+const double BODY_SLEEP_ACCELERATION = 1;
+const double BODY_SLEEP_TIME = 0.5;
+
+/**
+ * See body_get_static_layer_generation(). Atomic because bodies in different
+ * islands are moved on different threads.
+ */
+atomic_size_t static_layer_generation = 0;
+
+// While set on a thread, body_add_force() and body_add_impulse() add to these
+// arrays at each body's slot instead (see body_accumulate_into())
+_Thread_local body_sums_t thread_sums = {NULL, NULL, 0};
 
 typedef struct body {
   list_t *shape;
   vector_t velo;
   double mass;
+  body_motion_t motion;
+  double charge; // for create_coulomb_force()
   rgb_color_t color;
   vector_t centroid;
   double angle;
+  vector_t previous_centroid; // as of the last body_save_state()
+  double previous_angle;
   vector_t forces;
   vector_t impulses;
+  size_t slot; // see body_set_slot()
+  bool asleep;
+  double still_time;       // how long the body has been still, in seconds
+  vector_t last_velocity;  // as of the last body_update_sleep()
+  vector_t last_forces;    // as of the last body_check_sleep()
   void *type_of_bod;
   int remove_flag;
   bool in_collision;
   body_t *col_body;
   char *image_path;
-
+  bool static_layer;
+  size_t *triangles;    // vertex indices from polygon_triangulate(), or NULL
+  size_t num_triangles; // until the shape is first triangulated
+  size_t shape_key;     // see body_get_shape_key(); 0 until first computed
+  bool fixed_shape;     // false once body_set_shape() has been called
+  double width;         // see body_get_width(); negative until first computed
+  bool bullet;          // see body_set_bullet()
+  size_t placements;    // see body_get_placements()
 } body_t;
 
 char *body_get_image_path(body_t *bod){
   return bod->image_path;
 }
 
+/** Notes that a body has changed, if it is drawn into the static layer */
+void body_changed(body_t *body) {
+  if (body->static_layer) {
+    atomic_fetch_add(&static_layer_generation, 1);
+  }
+}
+
+void body_set_static_layer(body_t *body, bool is_static) {
+  body_changed(body);
+  body->static_layer = is_static;
+  body_changed(body);
+}
+
+bool body_is_static_layer(body_t *body) { return body->static_layer; }
+
+size_t body_get_static_layer_generation(void) {
+  return atomic_load(&static_layer_generation);
+}
+
 body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
   body_t *body = malloc(sizeof(body_t));
   body->shape = shape;
@@ -38,35 +95,38 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
   body->forces = (vector_t){0, 0};
 
   body->impulses = (vector_t){0, 0};
+  body->slot = 0;
+  body->asleep = false;
+  body->still_time = 0;
+  body->last_velocity = VEC_ZERO;
+  body->last_forces = VEC_ZERO;
 
   body->color = color;
   body->mass = mass;
+  body->motion = isinf(mass) ? BODY_KINEMATIC : BODY_DYNAMIC;
+  body->charge = 0;
   body->velo = (vector_t){0, 0};
   body->centroid = body_centroid(shape);
   body->angle = 0.0;
+  body->previous_centroid = body->centroid;
+  body->previous_angle = 0.0;
   body->remove_flag = 0;
   body->type_of_bod = (void *)NULL;
   body->in_collision = false;
   body->image_path = NULL;
+  body->static_layer = false;
+  body->triangles = NULL;
+  body->num_triangles = 0;
+  body->shape_key = 0;
+  body->fixed_shape = true;
+  body->width = -1;
+  body->bullet = false;
+  body->placements = 0;
   return body;
 }
 
 body_t *body_init_sprite(list_t *shape, double mass, rgb_color_t color, char *image_path) {
-  body_t *body = malloc(sizeof(body_t));
-  body->shape = shape;
-
-  body->forces = (vector_t){0, 0};
-
-  body->impulses = (vector_t){0, 0};
-
-  body->color = color;
-  body->mass = mass;
-  body->velo = (vector_t){0, 0};
-  body->centroid = body_centroid(shape);
-  body->angle = 0.0;
-  body->remove_flag = 0;
-  body->type_of_bod = (void *)NULL;
-  body->in_collision = false;
+  body_t *body = body_init(shape, mass, color);
   body->image_path = image_path;
   return body;
 }
@@ -86,7 +146,9 @@ body_t *body_init_with_info_with_image(list_t *shape, double mass, rgb_color_t c
 }
 
 void body_free(body_t *body) {
+  body_changed(body);
   list_free(body->shape);
+  free(body->triangles);
   free(body);
 }
 
@@ -154,39 +216,82 @@ double body_get_x_velo(body_t *body) { return body->velo.x; }
 
 double body_get_y_velo(body_t *body) { return body->velo.y; }
 
-void body_set_color(body_t *body, rgb_color_t col) { body->color = col; }
+void body_set_color(body_t *body, rgb_color_t col) {
+  body->color = col;
+  body_changed(body);
+}
 
 rgb_color_t body_get_color(body_t *body) { return body->color; }
 
 double body_get_mass(body_t *body) { return body->mass; }
 
-void body_set_centroid(body_t *body, vector_t x) {
+double body_get_charge(body_t *body) { return body->charge; }
+
+void body_set_charge(body_t *body, double charge) { body->charge = charge; }
+
+void body_move_centroid(body_t *body, vector_t x) {
+  body_wake(body);
   vector_t translation = vec_subtract(x, body_get_centroid(body));
   body_translate(body->shape, translation);
   body->centroid = x;
+  // Integrators move resting bodies by nothing every tick
+  if (translation.x != 0 || translation.y != 0) {
+    body_changed(body);
+  }
 }
 
-void body_set_velocity(body_t *body, vector_t v) { body->velo = v; }
+void body_set_centroid(body_t *body, vector_t x) {
+  body_move_centroid(body, x);
+  body->previous_centroid = x;
+  body->placements++;
+}
 
-void body_set_x_velo(body_t *body, double vx) { body->velo.x = vx; }
+void body_set_velocity(body_t *body, vector_t v) {
+  body_wake(body);
+  body->velo = v;
+}
+
+void body_set_x_velo(body_t *body, double vx) {
+  body_wake(body);
+  body->velo.x = vx;
+}
 
-void body_set_y_velo(body_t *body, double vy) { body->velo.y = vy; }
+void body_set_y_velo(body_t *body, double vy) {
+  body_wake(body);
+  body->velo.y = vy;
+}
 
 double body_get_angle(body_t *body) { return body->angle; }
 
 void body_set_rotation(body_t *body, double angle) {
+  body_wake(body);
   vector_t centroid = body_get_centroid(body);
   body_rotate(body->shape, angle - body_get_angle(body), centroid);
   body->angle = angle;
+  body->previous_angle = body->angle;
+  body->placements++;
+  body_changed(body);
 }
 
 void body_set_rotation_relative(body_t *body, double angle) {
+  body_wake(body);
   vector_t centroid = body_get_centroid(body);
   body_rotate(body->shape, angle, centroid);
-  body->angle = angle;
+  body->angle += angle;
+  body->previous_angle = body->angle;
+  body->placements++;
+  body_changed(body);
 }
 
 void body_tick(body_t *body, double dt) {
+  if (body->motion != BODY_DYNAMIC) {
+    // Kinematic bodies just keep their velocity, which needs no averaging
+    if (body->motion == BODY_KINEMATIC) {
+      body_move_centroid(body,
+                         vec_add(body->centroid, vec_multiply(dt, body->velo)));
+    }
+    return;
+  }
   double vel_x = 0;
   double vel_y = 0;
   // list_t *fs = body->forces;
@@ -209,20 +314,187 @@ void body_tick(body_t *body, double dt) {
   vector_t translation = vec_multiply(
       dt, vec_multiply(0.5, vec_add(prev_vel, body_get_velocity(body))));
   // Update centroid
-  body_set_centroid(body, vec_add(body->centroid, translation));
+  body_move_centroid(body, vec_add(body->centroid, translation));
   
 }
 
 list_t *get_body_points(body_t *body) { return body->shape; }
 
+void body_save_state(body_t *body) {
+  body->previous_centroid = body->centroid;
+  body->previous_angle = body->angle;
+}
+
+vector_t body_get_interpolated_centroid(body_t *body, double alpha) {
+  return vec_add(body->previous_centroid,
+                 vec_multiply(alpha, vec_subtract(body->centroid,
+                                                  body->previous_centroid)));
+}
+
+double body_get_interpolated_angle(body_t *body, double alpha) {
+  return body->previous_angle + alpha * (body->angle - body->previous_angle);
+}
+
+size_t body_get_shape_key(body_t *body) {
+  if (!body->fixed_shape || body->shape_key != 0) {
+    return body->shape_key;
+  }
+
+  // Hash the shape as it was before being moved and rotated
+  uint64_t key = 14695981039346656037ULL;
+  size_t size = list_size(body->shape);
+  for (size_t i = 0; i < size; i++) {
+    vector_t point = *(vector_t *)list_get(body->shape, i);
+    vector_t local =
+        vec_rotate(vec_subtract(point, body->centroid), -body->angle);
+    key = (key ^ (uint64_t)llround(local.x * SHAPE_KEY_PRECISION)) *
+          1099511628211ULL;
+    key = (key ^ (uint64_t)llround(local.y * SHAPE_KEY_PRECISION)) *
+          1099511628211ULL;
+  }
+  // 0 means the shape has no key
+  body->shape_key = (size_t)key != 0 ? (size_t)key : 1;
+  return body->shape_key;
+}
+
+size_t *body_get_triangles(body_t *body, size_t *num_triangles) {
+  // Moving the body never changes which vertices form each triangle,
+  // so the shape only needs to be triangulated once
+  if (body->triangles == NULL) {
+    size_t size = list_size(body->shape);
+    body->triangles = malloc(sizeof(*body->triangles) * 3 * (size > 2 ? size - 2 : 1));
+    assert(body->triangles != NULL);
+    body->num_triangles = polygon_triangulate(body->shape, body->triangles);
+  }
+  *num_triangles = body->num_triangles;
+  return body->triangles;
+}
+
+double body_get_width(body_t *body) {
+  if (body->width < 0) {
+    body->width = polygon_width(body->shape);
+  }
+  return body->width;
+}
+
+void body_set_bullet(body_t *body, bool bullet) { body->bullet = bullet; }
+
+bool body_is_bullet(body_t *body) { return body->bullet; }
+
 void body_add_force(body_t *body, vector_t force) {
+  if (body->motion != BODY_DYNAMIC) {
+    return;
+  }
+  if (thread_sums.forces != NULL) {
+    assert(body->slot < thread_sums.num_slots);
+    thread_sums.forces[body->slot] =
+        vec_add(thread_sums.forces[body->slot], force);
+    return;
+  }
   body->forces = vec_add(body->forces, force);
 }
 
 void body_add_impulse(body_t *body, vector_t impulse) {
+  if (body->motion != BODY_DYNAMIC) {
+    return;
+  }
+  if (thread_sums.impulses != NULL) {
+    assert(body->slot < thread_sums.num_slots);
+    thread_sums.impulses[body->slot] =
+        vec_add(thread_sums.impulses[body->slot], impulse);
+    return;
+  }
   body->impulses = vec_add(body->impulses, impulse);
 }
 
+void body_set_slot(body_t *body, size_t slot) { body->slot = slot; }
+
+size_t body_get_slot(body_t *body) { return body->slot; }
+
+body_sums_t body_accumulate_into(body_sums_t sums) {
+  body_sums_t previous = thread_sums;
+  thread_sums = sums;
+  return previous;
+}
+
+void body_apply_impulses(body_t *body) {
+  body->velo = vec_add(body->velo, vec_multiply(1 / body->mass, body->impulses));
+  body->impulses = (vector_t){0, 0};
+}
+
+vector_t body_take_acceleration(body_t *body) {
+  vector_t acceleration = vec_multiply(1 / body->mass, body->forces);
+  body->forces = (vector_t){0, 0};
+  return acceleration;
+}
+
+void body_set_motion(body_t *body, body_motion_t motion) {
+  body_wake(body);
+  body->motion = motion;
+  body->forces = VEC_ZERO;
+  body->impulses = VEC_ZERO;
+  if (motion == BODY_STATIC) {
+    body->velo = VEC_ZERO;
+  }
+}
+
+body_motion_t body_get_motion(body_t *body) { return body->motion; }
+
+vector_t body_predict_velocity(body_t *body, double dt) {
+  if (body->motion != BODY_DYNAMIC) {
+    return body->velo;
+  }
+  vector_t change = vec_add(vec_multiply(dt, body->forces), body->impulses);
+  return vec_add(body->velo, vec_multiply(1 / body->mass, change));
+}
+
+bool body_is_asleep(body_t *body) { return body->asleep; }
+
+size_t body_get_placements(body_t *body) { return body->placements; }
+
+void body_wake(body_t *body) {
+  if (body->asleep) {
+    body->asleep = false;
+    body->still_time = 0;
+  }
+}
+
+bool body_check_sleep(body_t *body) {
+  if (body->asleep) {
+    vector_t change = vec_subtract(body->forces, body->last_forces);
+    bool pushed = body->impulses.x != 0 || body->impulses.y != 0 ||
+                  sqrt(vec_dot(change, change)) >
+                      BODY_SLEEP_ACCELERATION * body->mass;
+    if (!pushed) {
+      body->forces = VEC_ZERO;
+      return true;
+    }
+    body_wake(body);
+  }
+  body->last_forces = body->forces;
+  return false;
+}
+
+void body_update_sleep(body_t *body, double dt) {
+  // Kinematic bodies must keep their velocity, and static ones never move
+  if (body->asleep || body->motion != BODY_DYNAMIC) {
+    return;
+  }
+  vector_t change = vec_subtract(body->velo, body->last_velocity);
+  body->last_velocity = body->velo;
+  if (sqrt(vec_dot(body->velo, body->velo)) >= BODY_SLEEP_SPEED ||
+      sqrt(vec_dot(change, change)) >= BODY_SLEEP_ACCELERATION * dt) {
+    body->still_time = 0;
+    return;
+  }
+  body->still_time += dt;
+  if (body->still_time >= BODY_SLEEP_TIME) {
+    body->asleep = true;
+    body->velo = VEC_ZERO;
+    body->last_velocity = VEC_ZERO;
+  }
+}
+
 vector_t body_centroid(list_t *polygon) {
   // Find polygon's signed area as described by shoelace formula
   double area = body_area(polygon);
@@ -249,74 +521,27 @@ vector_t body_centroid(list_t *polygon) {
   return centroid;
 }
 
-void body_remove(body_t *body) { body->remove_flag = 1; }
-
-bool body_is_removed(body_t *body) { return body->remove_flag == 1; }
-
-list_t *find_edges(list_t *shape) {
-  list_t *edges = list_init(list_size(shape), free);
-  for (size_t i = 0; i < list_size(shape) - 1; i++) {
-    // current point
-    vector_t cur_point = *(vector_t *)list_get(shape, i);
-    // next point
-    vector_t next_point = *(vector_t *)list_get(shape, i + 1);
-    vector_t *e = malloc(sizeof(vector_t));
-    e->x = vec_subtract(next_point, cur_point).x;
-    e->y = vec_subtract(next_point, cur_point).y;
-    list_add(edges, e);
-  }
-  return edges;
-}
-
-list_t *find_axes(list_t *edges) {
-  list_t *axes = list_init(list_size(edges), free);
-  for (size_t i = 0; i < list_size(edges); i++) {
-    vector_t cur_edge;
-    cur_edge.x = ((vector_t *)(list_get(edges, i)))->x;
-    cur_edge.y = ((vector_t *)(list_get(edges, i)))->y;
-    vector_t *axis = malloc(sizeof(vector_t));
-    axis->x = cur_edge.y;
-    axis->y = -cur_edge.x;
-    axis->x =
-        cur_edge.y / sqrt(cur_edge.y * cur_edge.y + cur_edge.x * cur_edge.x);
-    axis->y =
-        -cur_edge.x / sqrt(cur_edge.y * cur_edge.y + cur_edge.x * cur_edge.x);
-    list_add(axes, axis);
-  }
-  return axes;
-}
-
-vector_t body_proj_on_axis(list_t *sh, vector_t *axis) {
-  double min_value = INFINITY;
-  double max_value = -INFINITY;
-
-  // Iterate through each of the points in shape, compute dot product with unit
-  // vector axis
-  vector_t axis2;
-  axis2.x = axis->x;
-  axis2.y = axis->y;
-  axis2 = find_unit_vector(axis2);
-  for (size_t i = 0; i < list_size(sh); i++) {
-    double dot_prod = vec_dot(axis2, *(vector_t *)(list_get(sh, i)));
-    min_value = min(dot_prod, min_value);
-    max_value = max(dot_prod, max_value);
-  }
-  return (vector_t){min_value, max_value};
+void body_remove(body_t *body) {
+  body->remove_flag = 1;
+  body_changed(body);
 }
 
-double check_overlap_axis(list_t *shape1, list_t *shape2, vector_t *axis) {
-  vector_t proj1 = body_proj_on_axis(shape1, axis);
-  vector_t proj2 = body_proj_on_axis(shape2, axis);
-  if (is_overlapping(proj1, proj2)) {
-    return amount_overlapping(proj1, proj2);
-  } else
-    return -1;
-}
+bool body_is_removed(body_t *body) { return body->remove_flag == 1; }
 
 void body_set_shape(body_t *body, list_t *shape) {
+  body_wake(body);
   list_free(body->shape);
   body->shape = shape;
   body->centroid = body_centroid(shape);
+  // A new shape is not a movement, so it should not be interpolated
+  body->previous_centroid = body->centroid;
+  free(body->triangles);
+  body->triangles = NULL;
+  body->fixed_shape = false;
+  body->shape_key = 0;
+  body->width = -1;
+  body->placements++;
+  body_changed(body);
 }
 
 bool check_in_collision(body_t *body) { return body->in_collision; }
@@ -16,72 +16,314 @@
 
 #include <time.h>
 
-collision_info_t find_collision(list_t *shape1, list_t *shape2) {
-  collision_info_t col_info;
-  // Find list of axes perpendicular to both polygons
-  list_t *edges1 = find_edges(shape1);
-  list_t *edges2 = find_edges(shape2);
+/** Projects a polygon onto a unit axis, returning the range as (min, max) */
+vector_t project_shape(list_t *shape, vector_t axis) {
+  vector_t range = {INFINITY, -INFINITY};
+  size_t size = list_size(shape);
+  for (size_t i = 0; i < size; i++) {
+    vector_t *point = list_get(shape, i);
+    double projection = axis.x * point->x + axis.y * point->y;
+    range.x = projection < range.x ? projection : range.x;
+    range.y = projection > range.y ? projection : range.y;
+  }
+  return range;
+}
+
+/**
+ * Projects both shapes onto each edge normal of edges_of.
+ * Returns false if they are separated along one; otherwise keeps the normal
+ * with the least overlap in axis and its overlap in min_overlap.
+ */
+bool overlap_on_normals(list_t *edges_of, list_t *shape1, list_t *shape2,
+                        double *min_overlap, vector_t *axis) {
+  size_t size = list_size(edges_of);
+  for (size_t i = 0; i < size; i++) {
+    vector_t *point = list_get(edges_of, i);
+    vector_t *next = list_get(edges_of, (i + 1) % size);
+    vector_t edge = {next->x - point->x, next->y - point->y};
+    double length = sqrt(edge.x * edge.x + edge.y * edge.y);
+    if (length == 0) {
+      continue;
+    }
+    vector_t normal = {edge.y / length, -edge.x / length};
+    vector_t range1 = project_shape(shape1, normal);
+    vector_t range2 = project_shape(shape2, normal);
+    double overlap = fmin(range1.y, range2.y) - fmax(range1.x, range2.x);
+    if (overlap < 0) {
+      return false;
+    }
+    if (overlap < *min_overlap) {
+      *min_overlap = overlap;
+      *axis = normal;
+    }
+  }
+  return true;
+}
 
-  // Find perpendicular axes
-  list_t *axes1 = find_axes(edges1);
-  list_t *axes2 = find_axes(edges2);
+/** An edge of a shape, and the vertex of the shape farthest along a normal */
+typedef struct edge {
+  vector_t from;
+  vector_t to;
+  vector_t farthest;
+  size_t index; // the index of from in the shape
+} edge_t;
 
-  double min_overlap = INFINITY;
-  vector_t collision_axis;
-
-  // Check if there are intersections for all of the axes on the list axes1
-  // If so, return true
-  for (size_t i = 0; i < list_size(axes1); i++) {
-    // If no intersection for some axis, return false
-    double overlap_check =
-        check_overlap_axis(shape1, shape2, list_get(axes1, i));
-    if (overlap_check == -1) {
-      list_free(edges1);
-      list_free(edges2);
-      list_free(axes1);
-      list_free(axes2);
-      list_free(shape1);
-      list_free(shape2);
-      col_info.collided = false;
-      return col_info;
-    } else {
-      if (overlap_check < min_overlap) {
-        min_overlap = overlap_check;
-        collision_axis.x = ((vector_t *)list_get(axes1, i))->x;
-        collision_axis.y = ((vector_t *)list_get(axes1, i))->y;
-      }
+/**
+ * Finds the edge of a shape facing most directly along a unit normal:
+ * of the two edges at the vertex farthest along it, the one more
+ * perpendicular to it
+ */
+edge_t find_facing_edge(list_t *shape, vector_t normal) {
+  size_t size = list_size(shape);
+  size_t best = 0;
+  double best_projection = -INFINITY;
+  for (size_t i = 0; i < size; i++) {
+    double projection = vec_dot(*(vector_t *)list_get(shape, i), normal);
+    if (projection > best_projection) {
+      best_projection = projection;
+      best = i;
     }
   }
-  // Check if there are intersections for all of the axes on the list axes2
-  // If so, return true
-  for (size_t i = 0; i < list_size(axes2); i++) {
-    // If no intersection for some axis, return false
-    double overlap_check2 =
-        check_overlap_axis(shape1, shape2, list_get(axes2, i));
-    if (overlap_check2 == -1) {
-      list_free(edges1);
-      list_free(edges2);
-      list_free(axes1);
-      list_free(axes2);
-      list_free(shape1);
-      list_free(shape2);
-      col_info.collided = false;
-      return col_info;
-    } else {
-      if (overlap_check2 < min_overlap) {
-        min_overlap = overlap_check2;
-        collision_axis.x = ((vector_t *)list_get(axes2, i))->x;
-        collision_axis.y = ((vector_t *)list_get(axes2, i))->y;
-      }
+  size_t previous_index = (best + size - 1) % size;
+  vector_t vertex = *(vector_t *)list_get(shape, best);
+  vector_t previous = *(vector_t *)list_get(shape, previous_index);
+  vector_t next = *(vector_t *)list_get(shape, (best + 1) % size);
+  vector_t to_previous = vec_subtract(vertex, previous);
+  vector_t to_next = vec_subtract(next, vertex);
+  // Compare |cos| of each edge's angle with the normal
+  double previous_slant =
+      fabs(vec_dot(to_previous, normal)) * sqrt(vec_dot(to_next, to_next));
+  double next_slant =
+      fabs(vec_dot(to_next, normal)) * sqrt(vec_dot(to_previous, to_previous));
+  if (previous_slant <= next_slant) {
+    return (edge_t){previous, vertex, vertex, previous_index};
+  }
+  return (edge_t){vertex, next, vertex, best};
+}
+
+// Where each contact point on the incident edge comes from,
+// the last part of its feature id
+typedef enum {
+  FROM_VERTEX,
+  TO_VERTEX,
+  CLIPPED_AT_FROM, // where the edge crosses the side at the reference's from
+  CLIPPED_AT_TO
+} contact_source_t;
+const size_t NUM_CONTACT_SOURCES = 4;
+
+/**
+ * Clips the segment points[0]-points[1] to the side of a line where
+ * the projection on direction is at least offset. A point made by clipping
+ * gets the source clipped. Returns the number of points left, with the kept
+ * part in points and their sources in sources.
+ */
+size_t clip_segment(vector_t points[2], contact_source_t sources[2],
+                    vector_t direction, double offset,
+                    contact_source_t clipped) {
+  double distance0 = vec_dot(points[0], direction) - offset;
+  double distance1 = vec_dot(points[1], direction) - offset;
+  vector_t kept[2];
+  contact_source_t kept_sources[2];
+  size_t count = 0;
+  if (distance0 >= 0) {
+    kept_sources[count] = sources[0];
+    kept[count++] = points[0];
+  }
+  if (distance1 >= 0) {
+    kept_sources[count] = sources[1];
+    kept[count++] = points[1];
+  }
+  if (distance0 * distance1 < 0) {
+    double t = distance0 / (distance0 - distance1);
+    kept_sources[count] = clipped;
+    kept[count++] =
+        vec_add(points[0], vec_multiply(t, vec_subtract(points[1], points[0])));
+  }
+  for (size_t i = 0; i < count; i++) {
+    points[i] = kept[i];
+    sources[i] = kept_sources[i];
+  }
+  return count;
+}
+
+/**
+ * Finds where two overlapping shapes touch, given the axis from shape1
+ * towards shape2. The edge facing most directly along the axis is the
+ * reference; the other shape's facing edge is clipped to its sides, and the
+ * points left that are inside the reference shape are the contacts.
+ * Sets the contacts and their features in col_info.
+ */
+void find_contact_points(list_t *shape1, list_t *shape2,
+                         collision_info_t *col_info) {
+  vector_t axis = col_info->axis;
+  edge_t edge1 = find_facing_edge(shape1, axis);
+  edge_t edge2 = find_facing_edge(shape2, vec_negate(axis));
+  vector_t along1 = vec_subtract(edge1.to, edge1.from);
+  vector_t along2 = vec_subtract(edge2.to, edge2.from);
+  edge_t reference = edge1;
+  edge_t incident = edge2;
+  size_t incident_size = list_size(shape2);
+  bool flipped = false;
+  // The normal out of the reference shape, towards the other
+  vector_t outward = axis;
+  if (fabs(vec_dot(along1, axis)) * sqrt(vec_dot(along2, along2)) >
+      fabs(vec_dot(along2, axis)) * sqrt(vec_dot(along1, along1))) {
+    reference = edge2;
+    incident = edge1;
+    incident_size = list_size(shape1);
+    flipped = true;
+    outward = vec_negate(axis);
+  }
+
+  vector_t along = vec_subtract(reference.to, reference.from);
+  double length = sqrt(vec_dot(along, along));
+  vector_t points[2] = {incident.from, incident.to};
+  contact_source_t sources[2] = {FROM_VERTEX, TO_VERTEX};
+  size_t count = 2;
+  if (length > 0) {
+    along = vec_multiply(1 / length, along);
+    count = clip_segment(points, sources, along,
+                         vec_dot(along, reference.from), CLIPPED_AT_FROM);
+    if (count == 2) {
+      count = clip_segment(points, sources, vec_negate(along),
+                           -vec_dot(along, reference.to), CLIPPED_AT_TO);
+    }
+    // The reference edge's own normal, facing the same way as the axis
+    vector_t normal = {along.y, -along.x};
+    outward = vec_dot(normal, outward) < 0 ? vec_negate(normal) : normal;
+  }
+  double face = vec_dot(outward, reference.farthest);
+  size_t num_contacts = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (vec_dot(outward, points[i]) <= face) {
+      sources[num_contacts] = sources[i];
+      col_info->contacts[num_contacts++] = points[i];
     }
   }
-  list_free(edges1);
-  list_free(edges2);
-  list_free(axes1);
-  list_free(axes2);
+  // Rounding can clip away every point of a shallow contact
+  if (num_contacts == 0) {
+    bool at_from = incident.farthest.x == incident.from.x &&
+                   incident.farthest.y == incident.from.y;
+    sources[num_contacts] = at_from ? FROM_VERTEX : TO_VERTEX;
+    col_info->contacts[num_contacts++] = incident.farthest;
+  }
+  // Number every combination of reference edge, incident edge and source
+  size_t edges = (reference.index * 2 + flipped) * incident_size +
+                 incident.index;
+  for (size_t i = 0; i < num_contacts; i++) {
+    col_info->features[i] = edges * NUM_CONTACT_SOURCES + sources[i];
+  }
+  col_info->num_contacts = num_contacts;
+}
+
+collision_info_t find_shape_collision(list_t *shape1, list_t *shape2) {
+  collision_info_t col_info = {.collided = false};
+  // Most pairs are far apart, which their bounding boxes show more cheaply
+  // than any edge normal
+  vector_t x1 = project_shape(shape1, (vector_t){1, 0});
+  vector_t x2 = project_shape(shape2, (vector_t){1, 0});
+  vector_t y1 = project_shape(shape1, (vector_t){0, 1});
+  vector_t y2 = project_shape(shape2, (vector_t){0, 1});
+  if (x1.y < x2.x || x2.y < x1.x || y1.y < y2.x || y2.y < y1.x) {
+    return col_info;
+  }
+  double min_overlap = INFINITY;
+  vector_t axis = VEC_ZERO;
+  if (!overlap_on_normals(shape1, shape1, shape2, &min_overlap, &axis) ||
+      !overlap_on_normals(shape2, shape1, shape2, &min_overlap, &axis)) {
+    return col_info;
+  }
+  // Edge normals point either way, so turn the axis towards shape2
+  vector_t range1 = project_shape(shape1, axis);
+  vector_t range2 = project_shape(shape2, axis);
+  if (range2.x + range2.y < range1.x + range1.y) {
+    axis = vec_negate(axis);
+  }
+  col_info.collided = true;
+  col_info.axis = axis;
+  col_info.depth = min_overlap;
+  find_contact_points(shape1, shape2, &col_info);
+  return col_info;
+}
+
+collision_info_t find_collision(list_t *shape1, list_t *shape2) {
+  collision_info_t col_info = find_shape_collision(shape1, shape2);
   list_free(shape1);
   list_free(shape2);
-  col_info.collided = true;
-  col_info.axis = (vector_t)find_unit_vector(collision_axis);
   return col_info;
 }
+
+/**
+ * Narrows [*enter, *exit] to the part of the motion in which the shapes
+ * overlap along each edge normal of edges_of, keeping the normal along which
+ * they were the last to start overlapping in axis. Shape2 moves by motion
+ * relative to shape1, ending where it is now. Returns false once the range
+ * is empty.
+ */
+bool sweep_on_normals(list_t *edges_of, list_t *shape1, list_t *shape2,
+                      vector_t motion, double *enter, double *exit,
+                      vector_t *axis) {
+  size_t size = list_size(edges_of);
+  for (size_t i = 0; i < size; i++) {
+    vector_t *point = list_get(edges_of, i);
+    vector_t *next = list_get(edges_of, (i + 1) % size);
+    vector_t edge = {next->x - point->x, next->y - point->y};
+    double length = sqrt(edge.x * edge.x + edge.y * edge.y);
+    if (length == 0) {
+      continue;
+    }
+    vector_t normal = {edge.y / length, -edge.x / length};
+    vector_t range1 = project_shape(shape1, normal);
+    vector_t range2 = project_shape(shape2, normal);
+    // At time t, shape2 is (t - 1) * speed further along the normal than now,
+    // and the shapes overlap while that offset is between low and high
+    double speed = motion.x * normal.x + motion.y * normal.y;
+    double low = range1.x - range2.y;
+    double high = range1.y - range2.x;
+    double start, end;
+    if (speed == 0) {
+      if (low > 0 || high < 0) {
+        return false;
+      }
+      start = 0;
+      end = 1;
+    } else {
+      start = 1 + (speed > 0 ? low : high) / speed;
+      end = 1 + (speed > 0 ? high : low) / speed;
+    }
+    if (start > *enter) {
+      *enter = start;
+      *axis = normal;
+    }
+    *exit = end < *exit ? end : *exit;
+    if (*enter > *exit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+double find_time_of_impact(list_t *shape1, vector_t motion1, list_t *shape2,
+                           vector_t motion2, vector_t *axis) {
+  vector_t motion = vec_subtract(motion2, motion1);
+  double enter = 0;
+  double exit = 1;
+  vector_t normal = VEC_ZERO;
+  if (!sweep_on_normals(shape1, shape1, shape2, motion, &enter, &exit,
+                        &normal) ||
+      !sweep_on_normals(shape2, shape1, shape2, motion, &enter, &exit,
+                        &normal)) {
+    return INFINITY;
+  }
+  // Overlapping from the start, so no normal was the last to start
+  if (enter == 0) {
+    return 0;
+  }
+  // Point the normal at shape2, as it was when they touched
+  vector_t range1 = project_shape(shape1, normal);
+  vector_t range2 = project_shape(shape2, normal);
+  double offset = (enter - 1) * vec_dot(motion, normal);
+  double gap = (range2.x + range2.y) / 2 + offset - (range1.x + range1.y) / 2;
+  *axis = gap < 0 ? vec_negate(normal) : normal;
+  return enter;
+}
@@ -1,13 +1,34 @@
 #include "math.h"
 #include "sdl_wrapper.h"
 #include "state.h"
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
 
+// Pass this flag to simulate on a separate thread from rendering
+const char RENDER_THREAD_FLAG[] = "--render-thread";
+// Pass this flag to draw offscreen without a display (see sdl_enable_headless())
+const char HEADLESS_FLAG[] = "--headless";
+// Pass this flag followed by a number to exit after that many frames
+const char FRAMES_FLAG[] = "--frames";
+// Pass this flag followed by a directory to write every frame there
+const char DUMP_FLAG[] = "--dump";
+// Pass this flag to dump raw RGBA frames instead of PNGs
+const char RAW_FLAG[] = "--raw";
+// Pass this flag followed by a number to seed the demo's random numbers
+const char SEED_FLAG[] = "--seed";
+// Pass this flag followed by a script of input to replay (sdl_play_input())
+const char INPUT_FLAG[] = "--input";
+
 scene_t *scene;
+bool done = false;
+// The number of frames to run before exiting, or 0 to run until the window closes
+size_t frame_limit = 0;
+size_t frames = 0;
 
 void loop() {
   // If needed, generate a pointer to our initial state
@@ -16,26 +37,78 @@ void loop() {
   }
 
   emscripten_main(scene);
+  frames++;
 
-  if (sdl_is_done(scene)) { // Once our demo exits...
+  bool reached_frame_limit = frame_limit != 0 && frames >= frame_limit;
+  if (sdl_is_done(scene) || reached_frame_limit) { // Once our demo exits...
     emscripten_free(scene); // Free any state variables we've been using
 #ifdef __EMSCRIPTEN__ // Clean up emscripten environment (if we're using it)
     emscripten_cancel_main_loop();
     emscripten_force_exit(0);
 #else
-    exit(0);
+    done = true;
 #endif
     return;
   }
 }
 
-int main() {
+int simulate(void *aux) {
+  while (!done) {
+    loop();
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
 #ifdef __EMSCRIPTEN__
   // Set loop as the function emscripten calls to request a new frame
   emscripten_set_main_loop_arg(loop, NULL, 0, 1);
 #else
-  while (1) {
-    loop();
+  bool render_thread = false;
+  char *dump_directory = NULL;
+  frame_format_t dump_format = FRAME_PNG;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], RENDER_THREAD_FLAG) == 0) {
+      render_thread = true;
+    } else if (strcmp(argv[i], HEADLESS_FLAG) == 0) {
+      sdl_enable_headless();
+    } else if (strcmp(argv[i], FRAMES_FLAG) == 0 && i + 1 < argc) {
+      frame_limit = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], DUMP_FLAG) == 0 && i + 1 < argc) {
+      dump_directory = argv[++i];
+    } else if (strcmp(argv[i], RAW_FLAG) == 0) {
+      dump_format = FRAME_RAW;
+    } else if (strcmp(argv[i], SEED_FLAG) == 0 && i + 1 < argc) {
+      sdl_set_random_seed(strtoul(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], INPUT_FLAG) == 0 && i + 1 < argc) {
+      if (!sdl_play_input(argv[++i])) {
+        return 1;
+      }
+    } else {
+      fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (dump_directory != NULL) {
+    sdl_dump_frames(dump_directory, dump_format);
+  }
+
+  uint64_t start = SDL_GetPerformanceCounter();
+  if (render_thread) {
+    sdl_run_threaded(simulate, NULL);
+  } else {
+    simulate(NULL);
+  }
+  double elapsed =
+      (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+  sdl_free_images();
+
+  // Report throughput so headless runs can be used as benchmarks
+  if (sdl_is_headless()) {
+    size_t presented = sdl_frames_presented();
+    printf("%zu frames (%zu drawn) in %.3f s: %.3f ms per frame\n", frames,
+           presented, elapsed, frames ? elapsed * 1e3 / frames : 0.0);
   }
 #endif
+  return 0;
 }
@@ -2,7 +2,13 @@
 #include "body.h"
 #include "collision.h"
 #include "color.h"
+#include "island.h"
+#include "job.h"
 #include "list.h"
+#include "pairwise.h"
+#include "polygon.h"
+#include "quadtree.h"
+#include "water.h"
 #include "scene.h"
 #include "vector.h"
 #include <assert.h>
@@ -11,89 +17,76 @@
 #include <stdlib.h>
 #include <time.h>
 
-#include <SDL2/SDL_mixer.h>
-#include "sdl_wrapper.h"
 
 
-
-const int CONSTANT_DIMENSION = 2;
-typedef struct force_info {
-  list_t *bodies;
-  double constant; // set to either k, gamma, or G (depending on creating
-                   // gravity, spring, or drag)
-} force_info_t;
-
-typedef struct collision_force_info {
-  list_t *bodies;              // bodies involved in colliding
-  collision_handler_t handler; // how to handle collision
-  vector_t axis;               // axis on which colliding
-  bool currently_colliding;
-  void *aux;
-} collision_force_info_t;
-
-typedef struct buoyancy_force_info{
-  list_t *bodies;
-  double G;
-  double p;
-  double water_level;
-} buoyancy_force_info_t;
-
-typedef struct duck_gravity_force_info{
-  list_t *bodies;
+// Groups with fewer bodies than this sum gravity over every pair exactly,
+// since building the quadtree would cost more than it saves
+const size_t BARNES_HUT_MIN_BODIES = 64;
+// Pairs of bodies one thread checks for collisions at a time
+const size_t COLLISION_DETECT_GRAIN = 64;
+// Islands of contacts one thread resolves at a time
+const size_t ISLAND_RESOLVE_GRAIN = 16;
+// Pairs of bodies are swept once they move farther than this fraction of
+// their combined width relative to each other in a tick
+const double SWEEP_MIN_MOTION = 0.5;
+// Overlaps this deep are left alone, so that bodies resting on each other
+// stay in contact instead of being pushed apart and falling back every tick
+const double CONTACT_SLOP = 0.01;
+// The fraction of an overlap beyond CONTACT_SLOP corrected each tick.
+// Correcting all of it overshoots when a body has several contacts.
+const double CONTACT_CORRECTION = 0.8;
+// Bodies in contact approaching faster than this wake each other, since
+// contacts treat sleeping bodies as fixed
+const double CONTACT_WAKE_SPEED = 1;
+// Swept bodies are put back this far into what they hit, so that the next
+// check sees the shapes overlap despite rounding
+const double SWEEP_CONTACT_DEPTH = 1e-3;
+typedef struct buoyancy_info {
+  list_t *bodies; // the group, owned by the scene
+  double density;
+  double g;
+  water_t *water; // not owned
+  force_condition_t condition; // or NULL to always apply
+  void *aux;                   // passed to condition
+} buoyancy_info_t;
+
+typedef struct uniform_gravity_info {
+  list_t *bodies; // the group, owned by the scene
+  vector_t acceleration;
+  force_condition_t condition; // or NULL to always apply
+  void *aux;                   // passed to condition
+} uniform_gravity_info_t;
+
+typedef struct nbody_gravity_info {
+  list_t *bodies; // the group, owned by the scene
   double G;
-  double water_level;
-}duck_gravity_force_info_t;
-
-void free_force_info(force_info_t *inf) { free(inf); }
-
-void free_collision_force_info(collision_force_info_t *inf) { free(inf); }
-
-list_t *force_get_bodies(force_info_t *inf) { return inf->bodies; }
-force_info_t *gravity_force_init(scene_t *scene, double G, body_t *body1,
-                                 body_t *body2) {
-  force_info_t *grav_force = malloc(sizeof(force_info_t));
-  assert(grav_force != NULL);
-  grav_force->bodies = list_init(2, (free_func_t)NULL);
-  list_add(grav_force->bodies, body1);
-  list_add(grav_force->bodies, body2);
-  grav_force->constant = G;
-  return grav_force;
+  double softening;
+  double theta;
+  quadtree_t *tree;
+  // Scratch space for building the tree, reused every tick
+  vector_t *positions;
+  double *masses;
+  size_t capacity;
+} nbody_gravity_info_t;
+
+typedef struct pairwise_force_info {
+  list_t *bodies; // the group, owned by the scene
+  double coupling; // see particles_pairwise_forces()
+  double softening;
+  bool use_charges; // whether the strengths are charges or masses
+  particles_t *particles;
+} pairwise_force_info_t;
+
+void free_pairwise_force_info(pairwise_force_info_t *info) {
+  particles_free(info->particles);
+  free(info);
 }
 
-force_info_t *spring_force_init(scene_t *scene, double k, body_t *body1,
-                                body_t *body2) {
-  force_info_t *spring_force = malloc(sizeof(force_info_t));
-  assert(spring_force != NULL);
-  spring_force->bodies = list_init(2, (free_func_t)NULL);
-  list_add(spring_force->bodies, body1);
-  list_add(spring_force->bodies, body2);
-  spring_force->constant = k;
-  return spring_force;
-}
-
-// Initialize collision info t to  have the bodies + elasticity if it exists (it
-// would be stored in aux)
-collision_force_info_t *collision_force_init(scene_t *scene, body_t *body1,
-                                             body_t *body2, void *aux,
-                                             collision_handler_t handler) {
-  collision_force_info_t *collision_force =
-      malloc(sizeof(collision_force_info_t));
-  assert(collision_force != NULL);
-  collision_force->bodies = list_init(2, (free_func_t)NULL);
-  list_add(collision_force->bodies, body1);
-  list_add(collision_force->bodies, body2);
-  collision_force->aux = aux;
-  collision_force->handler = handler;
-  return collision_force;
-}
-
-force_info_t *drag_force_init(scene_t *scene, double gamma, body_t *body) {
-  force_info_t *drag_force = malloc(sizeof(force_info_t));
-  assert(drag_force != NULL);
-  drag_force->bodies = list_init(1, (free_func_t)NULL);
-  list_add(drag_force->bodies, body);
-  drag_force->constant = gamma;
-  return drag_force;
+void free_nbody_gravity_info(nbody_gravity_info_t *info) {
+  quadtree_free(info->tree);
+  free(info->positions);
+  free(info->masses);
+  free(info);
 }
 
 vector_t calc_spring_force(double k, body_t *body1, body_t *body2) {
@@ -121,280 +114,815 @@ vector_t calc_gravity_force(double g, body_t *body1, body_t *body2) {
   return (vector_t){x_coord, y_coord};
 }
 
+vector_t calc_softened_gravity_force(double g, double softening,
+                                     body_t *body1, body_t *body2) {
+  vector_t offset =
+      vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
+  double dist_squared = vec_dot(offset, offset) + softening * softening;
+  if (dist_squared == 0)
+    return (vector_t){0, 0};
+
+  // G m1 m2 r / (|r|^2 + e^2)^(3/2): smooth all the way down to |r| = 0
+  double scale = g * body_get_mass(body1) * body_get_mass(body2) /
+                 (dist_squared * sqrt(dist_squared));
+  return vec_multiply(scale, offset);
+}
+
 vector_t calc_drag_force(body_t *body, double gamma) {
   return vec_multiply(gamma, (body_get_velocity(body)));
 }
 
-// Adds gravity forces to bodies
-void gravity_func(void *ginf) {
-  force_info_t *ginfo = (force_info_t *)ginf;
-
-  body_t *body_1 = list_get(ginfo->bodies, 0);
-  body_t *body_2 = list_get(ginfo->bodies, 1);
-  vector_t force = calc_gravity_force(ginfo->constant, body_1, body_2);
-
-  vector_t force_p = {0, 0};
-  force_p.x = force.x;
-  force_p.y = force.y;
-  body_add_force(body_1, force_p);
-
-  vector_t force_pn = {0, 0};
-  force_pn.x = -force.x;
-  force_pn.y = -force.y;
-  body_add_force(body_2, force_pn);
-}
-
-// Add spring forces to bodies
-void spring_func(void *sinf) {
-  force_info_t *sinfo = (force_info_t *)sinf;
-
-  body_t *body_1 = list_get(sinfo->bodies, 0);
-  body_t *body_2 = list_get(sinfo->bodies, 1);
-  vector_t force = calc_spring_force(sinfo->constant, body_1, body_2);
-
-  vector_t force_p = {0, 0};
-  force_p.x = force.x;
-  force_p.y = force.y;
-  body_add_force(body_1, force_p);
-
-  vector_t force_pn = {0, 0};
-  force_pn.x = -force.x;
-  force_pn.y = -force.y;
-  body_add_force(body_2, force_pn);
-}
-
-// Add drag forces to bodies
-void drag_func(void *dinf) {
-  force_info_t *dinfo = (force_info_t *)dinf;
-
-  body_t *body_1 = list_get(dinfo->bodies, 0);
-  vector_t force = calc_drag_force(body_1, dinfo->constant);
-
-  // Force points opposite
-  vector_t force_pn = {0, 0};
-  force_pn.x = -force.x;
-  force_pn.y = -force.y;
-  body_add_force(body_1, force_pn);
-}
-
-// Collision func checks for if there is a collision and if so, applies
-// collision handler
-void collision_func(void *cinf) {
-  collision_force_info_t *cinfo = (collision_force_info_t *)cinf;
-  body_t *body1 = list_get(cinfo->bodies, 0);
-  body_t *body2 = list_get(cinfo->bodies, 1);
-  collision_handler_t handler = cinfo->handler;
-  void *col_aux = cinfo->aux;
-  collision_info_t col_info =
-      find_collision(body_get_shape(body1), body_get_shape(body2));
-
-  // If already in collision,  don't apply more impulses
-  // if it is currenly colliding and it wasn't before
-  // apply the first impulse
-
-  if (col_info.collided && !cinfo->currently_colliding) {
-    cinfo->currently_colliding = true;
-    vector_t axis_of_collision = col_info.axis;
-    set_collision_body(body1, true, body2);
-    set_collision_body(body2, true, body1);
-    cinfo->currently_colliding = true;
-    // Apply collision handler
-    handler(body1, body2, axis_of_collision, col_aux);
-  }
-  // if it is not currently colliding but it used to collide
-  // the next tick should tell code that it wasnt collidng in thee last tick
-  if (!col_info.collided && cinfo->currently_colliding) {
-    cinfo->currently_colliding = false;
-    return;
+// The loops below negate forces in place rather than with vec_negate(),
+// which cannot be inlined from here and is called for every force every tick
+
+/** Applies gravity between each pair of bodies */
+void apply_gravity_forces(force_t *forces, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    force_t *force = &forces[i];
+    if (!force->enabled) {
+      continue;
+    }
+    vector_t gravity =
+        force->gravity.softening > 0
+            ? calc_softened_gravity_force(force->gravity.G,
+                                          force->gravity.softening,
+                                          force->body1, force->body2)
+            : calc_gravity_force(force->gravity.G, force->body1, force->body2);
+    body_add_force(force->body1, gravity);
+    body_add_force(force->body2, (vector_t){-gravity.x, -gravity.y});
   }
+}
 
-  // if it is currently collding and it used to
-  // change nothing; do not apply more impulse
-  if (col_info.collided && cinfo->currently_colliding) {
-    return;
+/** Applies each spring to its pair of bodies */
+void apply_spring_forces(force_t *forces, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    force_t *force = &forces[i];
+    if (!force->enabled) {
+      continue;
+    }
+    vector_t spring =
+        calc_spring_force(force->spring_k, force->body1, force->body2);
+    body_add_force(force->body1, spring);
+    body_add_force(force->body2, (vector_t){-spring.x, -spring.y});
   }
+}
 
-  // if it is currently not colliding and it didnt use to collide
-  if (!col_info.collided && cinfo->currently_colliding) {
-    return;
+/** Applies drag to each body, opposite to its velocity */
+void apply_drag_forces(force_t *forces, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    force_t *force = &forces[i];
+    if (!force->enabled) {
+      continue;
+    }
+    vector_t drag = calc_drag_force(force->body1, force->drag_gamma);
+    body_add_force(force->body1, (vector_t){-drag.x, -drag.y});
   }
 }
 
-// Buoynacy force init function
-buoyancy_force_info_t *buoyancy_force_init(scene_t *scene, double G, body_t *body1, double p, double water_level) {
-  buoyancy_force_info_t *buoyancy_force = malloc(sizeof(buoyancy_force_info_t));
-  assert(buoyancy_force != NULL);
-  // Initialize fields of the buoyancy_force_info_t
-  buoyancy_force->bodies = list_init(1, (free_func_t)NULL);
-  list_add(buoyancy_force->bodies, body1);
-  buoyancy_force->G = G;
-  buoyancy_force->p = p;
-  buoyancy_force->water_level = water_level;
-  return buoyancy_force;
+/**
+ * Marks collisions made by create_physics_collision(). It is never called:
+ * the contact solver resolves these collisions itself, and only uses this
+ * function's address to tell them apart from ones with custom handlers.
+ */
+void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
+                               void *aux) {}
+
+/** Whether a body has stayed where it was last tick */
+bool body_is_still(body_t *body) {
+  return body_is_asleep(body) || body_get_motion(body) == BODY_STATIC;
+}
+
+/**
+ * Whether resolving a contact may move a body. Sleeping bodies hold still
+ * like walls, so that bodies resting on them do not keep waking them.
+ */
+bool body_is_movable(body_t *body) {
+  return body_get_motion(body) == BODY_DYNAMIC && !body_is_asleep(body);
+}
+
+/** The inverse mass contacts see, 0 for bodies they cannot move */
+double contact_inverse_mass(body_t *body) {
+  return body_is_movable(body) ? 1 / body_get_mass(body) : 0;
 }
 
-vector_t calc_buoyancy_force(double g, body_t *body1, double p, double water_level) {
-  // body1 is the duck body
-  vector_t center = body_get_centroid(body1);
-  // If the duck position is above the water level return weird force (-inf, -inf)
-  if(center.y >= water_level){
-    //printf("ABOVE WATER LEVEl %f\n", center.y);
-    return (vector_t){-INFINITY, -INFINITY};
+/** The velocity contacts expect a body to end the tick with */
+vector_t contact_velocity(body_t *body, double dt) {
+  return body_is_movable(body) ? body_predict_velocity(body, dt)
+                               : body_get_velocity(body);
+}
+
+/** Whether a collision cannot do anything to either body */
+bool collision_is_inert(force_t *force) {
+  return force->collision.handler == physics_collision_handler &&
+         body_get_motion(force->body1) != BODY_DYNAMIC &&
+         body_get_motion(force->body2) != BODY_DYNAMIC;
+}
+
+/**
+ * Checks the pairs of bodies in [start, end) for collisions, recording the
+ * results for respond_to_collisions(). Each pair only writes its own force,
+ * so any number of threads can do this at once.
+ */
+void detect_collisions(size_t start, size_t end, void *aux) {
+  force_t *forces = aux;
+  for (size_t i = start; i < end; i++) {
+    force_t *force = &forces[i];
+    if (!force->enabled) {
+      continue;
+    }
+    size_t placements = body_get_placements(force->body1) +
+                        body_get_placements(force->body2);
+    force->collision.placed = placements != force->collision.placements;
+    force->collision.placements = placements;
+    // Bodies that have not moved give the same result as last time
+    if (collision_is_inert(force) ||
+        (!force->collision.placed && body_is_still(force->body1) &&
+         body_is_still(force->body2))) {
+      continue;
+    }
+    force->collision.info = find_shape_collision(
+        get_body_points(force->body1), get_body_points(force->body2));
   }
-  list_t *body_shape = body_get_shape(body1);
-  double area_submerged = body_area(body_shape);
-  double volume_param = CONSTANT_DIMENSION * area_submerged;
-  double mag_force = volume_param * p * g;
-  double y_coord = mag_force * center.y;  
+}
 
-  return (vector_t){center.x, y_coord};
+/**
+ * Moves two overlapping bodies apart along the collision axis by
+ * CONTACT_CORRECTION of their overlap beyond CONTACT_SLOP, the lighter body
+ * moving further. Only positions change, so no energy is added.
+ */
+void correct_overlap(body_t *body1, body_t *body2, collision_info_t *info) {
+  double excess = info->depth - CONTACT_SLOP;
+  double inverse1 = contact_inverse_mass(body1);
+  double inverse2 = contact_inverse_mass(body2);
+  if (excess <= 0 || inverse1 + inverse2 == 0) {
+    return;
+  }
+  vector_t push = vec_multiply(
+      CONTACT_CORRECTION * excess / (inverse1 + inverse2), info->axis);
+  if (inverse1 > 0) {
+    body_move_centroid(body1, vec_subtract(body_get_centroid(body1),
+                                           vec_multiply(inverse1, push)));
+  }
+  if (inverse2 > 0) {
+    body_move_centroid(body2, vec_add(body_get_centroid(body2),
+                                      vec_multiply(inverse2, push)));
+  }
 }
 
-void buoyancy_func(void *ginf) {
-  buoyancy_force_info_t *ginfo = (buoyancy_force_info_t *)ginf;
-  body_t *body_1 = list_get(ginfo->bodies, 0);
-  vector_t force = calc_buoyancy_force(ginfo->G, body_1, ginfo->p,ginfo->water_level);
-  if(!(force.x == -INFINITY && force.y == -INFINITY)) body_add_force(body_1, force);
-  //printf("%f\n", body_get_mass(body_1));
+/**
+ * Adds equal and opposite impulses pushing two bodies apart along an axis,
+ * to the bodies contacts can move
+ */
+void push_apart(body_t *body1, body_t *body2, vector_t axis, double impulse) {
+  vector_t push = vec_multiply(impulse, axis);
+  if (body_is_movable(body1)) {
+    body_add_impulse(body1, vec_negate(push));
+  }
+  if (body_is_movable(body2)) {
+    body_add_impulse(body2, push);
+  }
 }
 
+/** How fast two bodies will be moving apart along an axis after the tick */
+double separating_speed(body_t *body1, body_t *body2, vector_t axis,
+                        double dt) {
+  vector_t velocity1 = contact_velocity(body1, dt);
+  vector_t velocity2 = contact_velocity(body2, dt);
+  return vec_dot(vec_subtract(velocity2, velocity1), axis);
+}
 
-void create_buoyancy(scene_t *scene, double G, body_t *body1, double p, double water_level) {
-  buoyancy_force_info_t *binfo = buoyancy_force_init(scene, G, body1, p, water_level);
-  scene_add_bodies_force_creator(scene, buoyancy_func, (void *)binfo,
-                                 binfo->bodies, (free_func_t)free_force_info);
+/**
+ * Gets a physics collision ready to solve: finds how fast the bodies should
+ * bounce apart, and starts each contact point from its impulse last tick,
+ * if the same features touched then (warm starting)
+ */
+void prepare_contact(force_t *force) {
+  collision_info_t *info = &force->collision.info;
+  body_t *body1 = force->body1;
+  body_t *body2 = force->body2;
+  double approach = vec_dot(
+      vec_subtract(body_get_velocity(body2), body_get_velocity(body1)),
+      info->axis);
+  force->collision.bounce = force->collision.started && approach < 0
+                                ? -*(double *)force->collision.aux * approach
+                                : 0;
+  double impulses[2] = {0, 0};
+  for (size_t i = 0; i < info->num_contacts; i++) {
+    for (size_t j = 0; j < force->collision.num_impulses; j++) {
+      if (force->collision.features[j] == info->features[i]) {
+        impulses[i] = force->collision.impulses[j];
+      }
+    }
+  }
+  for (size_t i = 0; i < info->num_contacts; i++) {
+    force->collision.impulses[i] = impulses[i];
+    force->collision.features[i] = info->features[i];
+    push_apart(body1, body2, info->axis, impulses[i]);
+  }
+  force->collision.num_impulses = info->num_contacts;
 }
 
+/**
+ * Runs one pass of the solver over a physics collision's contact points:
+ * changes each point's impulse so that the bodies will separate at the
+ * bounce speed, never letting the total impulse pull them together
+ */
+void solve_contact(force_t *force, double dt) {
+  body_t *body1 = force->body1;
+  body_t *body2 = force->body2;
+  double inverse_mass =
+      contact_inverse_mass(body1) + contact_inverse_mass(body2);
+  if (inverse_mass == 0) {
+    return;
+  }
+  vector_t axis = force->collision.info.axis;
+  for (size_t i = 0; i < force->collision.num_impulses; i++) {
+    double speed = separating_speed(body1, body2, axis, dt);
+    double total = force->collision.impulses[i] +
+                   (force->collision.bounce - speed) / inverse_mass;
+    total = total > 0 ? total : 0;
+    push_apart(body1, body2, axis, total - force->collision.impulses[i]);
+    force->collision.impulses[i] = total;
+  }
+}
 
-// Duck gravity force force init function
-duck_gravity_force_info_t *duck_gravity_force_init(scene_t *scene, double G, double water_level, body_t *body1, body_t *body2) {
-  duck_gravity_force_info_t *duck_gravity_force = malloc(sizeof(duck_gravity_force_info_t));
-  assert(duck_gravity_force != NULL);
-  // Initialize fields of the duck_gravity_force_t
-  duck_gravity_force->bodies = list_init(2, (free_func_t)NULL);
-  list_add(duck_gravity_force->bodies, body1);
-  list_add(duck_gravity_force->bodies, body2);
-  duck_gravity_force->G = G;
-  duck_gravity_force->water_level = water_level;
-  return duck_gravity_force;
+/**
+ * Solves the physics collisions forces[contacts[i]] together: iterations
+ * passes of sequential impulses, each contact seeing the impulses of those
+ * before it, then the overlaps are corrected. Impulses are only skipped if
+ * moving is false, since nothing can change.
+ */
+void solve_contacts(force_t *forces, const size_t *contacts,
+                    size_t num_contacts, size_t iterations, double dt,
+                    bool moving) {
+  if (moving) {
+    for (size_t i = 0; i < num_contacts; i++) {
+      prepare_contact(&forces[contacts[i]]);
+    }
+    for (size_t pass = 0; pass < iterations; pass++) {
+      for (size_t i = 0; i < num_contacts; i++) {
+        solve_contact(&forces[contacts[i]], dt);
+      }
+    }
+  }
+  for (size_t i = 0; i < num_contacts; i++) {
+    force_t *force = &forces[contacts[i]];
+    correct_overlap(force->body1, force->body2, &force->collision.info);
+  }
 }
 
-void duck_gravity_func(void *dinf){
-  duck_gravity_force_info_t *dinfo = (duck_gravity_force_info_t *)dinf;
-  body_t *body_1 = list_get(dinfo->bodies, 0);
-  body_t *body_2 = list_get(dinfo->bodies, 1);
-  vector_t force = calc_gravity_force(dinfo->G, body_1, body_2);
-  double water_level = dinfo->water_level;
-  // Duck body centroid
-  vector_t duck_centroid = body_get_centroid(body_1);
+/**
+ * Calls the handler of each pair of bodies detect_collisions() found colliding
+ * in forces[start, end), only on the first tick the bodies collide.
+ * Physics collisions are resolved on every tick the bodies touch instead,
+ * unless neither has moved; if islands is not NULL, they are added to it.
+ */
+void respond_to_collisions(force_t *forces, size_t start, size_t end,
+                           islands_t *islands) {
+  for (size_t i = start; i < end; i++) {
+    force_t *force = &forces[i];
+    if (!force->enabled) {
+      continue;
+    }
+    body_t *body1 = force->body1;
+    body_t *body2 = force->body2;
+    bool collided = force->collision.info.collided;
+    if (force->collision.placed && (collided || force->collision.colliding)) {
+      // A body was moved directly, so whatever rested on it or was pushed
+      // into it must move too, and last tick's impulses no longer apply
+      body_wake(body1);
+      body_wake(body2);
+      force->collision.num_impulses = 0;
+    }
+    force->collision.started = collided && !force->collision.colliding;
+    force->collision.colliding = collided;
+    if (!collided) {
+      // Nothing to warm-start from when they touch again
+      force->collision.num_impulses = 0;
+    }
+    if (force->collision.started) {
+      body_wake(body1);
+      body_wake(body2);
+      set_collision_body(body1, true, body2);
+      set_collision_body(body2, true, body1);
+    }
+    if (force->collision.handler != physics_collision_handler) {
+      if (force->collision.started) {
+        force->collision.handler(body1, body2, force->collision.info.axis,
+                                 force->collision.aux);
+      }
+    } else if (collided && !(body_is_still(body1) && body_is_still(body2))) {
+      vector_t approach =
+          vec_subtract(body_get_velocity(body1), body_get_velocity(body2));
+      if (vec_dot(approach, force->collision.info.axis) > CONTACT_WAKE_SPEED) {
+        body_wake(body1);
+        body_wake(body2);
+      }
+      if (islands != NULL) {
+        islands_add_contact(islands, i, body_get_slot(body1),
+                            !body_is_movable(body1),
+                            body_get_slot(body2),
+                            !body_is_movable(body2));
+      } else {
+        solve_contacts(forces, &i, 1, 1, 0, true);
+      }
+    }
+  }
+}
 
-  // Add gravity force to duck/earth if not below water level
-  if(duck_centroid.y > water_level) {
-    body_add_force(body_1, force);
-    body_add_force(body_2, vec_negate(force));
+typedef struct island_task {
+  force_t *forces;
+  islands_t *islands;
+  size_t iterations;
+  double dt;
+} island_task_t;
+
+/** Whether neither body in any of an island's contacts will be moving */
+bool island_at_rest(force_t *forces, const size_t *contacts,
+                    size_t num_contacts, double dt) {
+  for (size_t i = 0; i < num_contacts; i++) {
+    force_t *force = &forces[contacts[i]];
+    vector_t velocity1 = contact_velocity(force->body1, dt);
+    vector_t velocity2 = contact_velocity(force->body2, dt);
+    if (velocity1.x != 0 || velocity1.y != 0 || velocity2.x != 0 ||
+        velocity2.y != 0) {
+      return false;
+    }
   }
+  return true;
 }
-void create_duck_gravity(scene_t *scene, double G, double water_level, body_t *body1, body_t *body2){
-  duck_gravity_force_info_t *dinfo =  duck_gravity_force_init(scene, G, water_level, body1, body2);
-  scene_add_bodies_force_creator(scene, duck_gravity_func, (void *)dinfo,
-                                 dinfo->bodies, (free_func_t)free_force_info);
+
+/** Resolves the contacts in islands [start, end), each in the order added */
+void resolve_islands(size_t start, size_t end, void *aux) {
+  island_task_t *task = aux;
+  for (size_t island = start; island < end; island++) {
+    size_t num_contacts;
+    const size_t *contacts =
+        islands_get_contacts(task->islands, island, &num_contacts);
+    bool moving =
+        !island_at_rest(task->forces, contacts, num_contacts, task->dt);
+    solve_contacts(task->forces, contacts, num_contacts, task->iterations,
+                   task->dt, moving);
+  }
 }
 
-void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
-                              body_t *body2) {
-  force_info_t *finfo = gravity_force_init(scene, G, body1, body2);
+/** Calls each force creator that is (or is not) thread-safe */
+void apply_creator_forces(force_t *forces, size_t count, bool thread_safe) {
+  for (size_t i = 0; i < count; i++) {
+    force_t *force = &forces[i];
+    if (force->enabled && force->creator.thread_safe == thread_safe) {
+      force->creator.forcer(force->creator.aux);
+    }
+  }
+}
 
-  scene_add_bodies_force_creator(scene, gravity_func, (void *)finfo,
-                                 finfo->bodies, (free_func_t)free_force_info);
+/** Finds the end of the run of forces of the same kind starting at start */
+size_t force_run_end(force_t *forces, size_t count, size_t start) {
+  size_t end = start + 1;
+  while (end < count && forces[end].kind == forces[start].kind) {
+    end++;
+  }
+  return end;
 }
 
-void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2) {
-  force_info_t *finfo = spring_force_init(scene, k, body1, body2);
-  scene_add_bodies_force_creator(scene, spring_func, (void *)finfo,
-                                 finfo->bodies, (free_func_t)free_force_info);
+void forces_apply(force_t *forces, size_t count) {
+  forces_detect_collisions(forces, count, false);
+  forces_apply_concurrent(forces, count, 0, 1);
+  forces_apply_serial(forces, count, NULL);
 }
 
-void create_drag(scene_t *scene, double gamma, body_t *body) {
-  force_info_t *finfo = drag_force_init(scene, gamma, body);
-  scene_add_bodies_force_creator(scene, drag_func, (void *)finfo, finfo->bodies,
-                                 (free_func_t)free_force_info);
+void forces_detect_collisions(force_t *forces, size_t count, bool parallel) {
+  for (size_t start = 0; start < count;) {
+    size_t end = force_run_end(forces, count, start);
+    if (forces[start].kind != FORCE_COLLISION) {
+      start = end;
+      continue;
+    }
+    if (parallel) {
+      job_parallel_for(end - start, COLLISION_DETECT_GRAIN, detect_collisions,
+                       &forces[start]);
+    } else {
+      detect_collisions(0, end - start, &forces[start]);
+    }
+    break;
+  }
 }
 
 /**
- * Handles two bodies destructively colliding
- **/
-void destructive_collision_handler(body_t *body1, body_t *body2, vector_t axis,
-                                   void *aux) {
-  body_remove(body1);
-  body_remove(body2);
+ * Finds how far along the pair's motion two bodies hit each other, if they
+ * passed through each other during a tick, or returns INFINITY
+ */
+double find_pair_impact(force_t *force, const vector_t *motions) {
+  body_t *body1 = force->body1;
+  body_t *body2 = force->body2;
+  vector_t motion1 = motions[body_get_slot(body1)];
+  vector_t motion2 = motions[body_get_slot(body2)];
+  vector_t relative = vec_subtract(motion2, motion1);
+  double distance = sqrt(vec_dot(relative, relative));
+  if (distance == 0 ||
+      (!body_is_bullet(body1) && !body_is_bullet(body2) &&
+       distance <= SWEEP_MIN_MOTION *
+                       (body_get_width(body1) + body_get_width(body2)))) {
+    return INFINITY;
+  }
+  list_t *shape1 = get_body_points(body1);
+  list_t *shape2 = get_body_points(body2);
+  vector_t axis;
+  double impact = find_time_of_impact(shape1, motion1, shape2, motion2, &axis);
+  // Pairs that overlapped at the start were seen then, and pairs that still
+  // overlap will be seen next tick
+  if (impact == 0 || impact > 1 ||
+      find_shape_collision(shape1, shape2).collided) {
+    return INFINITY;
+  }
+  double approach = fabs(vec_dot(relative, axis));
+  return fmin(1, impact + SWEEP_CONTACT_DEPTH / approach);
 }
 
-// Applies impulses
-void apply_impulse(body_t *body1, body_t *body2, vector_t axis,
-                   double elasticity) {
+void forces_find_impacts(force_t *forces, size_t count,
+                         const vector_t *motions, size_t num_slots,
+                         double *impacts) {
+  size_t start = 0;
+  while (start < count && forces[start].kind != FORCE_COLLISION) {
+    start = force_run_end(forces, count, start);
+  }
+  size_t end = start < count ? force_run_end(forces, count, start) : count;
+  for (size_t i = start; i < end; i++) {
+    force_t *force = &forces[i];
+    // Only contacts stop bodies: triggers such as pickups are passed through
+    if (!force->enabled ||
+        force->collision.handler != physics_collision_handler ||
+        collision_is_inert(force)) {
+      continue;
+    }
+    body_t *body1 = force->body1;
+    body_t *body2 = force->body2;
+    if (body_is_removed(body1) || body_is_removed(body2)) {
+      continue;
+    }
+    size_t slot1 = body_get_slot(body1);
+    size_t slot2 = body_get_slot(body2);
+    bool dynamic1 = body_get_motion(body1) == BODY_DYNAMIC;
+    bool dynamic2 = body_get_motion(body2) == BODY_DYNAMIC;
+    if (slot1 >= num_slots || slot2 >= num_slots || (!dynamic1 && !dynamic2)) {
+      continue;
+    }
+    double impact = find_pair_impact(force, motions);
+    if (dynamic1 && impact < impacts[slot1]) {
+      impacts[slot1] = impact;
+    }
+    if (dynamic2 && impact < impacts[slot2]) {
+      impacts[slot2] = impact;
+    }
+  }
+}
 
-  vector_t vel1 = body_get_velocity(body1);
-  vector_t vel2 = body_get_velocity(body2);
-  double mass1 = body_get_mass(body1);
-  double mass2 = body_get_mass(body2);
-  double vel_dif = -vec_dot(vel1, axis) + vec_dot(vel2, axis);
+void forces_apply_concurrent(force_t *forces, size_t count, size_t part,
+                             size_t num_parts) {
+  assert(part < num_parts);
+  for (size_t start = 0; start < count;) {
+    size_t end = force_run_end(forces, count, start);
+    // This part's slice of the run
+    size_t first = start + (end - start) * part / num_parts;
+    size_t last = start + (end - start) * (part + 1) / num_parts;
+    switch (forces[start].kind) {
+    case FORCE_GRAVITY:
+      apply_gravity_forces(&forces[first], last - first);
+      break;
+    case FORCE_SPRING:
+      apply_spring_forces(&forces[first], last - first);
+      break;
+    case FORCE_DRAG:
+      apply_drag_forces(&forces[first], last - first);
+      break;
+    case FORCE_COLLISION:
+      // See forces_detect_collisions()
+      break;
+    case FORCE_CREATOR:
+      apply_creator_forces(&forces[first], last - first, true);
+      break;
+    }
+    start = end;
+  }
+}
 
-  // Get reduced mass (dependent on whether a mass is INFINITY)
-  double red_mass;
-  if (mass1 == INFINITY) {
-    red_mass = mass2;
-  } else if (mass2 == INFINITY) {
-    red_mass = mass1;
+/**
+ * Finds the run of forces of a kind, returning where it starts and setting
+ * *end to where it ends; both are count if there are none
+ */
+size_t find_force_run(force_t *forces, size_t count, force_kind_t kind,
+                      size_t *end) {
+  for (size_t start = 0; start < count;) {
+    *end = force_run_end(forces, count, start);
+    if (forces[start].kind == kind) {
+      return start;
+    }
+    start = *end;
+  }
+  *end = count;
+  return count;
+}
+
+void forces_apply_serial(force_t *forces, size_t count, islands_t *islands) {
+  // Each run is in the order its forces were added, so merging them by id
+  // runs handlers and creators in that order, as they may read each other's
+  // forces
+  size_t collisions_end, creators_end;
+  size_t collision =
+      find_force_run(forces, count, FORCE_COLLISION, &collisions_end);
+  size_t creator = find_force_run(forces, count, FORCE_CREATOR, &creators_end);
+  while (collision < collisions_end || creator < creators_end) {
+    if (creator == creators_end ||
+        (collision < collisions_end &&
+         forces[collision].id < forces[creator].id)) {
+      respond_to_collisions(forces, collision, collision + 1, islands);
+      collision++;
+    } else {
+      apply_creator_forces(&forces[creator], 1, false);
+      creator++;
+    }
+  }
+}
+
+void forces_resolve_islands(force_t *forces, islands_t *islands,
+                            size_t iterations, double dt, bool parallel) {
+  size_t num_islands = islands_build(islands);
+  island_task_t task = {.forces = forces,
+                        .islands = islands,
+                        .iterations = iterations,
+                        .dt = dt};
+  if (parallel) {
+    job_parallel_for(num_islands, ISLAND_RESOLVE_GRAIN, resolve_islands,
+                     &task);
   } else {
-    red_mass = (mass1 * mass2) / (mass1 + mass2);
+    resolve_islands(0, num_islands, &task);
   }
+}
 
-  // Calculate + add impulses to both bodies
-  vector_t impulse = vec_multiply(red_mass * (elasticity + 1) * vel_dif, axis);
-  body_add_impulse(body1, (impulse));
-  body_add_impulse(body2, vec_negate(impulse));
+void force_free(force_t *force) {
+  if (force->kind == FORCE_COLLISION && force->collision.freer != NULL) {
+    force->collision.freer(force->collision.aux);
+  }
+  if (force->kind == FORCE_CREATOR) {
+    if (force->creator.freer != NULL) {
+      force->creator.freer(force->creator.aux);
+    }
+    list_free(force->creator.bodies);
+  }
 }
 
+void buoyancy_func(void *binf) {
+  buoyancy_info_t *info = (buoyancy_info_t *)binf;
+  size_t num_bodies = list_size(info->bodies);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(info->bodies, i);
+    if (info->condition != NULL && !info->condition(body, info->aux)) {
+      continue;
+    }
+    // The surface is taken to be flat across the body, at its average height
+    list_t *points = get_body_points(body);
+    double left = INFINITY, right = -INFINITY;
+    size_t num_points = list_size(points);
+    for (size_t j = 0; j < num_points; j++) {
+      double x = ((vector_t *)list_get(points, j))->x;
+      left = fmin(left, x);
+      right = fmax(right, x);
+    }
+    double water_level = water_get_mean_height(info->water, left, right);
+    vector_t center_of_buoyancy;
+    double area = polygon_clip_below(points, water_level, &center_of_buoyancy);
+    // Bodies have no rotation, so the force acts as if at the centroid
+    if (area > 0) {
+      body_add_force(body, (vector_t){0, info->density * info->g * area});
+    }
+  }
+}
 
+size_t create_buoyancy(scene_t *scene, double density, double g,
+                       water_t *water, list_t *bodies,
+                       force_condition_t condition, void *aux) {
+  buoyancy_info_t *info = malloc(sizeof(buoyancy_info_t));
+  assert(info != NULL);
+  info->bodies = list_init(list_size(bodies) + 1, (free_func_t)NULL);
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    list_add(info->bodies, list_get(bodies, i));
+  }
+  info->density = density;
+  info->g = g;
+  info->water = water;
+  info->condition = condition;
+  info->aux = aux;
+  size_t id = scene_add_group_force_creator(scene, buoyancy_func, (void *)info,
+                                            info->bodies, free);
+  scene_set_force_thread_safe(scene, id, true);
+  return id;
+}
 
-/**
- * Handles two bodies nondstructively colliding (colliding with physics)
- * In this case, aux will contain a double that represents elasticity
- *
- */
-void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
-                               void *aux) {
-  // Auxillary function should contain elasticity
-  double elasticity = *((double *)aux);
-  apply_impulse(body1, body2, axis, elasticity);
+void uniform_gravity_func(void *uinf) {
+  uniform_gravity_info_t *info = (uniform_gravity_info_t *)uinf;
+  size_t num_bodies = list_size(info->bodies);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(info->bodies, i);
+    double mass = body_get_mass(body);
+    // Bodies with infinite mass could not be moved anyway
+    if (isfinite(mass) &&
+        (info->condition == NULL || info->condition(body, info->aux))) {
+      body_add_force(body, vec_multiply(mass, info->acceleration));
+    }
+  }
 }
 
-void create_collision(scene_t *scene, body_t *body1, body_t *body2,
-                      collision_handler_t handler, void *aux,
-                      free_func_t freer) {
-  collision_force_info_t *col_info =
-      collision_force_init(scene, body1, body2, aux, handler);
+size_t create_uniform_gravity(scene_t *scene, vector_t acceleration,
+                              list_t *bodies, force_condition_t condition,
+                              void *aux) {
+  uniform_gravity_info_t *info = malloc(sizeof(uniform_gravity_info_t));
+  assert(info != NULL);
+  info->bodies = list_init(list_size(bodies) + 1, (free_func_t)NULL);
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    list_add(info->bodies, list_get(bodies, i));
+  }
+  info->acceleration = acceleration;
+  info->condition = condition;
+  info->aux = aux;
+  size_t id = scene_add_group_force_creator(scene, uniform_gravity_func,
+                                            (void *)info, info->bodies, free);
+  scene_set_force_thread_safe(scene, id, true);
+  return id;
+}
 
-  scene_add_bodies_force_creator(scene, (force_creator_t)collision_func,
-                                 (void *)col_info, col_info->bodies, freer);
+size_t create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
+                                body_t *body2) {
+  return create_softened_gravity(scene, G, 0, body1, body2);
+}
+
+size_t create_softened_gravity(scene_t *scene, double G, double softening,
+                               body_t *body1, body_t *body2) {
+  force_t force = {.kind = FORCE_GRAVITY,
+                   .body1 = body1,
+                   .body2 = body2,
+                   .gravity = {.G = G, .softening = softening}};
+  return scene_add_force(scene, &force);
+}
+
+/** Applies softened gravity between every pair of bodies in a group */
+void direct_gravity(nbody_gravity_info_t *info) {
+  size_t num_bodies = list_size(info->bodies);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body_1 = list_get(info->bodies, i);
+    for (size_t j = i + 1; j < num_bodies; j++) {
+      body_t *body_2 = list_get(info->bodies, j);
+      vector_t force =
+          calc_softened_gravity_force(info->G, info->softening, body_1, body_2);
+      body_add_force(body_1, force);
+      body_add_force(body_2, vec_negate(force));
+    }
+  }
 }
 
-void create_destructive_collision(scene_t *scene, body_t *body1,
-                                  body_t *body2) {
+void nbody_gravity_func(void *ginf) {
+  nbody_gravity_info_t *info = (nbody_gravity_info_t *)ginf;
+  size_t num_bodies = list_size(info->bodies);
+  if (num_bodies < BARNES_HUT_MIN_BODIES) {
+    direct_gravity(info);
+    return;
+  }
+
+  if (info->capacity < num_bodies) {
+    info->capacity = num_bodies;
+    info->positions =
+        realloc(info->positions, sizeof(*info->positions) * num_bodies);
+    info->masses = realloc(info->masses, sizeof(*info->masses) * num_bodies);
+    assert(info->positions != NULL && info->masses != NULL);
+  }
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(info->bodies, i);
+    info->positions[i] = body_get_centroid(body);
+    info->masses[i] = body_get_mass(body);
+  }
+  quadtree_build(info->tree, info->positions, info->masses, num_bodies);
+  for (size_t i = 0; i < num_bodies; i++) {
+    vector_t field = quadtree_field(info->tree, info->positions[i],
+                                    info->theta, info->softening);
+    body_add_force(list_get(info->bodies, i),
+                   vec_multiply(info->G * info->masses[i], field));
+  }
+}
+
+size_t create_nbody_gravity(scene_t *scene, double G, double softening,
+                            double theta, list_t *bodies) {
+  nbody_gravity_info_t *info = malloc(sizeof(nbody_gravity_info_t));
+  assert(info != NULL);
+  info->bodies = list_init(list_size(bodies) + 1, (free_func_t)NULL);
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    list_add(info->bodies, list_get(bodies, i));
+  }
+  info->G = G;
+  info->softening = softening;
+  info->theta = theta;
+  info->tree = quadtree_init();
+  info->positions = NULL;
+  info->masses = NULL;
+  info->capacity = 0;
+  size_t id = scene_add_group_force_creator(
+      scene, nbody_gravity_func, (void *)info, info->bodies,
+      (free_func_t)free_nbody_gravity_info);
+  scene_set_force_thread_safe(scene, id, true);
+  return id;
+}
+
+void pairwise_force_func(void *pinf) {
+  pairwise_force_info_t *info = (pairwise_force_info_t *)pinf;
+  particles_t *particles = info->particles;
+  size_t num_bodies = list_size(info->bodies);
+  particles_resize(particles, num_bodies);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(info->bodies, i);
+    vector_t centroid = body_get_centroid(body);
+    particles->x[i] = centroid.x;
+    particles->y[i] = centroid.y;
+    particles->strength[i] =
+        info->use_charges ? body_get_charge(body) : body_get_mass(body);
+  }
+  particles_pairwise_forces(particles, info->coupling, info->softening, 0);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_add_force(list_get(info->bodies, i),
+                   (vector_t){particles->force_x[i], particles->force_y[i]});
+  }
+}
+
+size_t create_pairwise_force(scene_t *scene, double coupling, double softening,
+                             bool use_charges, list_t *bodies) {
+  pairwise_force_info_t *info = malloc(sizeof(pairwise_force_info_t));
+  assert(info != NULL);
+  info->bodies = list_init(list_size(bodies) + 1, (free_func_t)NULL);
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    list_add(info->bodies, list_get(bodies, i));
+  }
+  info->coupling = coupling;
+  info->softening = softening;
+  info->use_charges = use_charges;
+  info->particles = particles_init();
+  size_t id = scene_add_group_force_creator(
+      scene, pairwise_force_func, (void *)info, info->bodies,
+      (free_func_t)free_pairwise_force_info);
+  scene_set_force_thread_safe(scene, id, true);
+  return id;
+}
+
+size_t create_pairwise_gravity(scene_t *scene, double G, double softening,
+                               list_t *bodies) {
+  return create_pairwise_force(scene, G, softening, false, bodies);
+}
+
+size_t create_coulomb_force(scene_t *scene, double k, double softening,
+                            list_t *bodies) {
+  return create_pairwise_force(scene, -k, softening, true, bodies);
+}
+
+size_t create_spring(scene_t *scene, double k, body_t *body1, body_t *body2) {
+  force_t force = {
+      .kind = FORCE_SPRING, .body1 = body1, .body2 = body2, .spring_k = k};
+  return scene_add_force(scene, &force);
+}
+
+size_t create_drag(scene_t *scene, double gamma, body_t *body) {
+  force_t force = {.kind = FORCE_DRAG, .body1 = body, .drag_gamma = gamma};
+  return scene_add_force(scene, &force);
+}
+
+/**
+ * Handles two bodies destructively colliding
+ **/
+void destructive_collision_handler(body_t *body1, body_t *body2, vector_t axis,
+                                   void *aux) {
+  body_remove(body1);
+  body_remove(body2);
+}
+
+size_t create_collision(scene_t *scene, body_t *body1, body_t *body2,
+                        collision_handler_t handler, void *aux,
+                        free_func_t freer) {
+  force_t force = {
+      .kind = FORCE_COLLISION,
+      .body1 = body1,
+      .body2 = body2,
+      .collision = {.handler = handler, .aux = aux, .freer = freer}};
+  return scene_add_force(scene, &force);
+}
 
-  play_coin();
-  create_collision(scene, body1, body2,
-                   (collision_handler_t)destructive_collision_handler,
-                   (void *)scene, NULL);
-  // Return list of bodies associated with destructive collision
+size_t create_destructive_collision(scene_t *scene, body_t *body1,
+                                    body_t *body2) {
+  return create_collision(scene, body1, body2,
+                          (collision_handler_t)destructive_collision_handler,
+                          (void *)scene, NULL);
 }
 
-void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
-                              body_t *body2) {
+size_t create_physics_collision(scene_t *scene, double elasticity,
+                                body_t *body1, body_t *body2) {
   double *elas_aux = malloc(sizeof(double));
   *elas_aux = elasticity;
   // Call create_collision with all of the info (auxillary contains elasticity)
-  create_collision(scene, body1, body2,
-                   (collision_handler_t)physics_collision_handler,
-                   (void *)elas_aux, (free_func_t)free);
+  return create_collision(scene, body1, body2,
+                          (collision_handler_t)physics_collision_handler,
+                          (void *)elas_aux, (free_func_t)free);
 }
@@ -0,0 +1,183 @@
+#include "island.h"
+#include <assert.h>
+#include <stdlib.h>
+
+// Marks a root that has not been given an island yet
+const size_t ISLAND_NONE = (size_t)-1;
+
+typedef struct contact {
+  size_t index;
+  size_t slot; // a body in the contact that can move
+} contact_t;
+
+typedef struct islands {
+  // Union-find over body slots: each slot's parent, and for roots,
+  // the number of slots in the set
+  size_t *parent;
+  size_t *set_size;
+  size_t num_bodies;
+  size_t body_capacity;
+  contact_t *contacts;
+  size_t num_contacts;
+  size_t contact_capacity;
+  // Built by islands_build(): the island of each root, each island's first
+  // contact in sorted and its root, and the contact indices grouped by island
+  size_t *island_of_root;
+  size_t *island_start;
+  size_t *island_root;
+  size_t *sorted;
+  size_t sorted_capacity;
+  size_t num_islands;
+} islands_t;
+
+islands_t *islands_init(void) {
+  islands_t *islands = malloc(sizeof(islands_t));
+  assert(islands != NULL);
+  *islands = (islands_t){0};
+  return islands;
+}
+
+void islands_free(islands_t *islands) {
+  free(islands->parent);
+  free(islands->set_size);
+  free(islands->island_of_root);
+  free(islands->contacts);
+  free(islands->island_start);
+  free(islands->island_root);
+  free(islands->sorted);
+  free(islands);
+}
+
+void islands_clear(islands_t *islands, size_t num_bodies) {
+  if (islands->body_capacity < num_bodies) {
+    islands->body_capacity = num_bodies;
+    size_t **arrays[] = {&islands->parent, &islands->set_size,
+                         &islands->island_of_root};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(*arrays); i++) {
+      *arrays[i] = realloc(*arrays[i], sizeof(size_t) * num_bodies);
+      assert(*arrays[i] != NULL);
+    }
+  }
+  for (size_t i = 0; i < num_bodies; i++) {
+    islands->parent[i] = i;
+    islands->set_size[i] = 1;
+  }
+  islands->num_bodies = num_bodies;
+  islands->num_contacts = 0;
+  islands->num_islands = 0;
+}
+
+/** Finds the root of a slot's set, moving the slots on the way closer to it */
+size_t find_root(islands_t *islands, size_t slot) {
+  size_t *parent = islands->parent;
+  while (parent[slot] != slot) {
+    parent[slot] = parent[parent[slot]];
+    slot = parent[slot];
+  }
+  return slot;
+}
+
+/** Merges the sets of two slots, hanging the smaller under the larger */
+void join_sets(islands_t *islands, size_t slot1, size_t slot2) {
+  size_t root1 = find_root(islands, slot1);
+  size_t root2 = find_root(islands, slot2);
+  if (root1 == root2) {
+    return;
+  }
+  if (islands->set_size[root1] < islands->set_size[root2]) {
+    size_t swap = root1;
+    root1 = root2;
+    root2 = swap;
+  }
+  islands->parent[root2] = root1;
+  islands->set_size[root1] += islands->set_size[root2];
+}
+
+void islands_add_contact(islands_t *islands, size_t contact, size_t slot1,
+                         bool fixed1, size_t slot2, bool fixed2) {
+  if (fixed1 && fixed2) {
+    return;
+  }
+  assert(slot1 < islands->num_bodies && slot2 < islands->num_bodies);
+  if (!fixed1 && !fixed2) {
+    join_sets(islands, slot1, slot2);
+  }
+  if (islands->num_contacts == islands->contact_capacity) {
+    islands->contact_capacity =
+        islands->contact_capacity > 0 ? 2 * islands->contact_capacity : 16;
+    islands->contacts = realloc(
+        islands->contacts, sizeof(contact_t) * islands->contact_capacity);
+    assert(islands->contacts != NULL);
+  }
+  islands->contacts[islands->num_contacts++] =
+      (contact_t){.index = contact, .slot = fixed1 ? slot2 : slot1};
+}
+
+size_t islands_build(islands_t *islands) {
+  size_t num_contacts = islands->num_contacts;
+  // Room for an island per contact, plus the end of the last one
+  if (islands->sorted_capacity < num_contacts + 1) {
+    islands->sorted_capacity = num_contacts + 1;
+    size_t **arrays[] = {&islands->island_start, &islands->island_root,
+                         &islands->sorted};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(*arrays); i++) {
+      *arrays[i] =
+          realloc(*arrays[i], sizeof(size_t) * islands->sorted_capacity);
+      assert(*arrays[i] != NULL);
+    }
+  }
+
+  // Number the islands in the order of their first contacts,
+  // and count the contacts in each
+  size_t num_islands = 0;
+  for (size_t i = 0; i < num_contacts; i++) {
+    size_t root = find_root(islands, islands->contacts[i].slot);
+    islands->island_of_root[root] = ISLAND_NONE;
+  }
+  for (size_t i = 0; i < num_contacts; i++) {
+    size_t root = find_root(islands, islands->contacts[i].slot);
+    if (islands->island_of_root[root] == ISLAND_NONE) {
+      islands->island_of_root[root] = num_islands;
+      islands->island_root[num_islands] = root;
+      islands->island_start[num_islands] = 0;
+      num_islands++;
+    }
+    islands->island_start[islands->island_of_root[root]]++;
+  }
+  // Turn the counts into where each island starts, then place the contacts
+  size_t total = 0;
+  for (size_t i = 0; i < num_islands; i++) {
+    size_t count = islands->island_start[i];
+    islands->island_start[i] = total;
+    total += count;
+  }
+  islands->island_start[num_islands] = total;
+  for (size_t i = 0; i < num_contacts; i++) {
+    size_t island =
+        islands->island_of_root[find_root(islands, islands->contacts[i].slot)];
+    // island_start moves along as contacts are placed, and is put back below
+    islands->sorted[islands->island_start[island]++] =
+        islands->contacts[i].index;
+  }
+  for (size_t i = num_islands; i > 0; i--) {
+    islands->island_start[i] = islands->island_start[i - 1];
+  }
+  islands->island_start[0] = 0;
+  islands->num_islands = num_islands;
+  return num_islands;
+}
+
+size_t islands_count(islands_t *islands) { return islands->num_islands; }
+
+const size_t *islands_get_contacts(islands_t *islands, size_t island,
+                                   size_t *num_contacts) {
+  assert(island < islands->num_islands);
+  size_t start = islands->island_start[island];
+  *num_contacts = islands->island_start[island + 1] - start;
+  return &islands->sorted[start];
+}
+
+size_t islands_get_size(islands_t *islands, size_t island) {
+  assert(island < islands->num_islands);
+  return islands->set_size[islands->island_root[island]];
+}
@@ -0,0 +1,456 @@
+#include "job.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+// The most worker threads the pool starts
+const size_t JOB_MAX_WORKERS = 31;
+// Each queue starts with room for this many jobs, and doubles when full
+const size_t JOB_QUEUE_INITIAL_CAPACITY = 64;
+
+typedef struct job {
+  job_func_t func; // NULL for part of a job_parallel_for()
+  void *aux;
+  job_range_func_t range_func;
+  size_t start;
+  size_t end;
+  size_t grain;
+  job_group_t *group;
+  struct job *next; // the next job waiting for the same group
+} job_t;
+
+typedef struct job_group {
+  // Jobs added to the group that have not finished. Only changed while
+  // holding lock, so that the group can be freed once this reaches 0.
+  SDL_atomic_t remaining;
+  SDL_SpinLock lock;
+  job_t *waiting; // jobs to queue once remaining reaches 0
+} job_group_t;
+
+/**
+ * A double-ended queue of jobs, stored as a ring buffer. Its owner adds and
+ * takes jobs at the bottom; other threads steal them from the top.
+ */
+typedef struct job_queue {
+  SDL_SpinLock lock;
+  job_t **jobs;
+  size_t capacity;
+  size_t top;
+  size_t count;
+} job_queue_t;
+
+/**
+ * Whether the pool is running. Guarded by start_lock while starting.
+ */
+SDL_atomic_t pool_running = {0};
+SDL_SpinLock start_lock = 0;
+size_t num_workers = 0;
+SDL_Thread **workers = NULL;
+size_t num_started = 0;
+/**
+ * A queue for each worker, then one shared by all other threads.
+ */
+job_queue_t *queues = NULL;
+/**
+ * The queue of the calling thread, or NULL outside the pool.
+ */
+_Thread_local job_queue_t *own_queue = NULL;
+/**
+ * The number of jobs in all the queues.
+ */
+SDL_atomic_t queued = {0};
+/**
+ * The number of threads asleep on wake. A thread changes this and then checks
+ * for work, and a thread adding work changes that and then checks this,
+ * so one of the two always sees the other.
+ */
+SDL_atomic_t sleepers = {0};
+SDL_mutex *idle_lock = NULL;
+SDL_cond *wake = NULL;
+SDL_atomic_t stopping = {0};
+/**
+ * Jobs started with job_run_background(), taken oldest first,
+ * how many are queued, and how many workers are running them.
+ */
+job_queue_t background_queue = {0};
+SDL_atomic_t background_queued = {0};
+SDL_atomic_t background_running = {0};
+
+void queue_push(job_queue_t *queue, job_t *job) {
+  SDL_AtomicLock(&queue->lock);
+  if (queue->count == queue->capacity) {
+    size_t capacity = queue->capacity > 0 ? 2 * queue->capacity
+                                          : JOB_QUEUE_INITIAL_CAPACITY;
+    job_t **jobs = malloc(sizeof(job_t *) * capacity);
+    assert(jobs != NULL);
+    for (size_t i = 0; i < queue->count; i++) {
+      jobs[i] = queue->jobs[(queue->top + i) % queue->capacity];
+    }
+    free(queue->jobs);
+    queue->jobs = jobs;
+    queue->capacity = capacity;
+    queue->top = 0;
+  }
+  queue->jobs[(queue->top + queue->count) % queue->capacity] = job;
+  queue->count++;
+  SDL_AtomicUnlock(&queue->lock);
+}
+
+/** Takes the newest job from a queue, or returns NULL if it is empty */
+job_t *queue_pop(job_queue_t *queue) {
+  job_t *job = NULL;
+  SDL_AtomicLock(&queue->lock);
+  if (queue->count > 0) {
+    queue->count--;
+    job = queue->jobs[(queue->top + queue->count) % queue->capacity];
+  }
+  SDL_AtomicUnlock(&queue->lock);
+  return job;
+}
+
+/** Takes the oldest job from a queue, or returns NULL if it is empty */
+job_t *queue_steal(job_queue_t *queue) {
+  job_t *job = NULL;
+  SDL_AtomicLock(&queue->lock);
+  if (queue->count > 0) {
+    job = queue->jobs[queue->top];
+    queue->top = (queue->top + 1) % queue->capacity;
+    queue->count--;
+  }
+  SDL_AtomicUnlock(&queue->lock);
+  return job;
+}
+
+/** Wakes a sleeping thread, if there are any, to take a new job */
+void wake_one(void) {
+  if (SDL_AtomicGet(&sleepers) > 0) {
+    SDL_LockMutex(idle_lock);
+    SDL_CondSignal(wake);
+    SDL_UnlockMutex(idle_lock);
+  }
+}
+
+/** Takes the next job for the calling thread, or NULL if none are queued */
+job_t *take_job(void) {
+  job_queue_t *own = own_queue != NULL ? own_queue : &queues[num_workers];
+  job_t *job = queue_pop(own);
+  // Steal from the other queues, starting after this thread's own
+  size_t first = own - queues;
+  for (size_t i = 1; job == NULL && i <= num_workers; i++) {
+    job = queue_steal(&queues[(first + i) % (num_workers + 1)]);
+  }
+  if (job != NULL) {
+    SDL_AtomicAdd(&queued, -1);
+  }
+  return job;
+}
+
+/** The most background jobs that may run at once */
+int max_background_jobs(void) {
+  // Leave a worker for jobs that someone is waiting for
+  return num_workers > 1 ? num_workers - 1 : 1;
+}
+
+/** Whether a worker with nothing else to do should take a background job */
+bool background_job_ready(void) {
+  return SDL_AtomicGet(&background_queued) > 0 &&
+         SDL_AtomicGet(&background_running) < max_background_jobs();
+}
+
+/**
+ * Takes the oldest background job for a worker, counting it as running,
+ * or returns NULL if none are queued or enough are running already
+ */
+job_t *take_background_job(void) {
+  if (SDL_AtomicGet(&background_queued) == 0) {
+    return NULL;
+  }
+  if (SDL_AtomicAdd(&background_running, 1) >= max_background_jobs()) {
+    SDL_AtomicAdd(&background_running, -1);
+    return NULL;
+  }
+  job_t *job = queue_steal(&background_queue);
+  if (job == NULL) {
+    SDL_AtomicAdd(&background_running, -1);
+    return NULL;
+  }
+  SDL_AtomicAdd(&background_queued, -1);
+  return job;
+}
+
+void run_job(job_t *job);
+
+/** Queues a job whose group already counts it */
+void queue_job(job_t *job) {
+  if (num_workers == 0) {
+    run_job(job);
+    return;
+  }
+  queue_push(own_queue != NULL ? own_queue : &queues[num_workers], job);
+  SDL_AtomicIncRef(&queued);
+  wake_one();
+}
+
+/** Marks one of a group's jobs finished, queueing the jobs waiting for it */
+void finish_job(job_group_t *group) {
+  SDL_AtomicLock(&group->lock);
+  bool done = SDL_AtomicAdd(&group->remaining, -1) == 1;
+  job_t *waiting = done ? group->waiting : NULL;
+  if (done) {
+    group->waiting = NULL;
+  }
+  SDL_AtomicUnlock(&group->lock);
+  // The group may be freed from here on
+  if (!done) {
+    return;
+  }
+  while (waiting != NULL) {
+    job_t *next = waiting->next;
+    queue_job(waiting);
+    waiting = next;
+  }
+  // Threads waiting for the group may be asleep
+  if (SDL_AtomicGet(&sleepers) > 0) {
+    SDL_LockMutex(idle_lock);
+    SDL_CondBroadcast(wake);
+    SDL_UnlockMutex(idle_lock);
+  }
+}
+
+job_t *job_init(job_group_t *group, job_func_t func, void *aux) {
+  job_t *job = malloc(sizeof(job_t));
+  assert(job != NULL);
+  *job = (job_t){.func = func, .aux = aux, .group = group};
+  SDL_AtomicAdd(&group->remaining, 1);
+  return job;
+}
+
+void run_job(job_t *job) {
+  if (job->func != NULL) {
+    job->func(job->aux);
+  } else {
+    // Hand the second half of the range to any thread that wants it,
+    // and keep splitting the first half
+    while (job->end - job->start > job->grain) {
+      job_t *rest = job_init(job->group, NULL, job->aux);
+      rest->range_func = job->range_func;
+      rest->start = job->start + (job->end - job->start) / 2;
+      rest->end = job->end;
+      rest->grain = job->grain;
+      job->end = rest->start;
+      queue_job(rest);
+    }
+    job->range_func(job->start, job->end, job->aux);
+  }
+  job_group_t *group = job->group;
+  free(job);
+  finish_job(group);
+}
+
+int job_worker(void *aux) {
+  own_queue = aux;
+  while (true) {
+    job_t *job = take_job();
+    if (job != NULL) {
+      run_job(job);
+      continue;
+    }
+    job = take_background_job();
+    if (job != NULL) {
+      run_job(job);
+      SDL_AtomicAdd(&background_running, -1);
+      continue;
+    }
+    if (SDL_AtomicGet(&stopping)) {
+      return 0;
+    }
+    SDL_AtomicIncRef(&sleepers);
+    SDL_LockMutex(idle_lock);
+    while (SDL_AtomicGet(&queued) == 0 && !background_job_ready() &&
+           !SDL_AtomicGet(&stopping)) {
+      SDL_CondWait(wake, idle_lock);
+    }
+    SDL_UnlockMutex(idle_lock);
+    SDL_AtomicAdd(&sleepers, -1);
+  }
+}
+
+void job_system_init(size_t requested) {
+  SDL_AtomicLock(&start_lock);
+  if (SDL_AtomicGet(&pool_running)) {
+    SDL_AtomicUnlock(&start_lock);
+    return;
+  }
+#ifdef __EMSCRIPTEN__
+  requested = 0;
+#else
+  if (requested == 0) {
+    requested = SDL_GetCPUCount() - 1;
+  }
+  if (requested > JOB_MAX_WORKERS) {
+    requested = JOB_MAX_WORKERS;
+  }
+#endif
+  queues = calloc(requested + 1, sizeof(job_queue_t));
+  workers = malloc(sizeof(SDL_Thread *) * (requested + 1));
+  assert(queues != NULL && workers != NULL);
+  idle_lock = SDL_CreateMutex();
+  wake = SDL_CreateCond();
+  SDL_AtomicSet(&stopping, 0);
+  // Set before the workers start, since they read it. If some fail to start,
+  // their queues just stay empty.
+  num_workers = requested;
+  num_started = 0;
+  for (size_t i = 0; i < requested; i++) {
+    workers[i] = SDL_CreateThread(job_worker, "jobs", &queues[i]);
+    if (workers[i] == NULL) {
+      break;
+    }
+    num_started++;
+  }
+  if (num_started == 0) {
+    num_workers = 0;
+  }
+  SDL_AtomicSet(&pool_running, 1);
+  SDL_AtomicUnlock(&start_lock);
+}
+
+void job_system_shutdown(void) {
+  SDL_AtomicLock(&start_lock);
+  if (!SDL_AtomicGet(&pool_running)) {
+    SDL_AtomicUnlock(&start_lock);
+    return;
+  }
+  // The shared queue may still hold jobs nobody waited for
+  job_t *job;
+  while ((job = take_job()) != NULL) {
+    run_job(job);
+  }
+  while ((job = queue_steal(&background_queue)) != NULL) {
+    SDL_AtomicAdd(&background_queued, -1);
+    run_job(job);
+  }
+  SDL_AtomicSet(&stopping, 1);
+  SDL_LockMutex(idle_lock);
+  SDL_CondBroadcast(wake);
+  SDL_UnlockMutex(idle_lock);
+  for (size_t i = 0; i < num_started; i++) {
+    SDL_WaitThread(workers[i], NULL);
+  }
+  for (size_t i = 0; i <= num_workers; i++) {
+    free(queues[i].jobs);
+  }
+  free(queues);
+  free(workers);
+  free(background_queue.jobs);
+  background_queue = (job_queue_t){0};
+  SDL_DestroyCond(wake);
+  SDL_DestroyMutex(idle_lock);
+  num_workers = 0;
+  SDL_AtomicSet(&pool_running, 0);
+  SDL_AtomicUnlock(&start_lock);
+}
+
+size_t job_system_threads(void) {
+  job_system_init(0);
+  return num_workers + 1;
+}
+
+job_group_t *job_group_init(void) {
+  job_system_init(0);
+  job_group_t *group = malloc(sizeof(job_group_t));
+  assert(group != NULL);
+  SDL_AtomicSet(&group->remaining, 0);
+  group->lock = 0;
+  group->waiting = NULL;
+  return group;
+}
+
+void job_group_free(job_group_t *group) {
+  job_group_wait(group);
+  free(group);
+}
+
+void job_run(job_group_t *group, job_func_t func, void *aux) {
+  queue_job(job_init(group, func, aux));
+}
+
+void job_run_background(job_group_t *group, job_func_t func, void *aux) {
+  job_t *job = job_init(group, func, aux);
+  if (num_workers == 0) {
+    run_job(job);
+    return;
+  }
+  queue_push(&background_queue, job);
+  SDL_AtomicIncRef(&background_queued);
+  // Any sleeper might be waiting for a group rather than a worker,
+  // so wake them all
+  if (SDL_AtomicGet(&sleepers) > 0) {
+    SDL_LockMutex(idle_lock);
+    SDL_CondBroadcast(wake);
+    SDL_UnlockMutex(idle_lock);
+  }
+}
+
+void job_run_after(job_group_t *group, job_group_t *dependency,
+                   job_func_t func, void *aux) {
+  job_t *job = job_init(group, func, aux);
+  SDL_AtomicLock(&dependency->lock);
+  if (SDL_AtomicGet(&dependency->remaining) > 0) {
+    job->next = dependency->waiting;
+    dependency->waiting = job;
+    job = NULL;
+  }
+  SDL_AtomicUnlock(&dependency->lock);
+  if (job != NULL) {
+    queue_job(job);
+  }
+}
+
+void job_group_wait(job_group_t *group) {
+  while (SDL_AtomicGet(&group->remaining) > 0) {
+    job_t *job = take_job();
+    if (job != NULL) {
+      run_job(job);
+      continue;
+    }
+    // The rest of the group's jobs are running on other threads
+    SDL_AtomicIncRef(&sleepers);
+    SDL_LockMutex(idle_lock);
+    while (SDL_AtomicGet(&group->remaining) > 0 &&
+           SDL_AtomicGet(&queued) == 0) {
+      SDL_CondWait(wake, idle_lock);
+    }
+    SDL_UnlockMutex(idle_lock);
+    SDL_AtomicAdd(&sleepers, -1);
+  }
+  // The last job to finish may still hold the lock
+  SDL_AtomicLock(&group->lock);
+  SDL_AtomicUnlock(&group->lock);
+  // This thread may have been woken for a job it then left for someone else
+  if (SDL_AtomicGet(&queued) > 0) {
+    wake_one();
+  }
+}
+
+void job_parallel_for(size_t count, size_t grain, job_range_func_t func,
+                      void *aux) {
+  if (count == 0) {
+    return;
+  }
+  grain = grain > 0 ? grain : 1;
+  if (count <= grain || job_system_threads() == 1) {
+    func(0, count, aux);
+    return;
+  }
+  job_group_t *group = job_group_init();
+  job_t *job = job_init(group, NULL, aux);
+  job->range_func = func;
+  job->start = 0;
+  job->end = count;
+  job->grain = grain;
+  // This thread starts splitting the range right away
+  run_job(job);
+  job_group_free(group);
+}
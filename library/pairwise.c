@@ -0,0 +1,207 @@
+#include "pairwise.h"
+#include "job.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Particles per tile. Two tiles of positions, strengths and forces
+// (40 bytes per particle) fit in a 32 KB L1 cache.
+const size_t PAIRWISE_TILE_SIZE = 256;
+// Fewer particles than this are not worth starting threads for
+const size_t PAIRWISE_PARALLEL_MIN = 2048;
+#define PAIRWISE_MAX_THREADS 16
+// Independent force sums per particle in the inner loop. Splitting the sums
+// lets the compiler vectorize them without reordering floating-point additions.
+#define PAIRWISE_LANES 4
+// Squared distances are raised to at least this, so that particles at the
+// same position get a huge but finite scale, which times their 0 offset is 0
+const double PAIRWISE_MIN_DIST_SQUARED = 1e-100;
+
+/** The tile pairs one thread computes */
+typedef struct pairwise_task {
+  particles_t *particles;
+  double coupling;
+  double softening_squared;
+  double *force_x; // where this thread adds up its forces
+  double *force_y;
+  size_t first_pair; // computes every stride'th tile pair from first_pair
+  size_t stride;
+} pairwise_task_t;
+
+particles_t *particles_init(void) {
+  particles_t *particles = malloc(sizeof(particles_t));
+  assert(particles != NULL);
+  *particles = (particles_t){0};
+  return particles;
+}
+
+void particles_free(particles_t *particles) {
+  free(particles->x);
+  free(particles->y);
+  free(particles->strength);
+  free(particles->force_x);
+  free(particles->force_y);
+  free(particles->thread_forces);
+  free(particles);
+}
+
+void particles_resize(particles_t *particles, size_t count) {
+  if (particles->capacity < count) {
+    particles->capacity = count;
+    double **arrays[] = {&particles->x, &particles->y, &particles->strength,
+                         &particles->force_x, &particles->force_y};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(*arrays); i++) {
+      *arrays[i] = realloc(*arrays[i], sizeof(double) * count);
+      assert(*arrays[i] != NULL);
+    }
+  }
+  particles->count = count;
+}
+
+/**
+ * Adds the force between particles i and j to j, and to particle i's sums
+ * fx and fy. Small enough for the compiler to inline into tile_forces().
+ */
+void pair_force(const double *restrict x, const double *restrict y,
+                const double *restrict strength, double *restrict force_x,
+                double *restrict force_y, size_t j, double xi, double yi,
+                double si, double softening_squared, double *fx, double *fy) {
+  double dx = x[j] - xi;
+  double dy = y[j] - yi;
+  double dist_squared = dx * dx + dy * dy + softening_squared;
+  dist_squared = dist_squared < PAIRWISE_MIN_DIST_SQUARED
+                     ? PAIRWISE_MIN_DIST_SQUARED
+                     : dist_squared;
+  double scale = si * strength[j] / (dist_squared * sqrt(dist_squared));
+  *fx += scale * dx;
+  *fy += scale * dy;
+  force_x[j] -= scale * dx;
+  force_y[j] -= scale * dy;
+}
+
+/**
+ * Adds the forces between the particles in [i_start, i_end) and those in
+ * [j_start, j_end) to both. If the ranges are the same tile,
+ * each pair within it is computed once.
+ */
+void tile_forces(const double *restrict x, const double *restrict y,
+                 const double *restrict strength, double *restrict force_x,
+                 double *restrict force_y, size_t i_start, size_t i_end,
+                 size_t j_start, size_t j_end, double coupling,
+                 double softening_squared) {
+  for (size_t i = i_start; i < i_end; i++) {
+    double xi = x[i], yi = y[i], si = coupling * strength[i];
+    double fx[PAIRWISE_LANES] = {0}, fy[PAIRWISE_LANES] = {0};
+    size_t j = j_start == i_start ? i + 1 : j_start;
+    for (; j + PAIRWISE_LANES <= j_end; j += PAIRWISE_LANES) {
+      for (size_t k = 0; k < PAIRWISE_LANES; k++) {
+        pair_force(x, y, strength, force_x, force_y, j + k, xi, yi, si,
+                   softening_squared, &fx[k], &fy[k]);
+      }
+    }
+    for (; j < j_end; j++) {
+      pair_force(x, y, strength, force_x, force_y, j, xi, yi, si,
+                 softening_squared, &fx[0], &fy[0]);
+    }
+    for (size_t k = 0; k < PAIRWISE_LANES; k++) {
+      force_x[i] += fx[k];
+      force_y[i] += fy[k];
+    }
+  }
+}
+
+void run_pairwise_task(void *aux) {
+  pairwise_task_t *task = aux;
+  particles_t *particles = task->particles;
+  size_t count = particles->count;
+  memset(task->force_x, 0, sizeof(double) * count);
+  memset(task->force_y, 0, sizeof(double) * count);
+
+  size_t num_tiles = (count + PAIRWISE_TILE_SIZE - 1) / PAIRWISE_TILE_SIZE;
+  size_t pair = 0;
+  for (size_t i = 0; i < num_tiles; i++) {
+    for (size_t j = i; j < num_tiles; j++, pair++) {
+      if (pair % task->stride != task->first_pair) {
+        continue;
+      }
+      size_t i_start = i * PAIRWISE_TILE_SIZE;
+      size_t j_start = j * PAIRWISE_TILE_SIZE;
+      size_t i_end = i_start + PAIRWISE_TILE_SIZE;
+      size_t j_end = j_start + PAIRWISE_TILE_SIZE;
+      tile_forces(particles->x, particles->y, particles->strength,
+                  task->force_x, task->force_y, i_start,
+                  i_end < count ? i_end : count, j_start,
+                  j_end < count ? j_end : count, task->coupling,
+                  task->softening_squared);
+    }
+  }
+}
+
+/** Picks how many threads to split the tile pairs across */
+size_t pairwise_thread_count(size_t count, size_t requested) {
+#ifdef __EMSCRIPTEN__
+  return 1;
+#else
+  size_t num_threads = requested;
+  if (num_threads == 0) {
+    num_threads = count < PAIRWISE_PARALLEL_MIN ? 1 : job_system_threads();
+  }
+  size_t num_tiles = (count + PAIRWISE_TILE_SIZE - 1) / PAIRWISE_TILE_SIZE;
+  size_t num_pairs = num_tiles * (num_tiles + 1) / 2;
+  if (num_threads > num_pairs) {
+    num_threads = num_pairs;
+  }
+  if (num_threads > PAIRWISE_MAX_THREADS) {
+    num_threads = PAIRWISE_MAX_THREADS;
+  }
+  return num_threads > 0 ? num_threads : 1;
+#endif
+}
+
+void particles_pairwise_forces(particles_t *particles, double coupling,
+                               double softening, size_t num_threads) {
+  size_t count = particles->count;
+  num_threads = pairwise_thread_count(count, num_threads);
+  pairwise_task_t tasks[PAIRWISE_MAX_THREADS];
+  for (size_t i = 0; i < num_threads; i++) {
+    tasks[i] = (pairwise_task_t){.particles = particles,
+                                 .coupling = coupling,
+                                 .softening_squared = softening * softening,
+                                 .first_pair = i,
+                                 .stride = num_threads};
+  }
+
+  if (num_threads == 1) {
+    tasks[0].force_x = particles->force_x;
+    tasks[0].force_y = particles->force_y;
+    run_pairwise_task(&tasks[0]);
+    return;
+  }
+
+  if (particles->thread_capacity < 2 * count * num_threads) {
+    particles->thread_capacity = 2 * count * num_threads;
+    particles->thread_forces =
+        realloc(particles->thread_forces,
+                sizeof(double) * particles->thread_capacity);
+    assert(particles->thread_forces != NULL);
+  }
+  job_group_t *group = job_group_init();
+  for (size_t i = 0; i < num_threads; i++) {
+    tasks[i].force_x = particles->thread_forces + 2 * count * i;
+    tasks[i].force_y = tasks[i].force_x + count;
+    job_run(group, run_pairwise_task, &tasks[i]);
+  }
+  job_group_free(group);
+
+  for (size_t i = 0; i < count; i++) {
+    double force_x = 0, force_y = 0;
+    for (size_t j = 0; j < num_threads; j++) {
+      force_x += tasks[j].force_x[i];
+      force_y += tasks[j].force_y[i];
+    }
+    particles->force_x[i] = force_x;
+    particles->force_y[i] = force_y;
+  }
+}
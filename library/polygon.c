@@ -1,10 +1,12 @@
 #include "color.h"
 #include "list.h"
 #include "vector.h"
+#include <assert.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 typedef struct polygon {
   rgb_color_t col;
@@ -103,3 +105,183 @@ void polygon_rotate(list_t *polygon, double angle, vector_t point) {
                               cos(angle) * (y_coord - point.y));
   }
 }
+
+/**
+ * Returns whether point lies inside the triangle abc (or on its boundary).
+ * orientation is 1 if abc is counterclockwise and -1 if clockwise.
+ */
+bool in_triangle(vector_t point, vector_t a, vector_t b, vector_t c,
+                 double orientation) {
+  return vec_cross(vec_subtract(b, a), vec_subtract(point, a)) * orientation >=
+             0 &&
+         vec_cross(vec_subtract(c, b), vec_subtract(point, b)) * orientation >=
+             0 &&
+         vec_cross(vec_subtract(a, c), vec_subtract(point, c)) * orientation >=
+             0;
+}
+
+/**
+ * Returns whether the vertex at position i of the remaining polygon is an ear:
+ * a convex corner whose triangle contains no other remaining vertex.
+ */
+bool is_ear(list_t *polygon, size_t *remaining, size_t count, size_t i,
+            double orientation) {
+  vector_t prev = *(vector_t *)list_get(polygon, remaining[(i + count - 1) % count]);
+  vector_t cur = *(vector_t *)list_get(polygon, remaining[i]);
+  vector_t next = *(vector_t *)list_get(polygon, remaining[(i + 1) % count]);
+  if (vec_cross(vec_subtract(cur, prev), vec_subtract(next, cur)) * orientation <=
+      0) {
+    return false;
+  }
+  for (size_t j = 0; j < count; j++) {
+    vector_t other = *(vector_t *)list_get(polygon, remaining[j]);
+    bool is_corner = j == i || j == (i + 1) % count ||
+                     j == (i + count - 1) % count;
+    if (!is_corner && in_triangle(other, prev, cur, next, orientation)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t polygon_triangulate(list_t *polygon, size_t *triangles) {
+  size_t n = list_size(polygon);
+  if (n < 3) {
+    return 0;
+  }
+
+  // Twice the signed area tells us which way the vertices wind
+  double signed_area = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    signed_area += vec_cross(*(vector_t *)list_get(polygon, i),
+                             *(vector_t *)list_get(polygon, (i + 1) % n));
+  }
+  double orientation = signed_area < 0 ? -1 : 1;
+
+  size_t *remaining = malloc(sizeof(*remaining) * n);
+  assert(remaining != NULL);
+  for (size_t i = 0; i < n; i++) {
+    remaining[i] = i;
+  }
+
+  // Repeatedly cut off an ear until only one triangle is left
+  size_t count = n, num_triangles = 0, misses = 0, i = 0;
+  while (count > 3) {
+    // A self-intersecting polygon may have no ears; cut a corner anyway
+    // so that every polygon gets filled
+    if (misses < count && !is_ear(polygon, remaining, count, i, orientation)) {
+      i = (i + 1) % count;
+      misses++;
+      continue;
+    }
+    size_t *triangle = &triangles[3 * num_triangles++];
+    triangle[0] = remaining[(i + count - 1) % count];
+    triangle[1] = remaining[i];
+    triangle[2] = remaining[(i + 1) % count];
+    memmove(&remaining[i], &remaining[i + 1],
+            sizeof(*remaining) * (count - i - 1));
+    count--;
+    i %= count;
+    misses = 0;
+  }
+  size_t *triangle = &triangles[3 * num_triangles++];
+  triangle[0] = remaining[0];
+  triangle[1] = remaining[1];
+  triangle[2] = remaining[2];
+  free(remaining);
+  return num_triangles;
+}
+
+/**
+ * Running shoelace sums over the vertices of a clipped polygon,
+ * relative to an origin near the polygon to limit rounding error
+ */
+typedef struct clip_sums {
+  vector_t origin;
+  vector_t first;
+  vector_t previous;
+  bool started;
+  double twice_area; // signed
+  vector_t moment;
+} clip_sums_t;
+
+void clip_add_edge(clip_sums_t *sums, vector_t from, vector_t to) {
+  double cross = from.x * to.y - to.x * from.y;
+  sums->twice_area += cross;
+  sums->moment.x += (from.x + to.x) * cross;
+  sums->moment.y += (from.y + to.y) * cross;
+}
+
+/** Adds the next vertex of the clipped polygon */
+void clip_add_vertex(clip_sums_t *sums, vector_t vertex) {
+  vertex = vec_subtract(vertex, sums->origin);
+  if (!sums->started) {
+    sums->first = vertex;
+    sums->started = true;
+  } else {
+    clip_add_edge(sums, sums->previous, vertex);
+  }
+  sums->previous = vertex;
+}
+
+double polygon_clip_below(list_t *polygon, double level, vector_t *centroid) {
+  size_t size = list_size(polygon);
+  if (size < 3) {
+    return 0;
+  }
+  clip_sums_t sums = {.origin = *(vector_t *)list_get(polygon, 0)};
+
+  // Sutherland-Hodgman against one line: keep the vertices below it,
+  // and add a vertex wherever an edge crosses it
+  vector_t from = *(vector_t *)list_get(polygon, size - 1);
+  for (size_t i = 0; i < size; i++) {
+    vector_t to = *(vector_t *)list_get(polygon, i);
+    bool from_below = from.y <= level;
+    bool to_below = to.y <= level;
+    if (from_below != to_below) {
+      double t = (level - from.y) / (to.y - from.y);
+      clip_add_vertex(&sums, (vector_t){from.x + t * (to.x - from.x), level});
+    }
+    if (to_below) {
+      clip_add_vertex(&sums, to);
+    }
+    from = to;
+  }
+  if (!sums.started) {
+    return 0;
+  }
+  clip_add_edge(&sums, sums.previous, sums.first);
+
+  if (sums.twice_area == 0) {
+    return 0;
+  }
+  *centroid = vec_add(sums.origin, vec_multiply(1 / (3 * sums.twice_area),
+                                                sums.moment));
+  return fabs(sums.twice_area) / 2;
+}
+
+double polygon_width(list_t *polygon) {
+  size_t size = list_size(polygon);
+  if (size < 3) {
+    return 0;
+  }
+  double width = INFINITY;
+  for (size_t i = 0; i < size; i++) {
+    vector_t point = *(vector_t *)list_get(polygon, i);
+    vector_t next = *(vector_t *)list_get(polygon, (i + 1) % size);
+    vector_t edge = vec_subtract(next, point);
+    double length = sqrt(vec_dot(edge, edge));
+    if (length == 0) {
+      continue;
+    }
+    // The farthest vertex from the edge's line, on either side
+    double farthest = 0;
+    for (size_t j = 0; j < size; j++) {
+      vector_t offset = vec_subtract(*(vector_t *)list_get(polygon, j), point);
+      double distance = fabs(vec_cross(edge, offset)) / length;
+      farthest = distance > farthest ? distance : farthest;
+    }
+    width = farthest < width ? farthest : width;
+  }
+  return isinf(width) ? 0 : width;
+}
@@ -0,0 +1,234 @@
+#include "quadtree.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Nodes with at most this many points are not split
+const size_t QUADTREE_LEAF_SIZE = 8;
+// Deeper nodes are not split, so coincident points cannot recurse forever
+#define QUADTREE_MAX_DEPTH 32
+// Enough for a depth-first walk, which holds at most 3 siblings per level
+#define QUADTREE_STACK_SIZE (3 * QUADTREE_MAX_DEPTH + 4)
+
+typedef struct quadtree_node {
+  vector_t center; // of the node's square
+  double size;     // the width of the node's square
+  vector_t center_of_mass;
+  double mass;
+  size_t first_child; // the first of 4 consecutive children, or 0 for a leaf
+  size_t start;       // the node's points in the tree's arrays
+  size_t count;
+} quadtree_node_t;
+
+typedef struct quadtree {
+  quadtree_node_t *nodes; // the root is nodes[0]
+  size_t num_nodes;
+  size_t node_capacity;
+  // Sorted so that every node's points are next to each other
+  vector_t *positions;
+  double *masses;
+  size_t num_points;
+  size_t point_capacity;
+} quadtree_t;
+
+quadtree_t *quadtree_init(void) {
+  quadtree_t *tree = malloc(sizeof(quadtree_t));
+  assert(tree != NULL);
+  tree->nodes = NULL;
+  tree->num_nodes = 0;
+  tree->node_capacity = 0;
+  tree->positions = NULL;
+  tree->masses = NULL;
+  tree->num_points = 0;
+  tree->point_capacity = 0;
+  return tree;
+}
+
+void quadtree_free(quadtree_t *tree) {
+  free(tree->nodes);
+  free(tree->positions);
+  free(tree->masses);
+  free(tree);
+}
+
+/** Adds a node, returning its index. Invalidates pointers to nodes. */
+size_t add_node(quadtree_t *tree, vector_t center, double size, size_t start,
+                size_t count) {
+  if (tree->num_nodes == tree->node_capacity) {
+    tree->node_capacity = tree->node_capacity ? 2 * tree->node_capacity : 64;
+    tree->nodes =
+        realloc(tree->nodes, sizeof(*tree->nodes) * tree->node_capacity);
+    assert(tree->nodes != NULL);
+  }
+  tree->nodes[tree->num_nodes] = (quadtree_node_t){
+      .center = center, .size = size, .start = start, .count = count};
+  return tree->num_nodes++;
+}
+
+void swap_points(quadtree_t *tree, size_t i, size_t j) {
+  vector_t position = tree->positions[i];
+  tree->positions[i] = tree->positions[j];
+  tree->positions[j] = position;
+  double mass = tree->masses[i];
+  tree->masses[i] = tree->masses[j];
+  tree->masses[j] = mass;
+}
+
+/**
+ * Moves the points in [start, end) whose x (or y) is below split
+ * to the front, returning where the rest start.
+ */
+size_t partition_points(quadtree_t *tree, size_t start, size_t end, bool by_x,
+                        double split) {
+  size_t middle = start;
+  for (size_t i = start; i < end; i++) {
+    double coordinate = by_x ? tree->positions[i].x : tree->positions[i].y;
+    if (coordinate < split) {
+      swap_points(tree, i, middle++);
+    }
+  }
+  return middle;
+}
+
+void build_node(quadtree_t *tree, size_t index, size_t depth) {
+  quadtree_node_t node = tree->nodes[index];
+  size_t end = node.start + node.count;
+
+  if (node.count <= QUADTREE_LEAF_SIZE || depth == QUADTREE_MAX_DEPTH) {
+    double mass = 0;
+    vector_t moment = VEC_ZERO;
+    for (size_t i = node.start; i < end; i++) {
+      mass += tree->masses[i];
+      moment =
+          vec_add(moment, vec_multiply(tree->masses[i], tree->positions[i]));
+    }
+    tree->nodes[index].mass = mass;
+    tree->nodes[index].center_of_mass =
+        mass > 0 ? vec_multiply(1 / mass, moment) : node.center;
+    return;
+  }
+
+  // Split into quadrants: left-bottom, left-top, right-bottom, right-top
+  size_t right = partition_points(tree, node.start, end, true, node.center.x);
+  size_t bounds[5] = {
+      node.start,
+      partition_points(tree, node.start, right, false, node.center.y), right,
+      partition_points(tree, right, end, false, node.center.y), end};
+  double quarter = node.size / 4;
+  vector_t offsets[4] = {{-quarter, -quarter},
+                         {-quarter, quarter},
+                         {quarter, -quarter},
+                         {quarter, quarter}};
+  size_t first_child = tree->num_nodes;
+  for (size_t i = 0; i < 4; i++) {
+    add_node(tree, vec_add(node.center, offsets[i]), node.size / 2, bounds[i],
+             bounds[i + 1] - bounds[i]);
+  }
+  tree->nodes[index].first_child = first_child;
+
+  double mass = 0;
+  vector_t moment = VEC_ZERO;
+  for (size_t i = 0; i < 4; i++) {
+    build_node(tree, first_child + i, depth + 1);
+    quadtree_node_t *child = &tree->nodes[first_child + i];
+    mass += child->mass;
+    moment = vec_add(moment, vec_multiply(child->mass, child->center_of_mass));
+  }
+  tree->nodes[index].mass = mass;
+  tree->nodes[index].center_of_mass =
+      mass > 0 ? vec_multiply(1 / mass, moment) : node.center;
+}
+
+void quadtree_build(quadtree_t *tree, const vector_t *positions,
+                    const double *masses, size_t num_points) {
+  if (tree->point_capacity < num_points) {
+    tree->point_capacity = num_points;
+    tree->positions =
+        realloc(tree->positions, sizeof(*tree->positions) * num_points);
+    tree->masses = realloc(tree->masses, sizeof(*tree->masses) * num_points);
+    assert(tree->positions != NULL && tree->masses != NULL);
+  }
+  tree->num_points = num_points;
+  tree->num_nodes = 0;
+
+  // The root is the smallest square around every point
+  vector_t min = {INFINITY, INFINITY};
+  vector_t max = {-INFINITY, -INFINITY};
+  for (size_t i = 0; i < num_points; i++) {
+    tree->positions[i] = positions[i];
+    tree->masses[i] = masses[i];
+    min = (vector_t){fmin(min.x, positions[i].x), fmin(min.y, positions[i].y)};
+    max = (vector_t){fmax(max.x, positions[i].x), fmax(max.y, positions[i].y)};
+  }
+  if (num_points == 0) {
+    min = max = VEC_ZERO;
+  }
+  // Slightly larger, so the points on the top and right edges are inside
+  double size = fmax(max.x - min.x, max.y - min.y) * (1 + 1e-9) + 1e-9;
+  add_node(tree, vec_multiply(0.5, vec_add(min, max)), size, 0, num_points);
+  build_node(tree, 0, 0);
+}
+
+/**
+ * Adds the field of one point mass to field; see quadtree_field().
+ * Written out without the vec_ functions, which cannot be inlined from here,
+ * since this runs for most pairs of points.
+ */
+void add_point_field(vector_t *field, vector_t position, vector_t source,
+                     double mass, double softening_squared) {
+  double dx = source.x - position.x;
+  double dy = source.y - position.y;
+  double dist_squared = dx * dx + dy * dy + softening_squared;
+  if (dist_squared == 0) {
+    return;
+  }
+  double scale = mass / (dist_squared * sqrt(dist_squared));
+  field->x += scale * dx;
+  field->y += scale * dy;
+}
+
+vector_t quadtree_field(quadtree_t *tree, vector_t position, double theta,
+                        double softening) {
+  vector_t field = VEC_ZERO;
+  if (tree->num_nodes == 0) {
+    return field;
+  }
+  double softening_squared = softening * softening;
+  size_t stack[QUADTREE_STACK_SIZE];
+  size_t stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    quadtree_node_t *node = &tree->nodes[stack[--stack_size]];
+    if (node->count == 0) {
+      continue;
+    }
+    if (node->first_child == 0) {
+      for (size_t i = node->start; i < node->start + node->count; i++) {
+        add_point_field(&field, position, tree->positions[i], tree->masses[i],
+                        softening_squared);
+      }
+      continue;
+    }
+
+    // Use the node's center of mass if it is far enough away,
+    // and never for a node the position is inside of
+    double dx = node->center_of_mass.x - position.x;
+    double dy = node->center_of_mass.y - position.y;
+    double half = node->size / 2;
+    bool inside = fabs(position.x - node->center.x) <= half &&
+                  fabs(position.y - node->center.y) <= half;
+    if (!inside &&
+        node->size * node->size < theta * theta * (dx * dx + dy * dy)) {
+      add_point_field(&field, position, node->center_of_mass, node->mass,
+                      softening_squared);
+    } else {
+      for (size_t i = 0; i < 4; i++) {
+        assert(stack_size < QUADTREE_STACK_SIZE);
+        stack[stack_size++] = node->first_child + i;
+      }
+    }
+  }
+  return field;
+}
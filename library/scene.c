@@ -1,24 +1,79 @@
 
 #include "scene.h"
 #include "forces.h"
+#include "island.h"
+#include "job.h"
 #include "polygon.h"
 #include <assert.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 //#include "test_util.h"
 #include <math.h>
 
 const int INIT_NUM = 10;
+// Default length of each step taken by scene_advance(), in seconds
+const double DEFAULT_TIMESTEP = 1.0 / 120.0;
+// Default most steps taken by one call to scene_advance()
+const size_t DEFAULT_MAX_SUBSTEPS = 8;
+// Default passes the contact solver makes over each island per force evaluation
+const size_t DEFAULT_SOLVER_ITERATIONS = 4;
+// Scenes with fewer forces than this are not worth starting threads for
+const size_t SCENE_PARALLEL_MIN_FORCES = 256;
+#define SCENE_MAX_THREADS 16
 
 typedef struct scene {
   list_t *bodies;
-  list_t *force_creators;
-  list_t *force_info;
-  list_t *force_freers;
-  list_t *force_bodies;
+  force_t *forces; // sorted by kind; see scene_add_force()
+  size_t num_forces;
+  size_t force_capacity;
+  // Forces added while forces are being applied, e.g. by collision handlers.
+  // They join forces afterwards, so that forces never moves while in use.
+  force_t *pending_forces;
+  size_t num_pending_forces;
+  size_t pending_capacity;
+  bool applying_forces;
+  size_t next_force_id;
+  size_t num_threads; // see scene_set_threads()
+  // Each thread's force and impulse sums, 2 vectors per body per thread
+  vector_t *thread_sums;
+  size_t thread_sums_capacity;
+  islands_t *islands; // the contacts resolved by the last force evaluation
+  // Where each body started the tick, and then how far it moved,
+  // 2 vectors per body, and how far back along that it should be put
+  vector_t *sweep_state;
+  double *impacts;
+  size_t sweep_capacity;
+  bool sleeping;            // see scene_set_sleeping()
+  size_t solver_iterations; // see scene_set_solver_iterations()
+  double timestep;
+  size_t max_substeps;
+  double accumulator;   // time passed to scene_advance() but not yet simulated
+  double interpolation; // see scene_get_interpolation()
+  integrator_t integrator;
+  // Starting state and weighted sums of derivatives for each body,
+  // 4 vectors per body, used by INTEGRATOR_RK4
+  vector_t *rk4_state;
+  size_t rk4_capacity;
 } scene_t;
 
+/** The slice of the scene's forces one thread applies */
+typedef struct force_task {
+  force_t *forces;
+  size_t num_forces;
+  size_t part;
+  size_t num_parts;
+  vector_t *forces_out; // where this thread adds up its forces
+  vector_t *impulses;
+  size_t num_bodies;
+} force_task_t;
+
+// Weights of the 4 stages of RK4 in the final update
+const double RK4_WEIGHTS[] = {1, 2, 2, 1};
+// How far into the tick each of the last 3 stages of RK4 is evaluated
+const double RK4_OFFSETS[] = {0.5, 0.5, 1};
+
 
 
 bool isclose1(double d1, double d2) { return fabs(d1 - d2) < 1e-7; }
@@ -37,30 +92,52 @@ scene_t *scene_init(void) {
   list_t *bods = list_init(INIT_NUM, (free_func_t)body_free);
   scene->bodies = bods;
 
-  // Initialize force lists
-  scene->force_creators = list_init(INIT_NUM, NULL);
-  scene->force_info = list_init(INIT_NUM, NULL);
-  scene->force_freers = list_init(INIT_NUM, NULL);
-  scene->force_bodies = list_init(INIT_NUM, (free_func_t)list_free);
-
+  // Initialize force arrays
+  scene->forces = malloc(sizeof(force_t) * INIT_NUM);
+  assert(scene->forces != NULL);
+  scene->num_forces = 0;
+  scene->force_capacity = INIT_NUM;
+  scene->pending_forces = NULL;
+  scene->num_pending_forces = 0;
+  scene->pending_capacity = 0;
+  scene->applying_forces = false;
+  scene->next_force_id = 1;
+  scene->num_threads = 1;
+  scene->thread_sums = NULL;
+  scene->thread_sums_capacity = 0;
+  scene->islands = islands_init();
+  scene->sweep_state = NULL;
+  scene->impacts = NULL;
+  scene->sweep_capacity = 0;
+  scene->sleeping = false;
+  scene->solver_iterations = DEFAULT_SOLVER_ITERATIONS;
 
+  scene->timestep = DEFAULT_TIMESTEP;
+  scene->max_substeps = DEFAULT_MAX_SUBSTEPS;
+  scene->accumulator = 0.0;
+  scene->interpolation = 1.0;
+  scene->integrator = INTEGRATOR_AVERAGE_VELOCITY;
+  scene->rk4_state = NULL;
+  scene->rk4_capacity = 0;
   return scene;
 }
 
 void scene_free(scene_t *scene) {
   list_free(scene->bodies);
-  for (size_t i = 0; i < list_size(scene->force_info); i++) {
-    if ((free_func_t)list_get(scene->force_freers, i) != NULL) {
-      ((free_func_t)list_get(scene->force_freers, i))(
-          list_get(scene->force_info, i));
-    }
+  for (size_t i = 0; i < scene->num_forces; i++) {
+    force_free(&scene->forces[i]);
   }
-  list_free(scene->force_info);
-  list_free(scene->force_creators);
-  list_free(scene->force_freers);
-
-  list_free(scene->force_bodies);
+  for (size_t i = 0; i < scene->num_pending_forces; i++) {
+    force_free(&scene->pending_forces[i]);
+  }
+  free(scene->forces);
+  free(scene->pending_forces);
+  free(scene->thread_sums);
+  islands_free(scene->islands);
 
+  free(scene->rk4_state);
+  free(scene->sweep_state);
+  free(scene->impacts);
   free(scene);
 }
 
@@ -74,35 +151,70 @@ void scene_add_body(scene_t *scene, body_t *body) {
   list_add(scene->bodies, body);
 }
 
-void scene_remove_body_forces(scene_t *scene, body_t *body) {
-  size_t forces_size = list_size(scene->force_creators);
-  for (size_t i = 0; i < list_size(scene->force_info); i++) {
-  }
-  for (size_t i = 0; i < forces_size; i++) {
-    // Get current bodies
-    list_t *bodies = list_get(scene->force_bodies, i);
-    assert(bodies != NULL);
-    for (size_t j = 0; j < list_size(bodies); j++) {
-      // If the body is the body we want to remove, we want to get rid of the
-      // forces related to it
-      if (list_get(bodies, j) == body) {
-        // Want to remove from all force lists
-        free_func_t freer = list_get(scene->force_freers, i);
-        list_remove(scene->force_creators, i);
-        if (freer == NULL)
-          list_remove(scene->force_info, i);
-        else
-          freer(list_remove(scene->force_info, i));
-        list_remove(scene->force_freers, i);
-        // Free list of bodies, but don't free both bodies themselves
-        list_free(list_remove(scene->force_bodies, i));
-        i--;
-        forces_size--;
-        break;
-      }
+/**
+ * Drops a body from the group of a group force, which keeps acting on the
+ * rest of its group.
+ */
+void force_forget_body(force_t *force, body_t *body) {
+  if (force->kind != FORCE_CREATOR || !force->creator.group) {
+    return;
+  }
+  list_t *bodies = force->creator.bodies;
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    if (list_get(bodies, i) == body) {
+      list_remove(bodies, i);
+      return;
     }
   }
 }
+
+/**
+ * Checks whether a force should be removed along with a body.
+ * Group forces never are: see force_forget_body().
+ */
+bool force_uses_body(force_t *force, body_t *body) {
+  if (force->kind != FORCE_CREATOR) {
+    return force->body1 == body || force->body2 == body;
+  }
+  if (force->creator.group) {
+    return false;
+  }
+  list_t *bodies = force->creator.bodies;
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    if (list_get(bodies, i) == body) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Frees the forces in an array that use a body (see force_uses_body()),
+ * moving the rest down in place, which keeps them sorted by kind.
+ * Group forces that are kept drop the body from their group.
+ * Returns how many are left.
+ */
+size_t remove_body_forces(force_t *forces, size_t count, body_t *body) {
+  size_t kept = 0;
+  for (size_t i = 0; i < count; i++) {
+    force_t *force = &forces[i];
+    force_forget_body(force, body);
+    if (force_uses_body(force, body)) {
+      force_free(force);
+    } else {
+      forces[kept++] = *force;
+    }
+  }
+  return kept;
+}
+
+void scene_remove_body_forces(scene_t *scene, body_t *body) {
+  scene->num_forces =
+      remove_body_forces(scene->forces, scene->num_forces, body);
+  // Forces added by collision handlers this tick may use the body too
+  scene->num_pending_forces = remove_body_forces(
+      scene->pending_forces, scene->num_pending_forces, body);
+}
 void scene_remove_body2(scene_t *scene, size_t index) {
   body_t *removed_body = scene_get_body(scene, index);
 
@@ -128,45 +240,489 @@ int scene_get_index(scene_t *scene, body_t *body) {
   return index;
 }
 
+void scene_set_integrator(scene_t *scene, integrator_t integrator) {
+  scene->integrator = integrator;
+}
+
+/** Makes room for count forces in an array */
+force_t *grow_forces(force_t *forces, size_t *capacity, size_t count) {
+  if (*capacity < count) {
+    *capacity = *capacity * 2 > count ? *capacity * 2 : count;
+    forces = realloc(forces, sizeof(force_t) * *capacity);
+    assert(forces != NULL);
+  }
+  return forces;
+}
+
+/** Inserts a force after the last force of the same kind */
+void insert_force(scene_t *scene, const force_t *force) {
+  scene->forces = grow_forces(scene->forces, &scene->force_capacity,
+                              scene->num_forces + 1);
+  size_t index = scene->num_forces;
+  while (index > 0 && scene->forces[index - 1].kind > force->kind) {
+    index--;
+  }
+  memmove(&scene->forces[index + 1], &scene->forces[index],
+          sizeof(force_t) * (scene->num_forces - index));
+  scene->forces[index] = *force;
+  scene->num_forces++;
+}
+
+void scene_set_sleeping(scene_t *scene, bool enabled) {
+  scene->sleeping = enabled;
+  if (!enabled) {
+    size_t num_bodies = list_size(scene->bodies);
+    for (size_t i = 0; i < num_bodies; i++) {
+      body_wake(list_get(scene->bodies, i));
+    }
+  }
+}
+
+void scene_set_solver_iterations(scene_t *scene, size_t iterations) {
+  scene->solver_iterations = iterations > 0 ? iterations : 1;
+}
+
+void scene_set_threads(scene_t *scene, size_t num_threads) {
+#ifdef __EMSCRIPTEN__
+  num_threads = 1;
+#else
+  if (num_threads == 0) {
+    num_threads = job_system_threads();
+  }
+  if (num_threads > SCENE_MAX_THREADS) {
+    num_threads = SCENE_MAX_THREADS;
+  }
+#endif
+  scene->num_threads = num_threads > 0 ? num_threads : 1;
+}
+
+void run_force_tasks(size_t start, size_t end, void *aux) {
+  force_task_t *tasks = aux;
+  for (size_t i = start; i < end; i++) {
+    force_task_t *task = &tasks[i];
+    memset(task->forces_out, 0, sizeof(vector_t) * task->num_bodies);
+    memset(task->impulses, 0, sizeof(vector_t) * task->num_bodies);
+    body_sums_t previous = body_accumulate_into((body_sums_t){
+        task->forces_out, task->impulses, task->num_bodies});
+    forces_apply_concurrent(task->forces, task->num_forces, task->part,
+                            task->num_parts);
+    body_accumulate_into(previous);
+  }
+}
+
+/**
+ * Runs forces_apply_concurrent() on the scene's threads, then adds up what
+ * each thread applied to each body, in thread order so the result does not
+ * depend on which thread finished first
+ */
+void apply_forces_concurrently(scene_t *scene) {
+  size_t num_bodies = list_size(scene->bodies);
+  size_t num_threads = scene->num_threads;
+  if (scene->thread_sums_capacity < 2 * num_bodies * num_threads) {
+    scene->thread_sums_capacity = 2 * num_bodies * num_threads;
+    scene->thread_sums =
+        realloc(scene->thread_sums,
+                sizeof(vector_t) * scene->thread_sums_capacity);
+    assert(scene->thread_sums != NULL);
+  }
+
+  force_task_t tasks[SCENE_MAX_THREADS];
+  for (size_t i = 0; i < num_threads; i++) {
+    vector_t *sums = scene->thread_sums + 2 * num_bodies * i;
+    tasks[i] = (force_task_t){.forces = scene->forces,
+                              .num_forces = scene->num_forces,
+                              .part = i,
+                              .num_parts = num_threads,
+                              .forces_out = sums,
+                              .impulses = sums + num_bodies,
+                              .num_bodies = num_bodies};
+  }
+  job_parallel_for(num_threads, 1, run_force_tasks, tasks);
+
+  for (size_t i = 0; i < num_bodies; i++) {
+    vector_t force = VEC_ZERO, impulse = VEC_ZERO;
+    for (size_t j = 0; j < num_threads; j++) {
+      force.x += tasks[j].forces_out[i].x;
+      force.y += tasks[j].forces_out[i].y;
+      impulse.x += tasks[j].impulses[i].x;
+      impulse.y += tasks[j].impulses[i].y;
+    }
+    body_t *body = list_get(scene->bodies, i);
+    body_add_force(body, force);
+    body_add_impulse(body, impulse);
+  }
+}
+
+/**
+ * Applies every force once, resolving contacts so that bodies will not be
+ * moving into each other after a time dt
+ */
+void scene_apply_forces(scene_t *scene, double dt) {
+  scene->applying_forces = true;
+  size_t num_bodies = list_size(scene->bodies);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_set_slot(list_get(scene->bodies, i), i);
+  }
+  islands_clear(scene->islands, num_bodies);
+  bool parallel = scene->num_threads > 1;
+  forces_detect_collisions(scene->forces, scene->num_forces, parallel);
+  if (parallel && scene->num_forces >= SCENE_PARALLEL_MIN_FORCES) {
+    apply_forces_concurrently(scene);
+  } else {
+    forces_apply_concurrent(scene->forces, scene->num_forces, 0, 1);
+  }
+  // Collision handlers may change bodies and add forces, so they run after
+  // every pair has been checked, in the order the forces were added
+  forces_apply_serial(scene->forces, scene->num_forces, scene->islands);
+  forces_resolve_islands(scene->forces, scene->islands,
+                         scene->solver_iterations, dt, parallel);
+  scene->applying_forces = false;
+  for (size_t i = 0; i < scene->num_pending_forces; i++) {
+    insert_force(scene, &scene->pending_forces[i]);
+  }
+  scene->num_pending_forces = 0;
+}
+
+/** Whether a body should not be moved this tick; see body_check_sleep() */
+bool body_sleeps(scene_t *scene, body_t *body) {
+  return scene->sleeping && body_check_sleep(body);
+}
+
+/** Moves every awake body that is not static by its velocity over a time dt */
+void drift_bodies(scene_t *scene, size_t num_bodies, double dt) {
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if (body_get_motion(body) == BODY_STATIC || body_is_asleep(body)) {
+      continue;
+    }
+    vector_t step = vec_multiply(dt, body_get_velocity(body));
+    body_move_centroid(body, vec_add(body_get_centroid(body), step));
+  }
+}
+
+/**
+ * Changes the velocity of every awake dynamic body by its forces
+ * over a time dt
+ */
+void kick_bodies(scene_t *scene, size_t num_bodies, double dt) {
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if (body_get_motion(body) != BODY_DYNAMIC || body_sleeps(scene, body)) {
+      continue;
+    }
+    body_apply_impulses(body);
+    body_set_velocity(body,
+                      vec_add(body_get_velocity(body),
+                              vec_multiply(dt, body_take_acceleration(body))));
+  }
+}
+
+/**
+ * Classic RK4, treating each body's position and velocity as the state.
+ * Impulses are collected over all 4 stages and applied once at the end,
+ * so a collision handler that fires in any stage bounces the body once.
+ */
+void tick_rk4(scene_t *scene, size_t num_bodies, double dt) {
+  if (scene->rk4_capacity < 4 * num_bodies) {
+    scene->rk4_capacity = 4 * num_bodies;
+    scene->rk4_state = realloc(scene->rk4_state, sizeof(*scene->rk4_state) *
+                                                     scene->rk4_capacity);
+    assert(scene->rk4_state != NULL);
+  }
+  vector_t *start_position = scene->rk4_state;
+  vector_t *start_velocity = start_position + num_bodies;
+  vector_t *position_sum = start_velocity + num_bodies;
+  vector_t *velocity_sum = position_sum + num_bodies;
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    start_position[i] = body_get_centroid(body);
+    start_velocity[i] = body_get_velocity(body);
+    position_sum[i] = VEC_ZERO;
+    velocity_sum[i] = VEC_ZERO;
+  }
+
+  for (size_t stage = 0; stage < 4; stage++) {
+    scene_apply_forces(scene, dt);
+    for (size_t i = 0; i < num_bodies; i++) {
+      body_t *body = list_get(scene->bodies, i);
+      if (body_get_motion(body) == BODY_STATIC) {
+        continue;
+      }
+      vector_t velocity = body_get_velocity(body);
+      vector_t acceleration = body_take_acceleration(body);
+      position_sum[i] =
+          vec_add(position_sum[i], vec_multiply(RK4_WEIGHTS[stage], velocity));
+      velocity_sum[i] = vec_add(velocity_sum[i],
+                                vec_multiply(RK4_WEIGHTS[stage], acceleration));
+      // Move the body to where the next stage is evaluated
+      if (stage < 3) {
+        double step = RK4_OFFSETS[stage] * dt;
+        body_move_centroid(
+            body, vec_add(start_position[i], vec_multiply(step, velocity)));
+        body_set_velocity(
+            body, vec_add(start_velocity[i], vec_multiply(step, acceleration)));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if (body_get_motion(body) == BODY_STATIC) {
+      continue;
+    }
+    body_move_centroid(body, vec_add(start_position[i],
+                                     vec_multiply(dt / 6, position_sum[i])));
+    body_set_velocity(body, vec_add(start_velocity[i],
+                                    vec_multiply(dt / 6, velocity_sum[i])));
+    body_apply_impulses(body);
+  }
+}
+
+/** Remembers where each body starts the tick, for sweep_bodies() */
+void save_tick_start(scene_t *scene, size_t num_bodies) {
+  if (scene->sweep_capacity < num_bodies) {
+    scene->sweep_capacity = num_bodies;
+    scene->sweep_state = realloc(scene->sweep_state, sizeof(vector_t) * 2 *
+                                                         scene->sweep_capacity);
+    scene->impacts =
+        realloc(scene->impacts, sizeof(double) * scene->sweep_capacity);
+    assert(scene->sweep_state != NULL && scene->impacts != NULL);
+  }
+  for (size_t i = 0; i < num_bodies; i++) {
+    scene->sweep_state[i] = body_get_centroid(list_get(scene->bodies, i));
+  }
+}
+
+/**
+ * Puts bodies that passed through something during the tick back to where
+ * they hit it (see forces_find_impacts()), keeping their velocities, so that
+ * the collision is handled next tick
+ */
+void sweep_bodies(scene_t *scene, size_t num_bodies) {
+  vector_t *start = scene->sweep_state;
+  vector_t *motions = start + num_bodies;
+  size_t total_bodies = list_size(scene->bodies);
+  // Bodies added during the tick have no start, so get no slot
+  for (size_t i = 0; i < total_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    body_set_slot(body, i);
+    if (i < num_bodies) {
+      motions[i] = vec_subtract(body_get_centroid(body), start[i]);
+      scene->impacts[i] = 1;
+    }
+  }
+  forces_find_impacts(scene->forces, scene->num_forces, motions, num_bodies,
+                      scene->impacts);
+  for (size_t i = 0; i < num_bodies; i++) {
+    if (scene->impacts[i] < 1) {
+      body_move_centroid(
+          list_get(scene->bodies, i),
+          vec_add(start[i], vec_multiply(scene->impacts[i], motions[i])));
+    }
+  }
+}
+
 void scene_tick(scene_t *scene, double dt) {
-  for (size_t i = 0; i < list_size(scene->force_creators); i++) {
-    force_creator_t force_cr =
-        (force_creator_t)list_get(scene->force_creators, i);
-    force_cr(list_get(scene->force_info, i));
+  // Bodies added by force creators during the tick start moving next tick
+  size_t num_bodies = list_size(scene->bodies);
+  size_t num_swept = num_bodies;
+  save_tick_start(scene, num_swept);
+  switch (scene->integrator) {
+  case INTEGRATOR_AVERAGE_VELOCITY:
+    scene_apply_forces(scene, dt);
+    num_bodies = list_size(scene->bodies);
+    for (size_t i = 0; i < num_bodies; i++) {
+      body_t *body = list_get(scene->bodies, i);
+      if (!body_sleeps(scene, body)) {
+        body_tick(body, dt);
+      }
+    }
+    break;
+  case INTEGRATOR_SEMI_IMPLICIT_EULER:
+    scene_apply_forces(scene, dt);
+    kick_bodies(scene, num_bodies, dt);
+    drift_bodies(scene, num_bodies, dt);
+    break;
+  case INTEGRATOR_LEAPFROG:
+    drift_bodies(scene, num_bodies, dt / 2);
+    scene_apply_forces(scene, dt);
+    kick_bodies(scene, num_bodies, dt);
+    drift_bodies(scene, num_bodies, dt / 2);
+    break;
+  case INTEGRATOR_RK4:
+    tick_rk4(scene, num_bodies, dt);
+    break;
+  }
+  sweep_bodies(scene, num_swept);
+  if (scene->sleeping && scene->integrator != INTEGRATOR_RK4) {
+    for (size_t i = 0; i < num_bodies; i++) {
+      body_update_sleep(list_get(scene->bodies, i), dt);
+    }
   }
-  int num_bodies = list_size(scene->bodies);
+
   for (size_t i = 0; i < num_bodies; i++) {
     body_t *body = (body_t *)list_get(scene->bodies, i);
     assert(body != NULL);
-    body_tick(body, dt);
     if (body_is_removed(body)) {
       scene_remove_body2(scene, i);
       i--;
       num_bodies--;
     }
   }
+  scene->interpolation = 1.0;
 }
 
-void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux,
-                             free_func_t freer) {
-  scene_add_bodies_force_creator(scene, forcer, aux, NULL, freer);
+void scene_set_timestep(scene_t *scene, double timestep, size_t max_substeps) {
+  assert(timestep > 0);
+  assert(max_substeps > 0);
+  scene->timestep = timestep;
+  scene->max_substeps = max_substeps;
+}
+
+double scene_advance(scene_t *scene, double dt) {
+  scene->accumulator += dt;
+  size_t substeps = 0;
+  while (scene->accumulator >= scene->timestep &&
+         substeps < scene->max_substeps) {
+    // Remember where each body was, so frames can be drawn between steps
+    size_t num_bodies = list_size(scene->bodies);
+    for (size_t i = 0; i < num_bodies; i++) {
+      body_save_state(list_get(scene->bodies, i));
+    }
+    scene_tick(scene, scene->timestep);
+    scene->accumulator -= scene->timestep;
+    substeps++;
+  }
+  // If simulating is slower than real time, catching up would only make the
+  // next frame slower still, so let the simulation fall behind instead
+  if (scene->accumulator >= scene->timestep) {
+    scene->accumulator = fmod(scene->accumulator, scene->timestep);
+  }
+  scene->interpolation = scene->accumulator / scene->timestep;
+  return scene->interpolation;
+}
+
+double scene_get_interpolation(scene_t *scene) { return scene->interpolation; }
+
+size_t scene_get_num_islands(scene_t *scene) {
+  return islands_count(scene->islands);
+}
+
+size_t scene_get_island_size(scene_t *scene, size_t index) {
+  return islands_get_size(scene->islands, index);
+}
+
+size_t scene_add_force(scene_t *scene, const force_t *force) {
+  force_t added = *force;
+  added.id = scene->next_force_id++;
+  added.enabled = true;
+  if (scene->applying_forces) {
+    scene->pending_forces =
+        grow_forces(scene->pending_forces, &scene->pending_capacity,
+                    scene->num_pending_forces + 1);
+    scene->pending_forces[scene->num_pending_forces++] = added;
+  } else {
+    insert_force(scene, &added);
+  }
+  return added.id;
+}
+
+/** Finds the force with an id, or returns NULL if it has been removed */
+force_t *scene_find_force(scene_t *scene, size_t id) {
+  for (size_t i = 0; i < scene->num_forces; i++) {
+    if (scene->forces[i].id == id) {
+      return &scene->forces[i];
+    }
+  }
+  for (size_t i = 0; i < scene->num_pending_forces; i++) {
+    if (scene->pending_forces[i].id == id) {
+      return &scene->pending_forces[i];
+    }
+  }
+  return NULL;
+}
+
+void scene_set_force_enabled(scene_t *scene, size_t id, bool enabled) {
+  force_t *force = scene_find_force(scene, id);
+  if (force != NULL) {
+    force->enabled = enabled;
+  }
+}
+
+void scene_set_force_thread_safe(scene_t *scene, size_t id,
+                                 bool thread_safe) {
+  force_t *force = scene_find_force(scene, id);
+  if (force != NULL && force->kind == FORCE_CREATOR) {
+    force->creator.thread_safe = thread_safe;
+  }
+}
+
+size_t scene_add_force_creator(scene_t *scene, force_creator_t forcer,
+                               void *aux, free_func_t freer) {
+  return scene_add_bodies_force_creator(scene, forcer, aux, NULL, freer);
+}
+
+/**
+ * Finds the force with the largest id in an array,
+ * or returns count if the array is empty.
+ */
+size_t find_last_force(force_t *forces, size_t count) {
+  size_t last = count;
+  for (size_t i = 0; i < count; i++) {
+    if (last == count || forces[i].id > forces[last].id) {
+      last = i;
+    }
+  }
+  return last;
+}
+
+/** Frees the force at an index of an array and moves the rest down */
+void remove_force_at(force_t *forces, size_t *count, size_t index) {
+  force_free(&forces[index]);
+  memmove(&forces[index], &forces[index + 1],
+          sizeof(force_t) * (*count - index - 1));
+  (*count)--;
 }
 
 void scene_remove_last_force(scene_t *scene){
-  size_t ind_to_remove = list_size(scene->force_creators)-1;
-  list_remove(scene->force_creators, ind_to_remove);
-  list_remove(scene->force_info, ind_to_remove);
-  list_remove(scene->force_freers, ind_to_remove);
-  list_remove(scene->force_bodies, ind_to_remove);
-
-}
-
-void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
-                                    void *aux, list_t *bodies,
-                                    free_func_t freer) {
-  list_add(scene->force_creators, forcer);
-  list_add(scene->force_info, aux);
-  list_add(scene->force_freers, freer);
-  if (bodies != NULL)
-    list_add(scene->force_bodies, bodies);
+  // Ids only increase, so the last force added has the largest.
+  // It may still be waiting to join forces (see scene_add_force()).
+  size_t last = find_last_force(scene->forces, scene->num_forces);
+  size_t last_pending =
+      find_last_force(scene->pending_forces, scene->num_pending_forces);
+  bool pending_is_last =
+      last_pending < scene->num_pending_forces &&
+      (last == scene->num_forces ||
+       scene->pending_forces[last_pending].id > scene->forces[last].id);
+  if (pending_is_last) {
+    remove_force_at(scene->pending_forces, &scene->num_pending_forces,
+                    last_pending);
+  } else if (last < scene->num_forces) {
+    remove_force_at(scene->forces, &scene->num_forces, last);
+  }
+}
+
+size_t scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
+                                      void *aux, list_t *bodies,
+                                      free_func_t freer) {
+  force_t force = {.kind = FORCE_CREATOR,
+                   .creator = {.forcer = forcer,
+                               .aux = aux,
+                               .freer = freer,
+                               .bodies = bodies != NULL ? bodies
+                                                        : list_init(1, NULL),
+                               .group = false}};
+  return scene_add_force(scene, &force);
+}
+
+size_t scene_add_group_force_creator(scene_t *scene, force_creator_t forcer,
+                                     void *aux, list_t *group,
+                                     free_func_t freer) {
+  force_t force = {.kind = FORCE_CREATOR,
+                   .creator = {.forcer = forcer,
+                               .aux = aux,
+                               .freer = freer,
+                               .bodies = group,
+                               .group = true}};
+  return scene_add_force(scene, &force);
 }
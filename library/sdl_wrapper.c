@@ -1,7 +1,9 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <vector.h>
 #include <SDL2/SDL.h>
@@ -11,8 +13,10 @@
 #include <SDL2/SDL_audio.h>
 #include <SDL2/SDL_mixer.h>
 #include "sdl_wrapper.h"
+#include "assets.h"
 #include "body.h"
 #include "list.h"
+#include "polygon.h"
 #include "scene.h"
 
 typedef struct cursor_pos {
@@ -25,14 +29,134 @@ typedef struct cursor_pos {
 
 
 
-Mix_Music *coin;
-Mix_Music *splash;
+// The sounds loaded by sound_init() and splash_init()
+int coin = -1;
+int splash = -1;
 
 
 const char WINDOW_TITLE[] = "CS 3";
 const int WINDOW_WIDTH = 1000;
 const int WINDOW_HEIGHT = 500;
 const double MS_PER_S = 1e3;
+const size_t INITIAL_SNAPSHOT_SIZE = 16;
+// How long the render thread waits for a new frame before pumping events again
+const uint32_t FRAME_WAIT_MS = 16;
+// How often an idle simulation thread checks for input in threaded mode
+const uint32_t IDLE_POLL_MS = 5;
+// The time step reported by time_since_last_tick() in headless mode (60 FPS)
+const double HEADLESS_TICK = 1.0 / 60.0;
+// The most memory that cached shape textures may use, in bytes
+const size_t SHAPE_CACHE_BUDGET = 32 << 20;
+// Shapes whose texture would be larger than this are filled every frame
+const size_t MAX_SHAPE_TEXTURE_BYTES = 4 << 20;
+// Transparent pixels around each shape texture, so its edges blend smoothly
+const int SHAPE_TEXTURE_PADDING = 2;
+// Mixer channels shared by all sound effects, i.e. how many can overlap
+#define SOUND_CHANNELS 8
+// The most sound effects that can be decoded with sdl_load_sound()
+#define MAX_SOUNDS 32
+// The most sounds that can be waiting to start; more are dropped.
+// Must be a power of 2.
+#define SOUND_QUEUE_SIZE 64
+// Longest path of a file written by sdl_dump_frames()
+const size_t FRAME_PATH_LENGTH = 1024;
+// Longest line in an input script read by sdl_play_input()
+const size_t INPUT_LINE_LENGTH = 256;
+// How many triangulations sdl_draw_polygon() remembers
+#define POLYGON_CACHE_SIZE 256
+// Polygon vertices are rounded to this fraction of a unit before hashing
+const double POLYGON_KEY_PRECISION = 1e4;
+
+/**
+ * An input event read from a script by sdl_play_input(),
+ * and the frame (call to sdl_is_done()) to push it on.
+ */
+typedef struct scripted_event {
+  size_t frame;
+  SDL_Event event;
+} scripted_event_t;
+
+/**
+ * How sdl_draw_polygon() last split a polygon with the given key into
+ * triangles (see get_polygon_key()), so the same shape is not triangulated
+ * again on every frame.
+ */
+typedef struct polygon_triangles {
+  size_t key;
+  size_t num_points;
+  int *indices;
+  size_t num_indices;
+} polygon_triangles_t;
+
+/**
+ * A body as the renderer sees it: everything needed to draw it,
+ * copied so that the body itself can keep changing.
+ */
+typedef struct render_item {
+  char *image_path; // sprite to draw at the centroid, or NULL for a polygon
+  vector_t centroid;
+  rgb_color_t color;
+  bool static_layer;
+  size_t first_point; // index of the body's first vertex in the points array
+  size_t num_points;
+  size_t first_index; // index of the body's first triangle corner in indices
+  size_t num_indices; // 3 per triangle, relative to first_point
+  double angle;
+  size_t shape_key; // see body_get_shape_key(); 0 if the shape can change
+} render_item_t;
+
+/**
+ * A line of text rendered by sdl_draw_text(),
+ * waiting to be turned into a texture by the render thread.
+ */
+typedef struct text_item {
+  SDL_Surface *surface;
+  vector_t position;
+  vector_t size;
+} text_item_t;
+
+/**
+ * An immutable copy of one frame, built by sdl_render_scene().
+ * Arrays keep their capacity between frames so capturing does not allocate.
+ */
+typedef struct frame_snapshot {
+  render_item_t *items;
+  size_t num_items;
+  size_t item_capacity;
+  vector_t *points;
+  size_t num_points;
+  size_t point_capacity;
+  int *indices;
+  size_t num_indices;
+  size_t index_capacity;
+  text_item_t *texts;
+  size_t num_texts;
+  size_t text_capacity;
+  size_t static_signature;
+} frame_snapshot_t;
+
+/**
+ * A shape drawn once into a texture with a color at a given pixel scale.
+ * The texture holds the shape unrotated, and is rotated as it is copied.
+ */
+typedef struct shape_texture {
+  size_t shape_key;
+  rgb_color_t color;
+  double scale;
+  SDL_Texture *texture;
+  SDL_FPoint center; // position of the shape's centroid within the texture
+  int width;
+  int height;
+  size_t last_used; // value of shape_cache_clock when last drawn
+} shape_texture_t;
+
+/**
+ * A loaded image, identified by the path it was loaded from.
+ */
+typedef struct image_entry {
+  char *path; // owned, since callers may free or reuse theirs
+  SDL_Texture *texture;
+} image_entry_t;
 
 /**
  * The coordinate at the center of the screen.
@@ -66,10 +190,181 @@ void *pacman_scene = NULL;
  */
 uint32_t key_start_timestamp;
 /**
- * The value of clock() when time_since_last_tick() was last called.
- * Initially 0.
+ * The value of SDL_GetPerformanceCounter() when time_since_last_tick()
+ * was last called. Initially 0.
+ */
+uint64_t last_counter = 0;
+/**
+ * Render-target texture holding every body on the static layer.
+ * NULL until the first frame that has static bodies, or if the renderer
+ * cannot render to textures (static bodies are then drawn every frame).
+ */
+SDL_Texture *static_layer = NULL;
+/**
+ * Pixel size of static_layer, used to recreate it when the window is resized.
+ */
+int static_layer_width = 0;
+int static_layer_height = 0;
+/**
+ * Whether static_layer must be redrawn before it is used again.
+ * Atomic because window events reach it from the simulation thread.
+ */
+SDL_atomic_t static_layer_dirty = {1};
+/**
+ * The get_static_layer_signature() of the bodies static_layer was drawn from,
+ * so that changing any of them invalidates the layer.
+ */
+size_t static_layer_signature = 0;
+/**
+ * The static layer signature of the last scene passed to sdl_render_scene().
+ */
+size_t captured_static_signature = 0;
+/**
+ * Whether input (or a window event) has arrived since the last sdl_show().
+ * Starts true so that the first frame is always drawn.
+ */
+bool input_since_last_frame = true;
+/**
+ * Images loaded so far. Only the thread that draws may touch them.
+ */
+image_entry_t *images = NULL;
+size_t num_images = 0;
+size_t image_capacity = 0;
+/**
+ * Scratch space for the on-screen vertices of the polygon being drawn.
+ */
+SDL_Vertex *vertex_buffer = NULL;
+size_t vertex_capacity = 0;
+/**
+ * Scratch space for the vertices and triangles of the polygon passed to
+ * sdl_draw_polygon().
+ */
+vector_t *polygon_buffer = NULL;
+size_t polygon_capacity = 0;
+size_t *triangle_buffer = NULL;
+size_t triangle_capacity = 0;
+/**
+ * Triangulations by sdl_draw_polygon(), indexed by polygon key modulo
+ * POLYGON_CACHE_SIZE. A polygon replaces whatever shared its slot.
+ */
+polygon_triangles_t polygon_cache[POLYGON_CACHE_SIZE];
+/**
+ * Shapes drawn into textures so far. Only the thread that draws may touch them.
+ */
+shape_texture_t *shape_textures = NULL;
+size_t num_shape_textures = 0;
+size_t shape_texture_capacity = 0;
+/**
+ * The total size of the textures in shape_textures, in bytes.
+ */
+size_t shape_cache_bytes = 0;
+/**
+ * Counts the frames drawn, to find the least recently used shape texture.
+ */
+size_t shape_cache_clock = 0;
+/**
+ * Set when the renderer loses the contents of its textures,
+ * which means every shape texture must be drawn again.
  */
-clock_t last_clock = 0;
+SDL_atomic_t shape_cache_lost = {0};
+/**
+ * Triple-buffered frame snapshots.
+ * The simulation side fills snapshots[write_index] and publishes it by
+ * swapping it with ready_index; the render thread swaps ready_index with
+ * read_index to take the newest frame. Without a render thread,
+ * snapshots[write_index] is drawn as soon as it is captured.
+ */
+frame_snapshot_t snapshots[3];
+int write_index = 0;
+int ready_index = 1;
+int read_index = 2;
+/**
+ * Whether snapshots[ready_index] holds a frame the render thread has not taken.
+ */
+bool snapshot_fresh = false;
+/**
+ * Guards the snapshot indices and snapshot_fresh in threaded mode.
+ */
+SDL_mutex *snapshot_lock = NULL;
+/**
+ * Signalled whenever a snapshot is published.
+ */
+SDL_cond *snapshot_published = NULL;
+/**
+ * Whether sdl_run_threaded() is running, i.e. the scene is simulated on a
+ * separate thread from the one that renders.
+ */
+bool render_threaded = false;
+/**
+ * Set once the simulation thread has finished.
+ */
+SDL_atomic_t simulation_done = {0};
+/**
+ * The argument passed to the simulation thread's function.
+ */
+void *simulation_aux = NULL;
+/**
+ * Whether the audio device has been opened.
+ */
+bool audio_open = false;
+/**
+ * Sound effects registered with sdl_load_sound(), indexed by sound id.
+ * NULL until the asset manager has finished decoding the sound.
+ */
+char *sound_paths[MAX_SOUNDS];
+Mix_Chunk *sounds[MAX_SOUNDS];
+size_t num_sounds = 0;
+/**
+ * When each mixer channel last started a sound, in SDL ticks,
+ * so the oldest one can be cut off when every channel is busy.
+ */
+uint32_t channel_started[SOUND_CHANNELS];
+/**
+ * Sounds requested by sdl_play_sound() that have not started yet.
+ * Written only by the simulation side at sound_queue_tail and read only by
+ * the side that presents frames at sound_queue_head, so neither ever waits.
+ */
+int sound_queue[SOUND_QUEUE_SIZE];
+SDL_atomic_t sound_queue_head = {0};
+SDL_atomic_t sound_queue_tail = {0};
+/**
+ * Whether frames are drawn offscreen by the software renderer
+ * (see sdl_enable_headless()).
+ */
+bool headless = false;
+/**
+ * The surface that the software renderer draws into in headless mode.
+ */
+SDL_Surface *headless_frame = NULL;
+/**
+ * The directory that every presented frame is written to,
+ * or NULL if frames are not being dumped.
+ */
+const char *dump_directory = NULL;
+/**
+ * The format that dumped frames are written in.
+ */
+frame_format_t dump_format = FRAME_PNG;
+/**
+ * The number of frames presented so far, used to number dumped frames.
+ */
+size_t frames_presented = 0;
+/**
+ * Events read by sdl_play_input(), sorted by frame,
+ * and the index of the next one to push.
+ */
+scripted_event_t *input_script = NULL;
+size_t input_script_length = 0;
+size_t next_scripted_event = 0;
+/**
+ * The number of times sdl_is_done() has been called.
+ */
+size_t input_frame = 0;
+/**
+ * The seed returned by sdl_random_seed(), if random_seed_set.
+ */
+unsigned random_seed = 0;
+bool random_seed_set = false;
 
 /** Computes the center of the window in pixel coordinates */
 vector_t get_window_center(void) {
@@ -135,6 +430,187 @@ char get_keycode(SDL_Keycode key) {
   }
 }
 
+/**
+ * Makes an array large enough to hold needed elements, doubling its capacity
+ * as necessary. Returns the (possibly moved) array.
+ */
+void *grow_array(void *array, size_t *capacity, size_t needed,
+                 size_t element_size) {
+  if (needed <= *capacity) {
+    return array;
+  }
+  size_t new_capacity = *capacity == 0 ? INITIAL_SNAPSHOT_SIZE : *capacity;
+  while (new_capacity < needed) {
+    new_capacity *= 2;
+  }
+  array = realloc(array, new_capacity * element_size);
+  assert(array != NULL);
+  *capacity = new_capacity;
+  return array;
+}
+
+/** Empties a snapshot so it can be filled with the next frame */
+void snapshot_clear(frame_snapshot_t *frame) {
+  for (size_t i = 0; i < frame->num_texts; i++) {
+    SDL_FreeSurface(frame->texts[i].surface);
+  }
+  frame->num_items = 0;
+  frame->num_points = 0;
+  frame->num_indices = 0;
+  frame->num_texts = 0;
+  frame->static_signature = 0;
+}
+
+/** The snapshot the simulation side is currently filling */
+frame_snapshot_t *get_write_snapshot(void) { return &snapshots[write_index]; }
+
+/**
+ * Identifies what the static layer of a scene would hold: changes whenever
+ * a static layer body is added to the scene, or changed, removed or freed
+ * (see body_get_static_layer_generation()). Returns 0 if the scene has no
+ * static layer bodies.
+ */
+size_t get_static_layer_signature(scene_t *scene) {
+  size_t num_static = 0;
+  size_t body_count = scene_bodies(scene);
+  for (size_t i = 0; i < body_count; i++) {
+    if (body_is_static_layer(scene_get_body(scene, i))) {
+      num_static++;
+    }
+  }
+  if (num_static == 0) {
+    return 0;
+  }
+  // Bodies added to the scene change the count, but not the generation
+  return body_get_static_layer_generation() * 31 + num_static;
+}
+
+/**
+ * Copies everything needed to draw the bodies of a scene into a snapshot.
+ * The snapshot does not reference the bodies, so they may change afterwards.
+ */
+void snapshot_capture_scene(frame_snapshot_t *frame, scene_t *scene) {
+  snapshot_clear(frame);
+  frame->static_signature = get_static_layer_signature(scene);
+  // Draw each body between its last two ticks (see scene_advance())
+  double alpha = scene_get_interpolation(scene);
+  size_t body_count = scene_bodies(scene);
+  frame->items = grow_array(frame->items, &frame->item_capacity, body_count,
+                            sizeof(*frame->items));
+  for (size_t i = 0; i < body_count; i++) {
+    body_t *body = scene_get_body(scene, i);
+    render_item_t *item = &frame->items[frame->num_items++];
+    item->image_path = body_get_image_path(body);
+    item->centroid = body_get_interpolated_centroid(body, alpha);
+    item->color = body_get_color(body);
+    item->static_layer = body_is_static_layer(body);
+    item->first_point = frame->num_points;
+    item->num_points = 0;
+    item->first_index = frame->num_indices;
+    item->num_indices = 0;
+    item->angle = body_get_interpolated_angle(body, alpha);
+    item->shape_key = body_get_shape_key(body);
+
+    // Sprites are drawn at the centroid, so only polygons need their vertices
+    if (item->image_path == NULL) {
+      list_t *shape = get_body_points(body);
+      item->num_points = list_size(shape);
+      frame->points =
+          grow_array(frame->points, &frame->point_capacity,
+                     frame->num_points + item->num_points,
+                     sizeof(*frame->points));
+      // Move the vertices from where the body is to where it is drawn
+      vector_t centroid = body_get_centroid(body);
+      double turn = item->angle - body_get_angle(body);
+      for (size_t j = 0; j < item->num_points; j++) {
+        vector_t point = *(vector_t *)list_get(shape, j);
+        if (alpha != 1.0) {
+          point = vec_add(vec_rotate(vec_subtract(point, centroid), turn),
+                          item->centroid);
+        }
+        frame->points[frame->num_points++] = point;
+      }
+
+      size_t num_triangles;
+      size_t *triangles = body_get_triangles(body, &num_triangles);
+      item->num_indices = 3 * num_triangles;
+      frame->indices =
+          grow_array(frame->indices, &frame->index_capacity,
+                     frame->num_indices + item->num_indices,
+                     sizeof(*frame->indices));
+      for (size_t j = 0; j < item->num_indices; j++) {
+        frame->indices[frame->num_indices++] = triangles[j];
+      }
+    }
+  }
+}
+
+/**
+ * Hands the finished write snapshot to the render thread,
+ * replacing any published snapshot it has not picked up yet.
+ */
+void snapshot_publish(void) {
+  SDL_LockMutex(snapshot_lock);
+  int ready = ready_index;
+  ready_index = write_index;
+  write_index = ready;
+  snapshot_fresh = true;
+  SDL_CondSignal(snapshot_published);
+  SDL_UnlockMutex(snapshot_lock);
+}
+
+/**
+ * Waits up to timeout_ms for a newly published snapshot.
+ * Returns it, or NULL if no new frame was published in time.
+ */
+frame_snapshot_t *snapshot_take_latest(uint32_t timeout_ms) {
+  frame_snapshot_t *frame = NULL;
+  SDL_LockMutex(snapshot_lock);
+  if (!snapshot_fresh) {
+    SDL_CondWaitTimeout(snapshot_published, snapshot_lock, timeout_ms);
+  }
+  if (snapshot_fresh) {
+    int read = read_index;
+    read_index = ready_index;
+    ready_index = read;
+    snapshot_fresh = false;
+    frame = &snapshots[read_index];
+  }
+  SDL_UnlockMutex(snapshot_lock);
+  return frame;
+}
+
+/**
+ * Creates the window and renderer if they do not exist yet.
+ * In threaded mode this happens on the main thread before the simulation
+ * starts, since most platforms only allow windows on the main thread.
+ */
+void sdl_open_window(void) {
+  if (window != NULL) {
+    return;
+  }
+  if (headless) {
+    // The dummy drivers need no display or sound card
+    setenv("SDL_VIDEODRIVER", "dummy", 1);
+    setenv("SDL_AUDIODRIVER", "dummy", 1);
+  }
+  SDL_Init(SDL_INIT_EVERYTHING);
+  TTF_Init();
+  window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED,
+                            SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT,
+                            SDL_WINDOW_RESIZABLE);
+  if (headless) {
+    // The dummy window has no pixels, so draw into a surface of the same size
+    headless_frame = SDL_CreateRGBSurfaceWithFormat(
+        0, WINDOW_WIDTH, WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    assert(headless_frame != NULL);
+    renderer = SDL_CreateSoftwareRenderer(headless_frame);
+  } else {
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+  }
+  assert(renderer != NULL);
+}
+
 void sdl_init(vector_t min, vector_t max) {
   // Check parameters
   assert(min.x < max.x);
@@ -142,42 +618,68 @@ void sdl_init(vector_t min, vector_t max) {
 
   center = vec_multiply(0.5, vec_add(min, max));
   max_diff = vec_subtract(max, center);
-  SDL_Init(SDL_INIT_EVERYTHING);
-  TTF_Init();
-  window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED,
-                            SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT,
-                            SDL_WINDOW_RESIZABLE);
-  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+  sdl_open_window();
+}
+
+/**
+ * Gets the next pending event, if any.
+ * In threaded mode the render thread pumps events (which must happen on the
+ * main thread) and the simulation thread only takes them off the queue.
+ */
+bool next_event(SDL_Event *event) {
+  if (render_threaded) {
+    return SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_FIRSTEVENT,
+                          SDL_LASTEVENT) > 0;
+  }
+  return SDL_PollEvent(event);
 }
 
-vector_t get_cursor_coordinates() {
-    int x, y;
-    Uint32 buttons;
-    SDL_PumpEvents();  // make sure we have the latest mouse state.
-    buttons = SDL_GetMouseState(&x, &y);
-    vector_t cursor_coordinates = {x, y};
-    return cursor_coordinates;
+/**
+ * Pushes the scripted events (see sdl_play_input()) for the current frame
+ * onto SDL's queue, where they are handled like real input
+ */
+void push_scripted_input(void) {
+  while (next_scripted_event < input_script_length &&
+         input_script[next_scripted_event].frame <= input_frame) {
+    SDL_PushEvent(&input_script[next_scripted_event++].event);
+  }
+  input_frame++;
 }
 
 bool sdl_is_done(void *scene) {
+  push_scripted_input();
   SDL_Event *event = malloc(sizeof(*event));
   assert(event != NULL);
-  while (SDL_PollEvent(event)) {
+  while (next_event(event)) {
     switch (event->type) {
     case SDL_QUIT:
       free(event);
       return true;
+    case SDL_WINDOWEVENT:
+      // Resizes and exposes lose the contents of the window
+      SDL_AtomicSet(&static_layer_dirty, 1);
+      input_since_last_frame = true;
+      break;
+    case SDL_RENDER_TARGETS_RESET:
+    case SDL_RENDER_DEVICE_RESET:
+      SDL_AtomicSet(&static_layer_dirty, 1);
+      SDL_AtomicSet(&shape_cache_lost, 1);
+      break;
     case SDL_KEYDOWN:
     case SDL_KEYUP:
       // Skip the keypress if no handler is configured
       // or an unrecognized key was pressed
+      input_since_last_frame = true;
       if (key_handler == NULL)
         break;
       char key = get_keycode(event->key.keysym.sym);
       if (key == '\0')
         break;
 
-      uint32_t timestamp = event->key.timestamp;
+      // SDL stamps scripted events with the real time, so count frames instead
+      uint32_t timestamp =
+          headless ? input_frame * HEADLESS_TICK * MS_PER_S
+                   : event->key.timestamp;
       if (!event->key.repeat) {
         key_start_timestamp = timestamp;
       }
@@ -188,12 +690,15 @@ bool sdl_is_done(void *scene) {
       break;
     case SDL_MOUSEBUTTONDOWN:
     case SDL_MOUSEBUTTONUP:
+      input_since_last_frame = true;
       if (mouse_handler == NULL)
         break;
       char mouse = event->button.button;
       if (mouse == '\0')
         break;
-      vector_t cursor_coordinates = get_cursor_coordinates();
+      // Use the position recorded with the click; querying the mouse state
+      // would pump events, which only the main thread may do
+      vector_t cursor_coordinates = {event->button.x, event->button.y};
       mouse_event_type_t mouse_type =
           event->type == SDL_MOUSEBUTTONDOWN ? MOUSE_PRESSED : MOUSE_RELEASED;
       mouse_handler(mouse, cursor_coordinates, mouse_type, pacman_scene);
@@ -209,24 +714,19 @@ void sdl_clear(void) {
   SDL_RenderClear(renderer);
 }
 
-void sdl_draw_polygon(list_t *points, rgb_color_t color) {
-  // Check parameters
-  size_t n = list_size(points);
-  assert(n >= 3);
-  assert(0 <= color.r && color.r <= 1);
-  assert(0 <= color.g && color.g <= 1);
-  assert(0 <= color.b && color.b <= 1);
-
-  vector_t window_center = get_window_center();
-
+/**
+ * Fills the polygon with the given scene-coordinate vertices
+ * one scanline at a time. Used when the renderer cannot draw geometry.
+ */
+void fill_polygon_scanline(vector_t *points, size_t n, rgb_color_t color,
+                           vector_t window_center) {
   // Convert each vertex to a point on screen
   int16_t *x_points = malloc(sizeof(*x_points) * n),
           *y_points = malloc(sizeof(*y_points) * n);
   assert(x_points != NULL);
   assert(y_points != NULL);
   for (size_t i = 0; i < n; i++) {
-    vector_t *vertex = list_get(points, i);
-    vector_t pixel = get_window_position(*vertex, window_center);
+    vector_t pixel = get_window_position(points[i], window_center);
     x_points[i] = pixel.x;
     y_points[i] = pixel.y;
   }
@@ -238,15 +738,174 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
   free(y_points);
 }
 
+/**
+ * Fills the polygon with the given scene-coordinate vertices,
+ * which has been split into the given triangles (see polygon_triangulate()).
+ * The triangles are submitted to the GPU in a single batch.
+ */
+void draw_points(vector_t *points, size_t n, int *indices, size_t num_indices,
+                 rgb_color_t color) {
+  // Check parameters
+  assert(n >= 3);
+  assert(0 <= color.r && color.r <= 1);
+  assert(0 <= color.g && color.g <= 1);
+  assert(0 <= color.b && color.b <= 1);
 
-void sdl_render_image(char *image_info_path, body_t *bod) {
+  vector_t window_center = get_window_center();
+
+  // Convert each vertex to a point on screen
+  vertex_buffer = grow_array(vertex_buffer, &vertex_capacity, n,
+                             sizeof(*vertex_buffer));
+  SDL_Color vertex_color = {color.r * 255, color.g * 255, color.b * 255, 255};
+  for (size_t i = 0; i < n; i++) {
+    vector_t pixel = get_window_position(points[i], window_center);
+    vertex_buffer[i] = (SDL_Vertex){.position = {pixel.x, pixel.y},
+                                    .color = vertex_color};
+  }
+
+  if (SDL_RenderGeometry(renderer, NULL, vertex_buffer, n, indices,
+                         num_indices) != 0) {
+    fill_polygon_scanline(points, n, color, window_center);
+  }
+}
+
+/**
+ * Hashes a polygon's shape, independent of where it is and how it is rotated,
+ * by measuring its vertices relative to the first edge.
+ * Moving a polygon never changes how it is triangulated.
+ */
+size_t get_polygon_key(vector_t *points, size_t n) {
+  vector_t first_edge = vec_subtract(points[1], points[0]);
+  double angle = atan2(first_edge.y, first_edge.x);
+  uint64_t key = 14695981039346656037ULL;
+  for (size_t i = 0; i < n; i++) {
+    vector_t local = vec_rotate(vec_subtract(points[i], points[0]), -angle);
+    key = (key ^ (uint64_t)llround(local.x * POLYGON_KEY_PRECISION)) *
+          1099511628211ULL;
+    key = (key ^ (uint64_t)llround(local.y * POLYGON_KEY_PRECISION)) *
+          1099511628211ULL;
+  }
+  return key;
+}
+
+/**
+ * Gets the triangles of a polygon whose vertices have been copied into
+ * polygon_buffer, triangulating it only if its shape is not cached.
+ */
+polygon_triangles_t *get_polygon_triangles(list_t *points, size_t n) {
+  size_t key = get_polygon_key(polygon_buffer, n);
+  polygon_triangles_t *entry = &polygon_cache[key % POLYGON_CACHE_SIZE];
+  if (entry->indices != NULL && entry->key == key && entry->num_points == n) {
+    return entry;
+  }
+
+  triangle_buffer = grow_array(triangle_buffer, &triangle_capacity,
+                               3 * (n - 2), sizeof(*triangle_buffer));
+  size_t num_indices = 3 * polygon_triangulate(points, triangle_buffer);
+  entry->indices = realloc(entry->indices, sizeof(*entry->indices) * 3 * n);
+  assert(entry->indices != NULL);
+  for (size_t i = 0; i < num_indices; i++) {
+    entry->indices[i] = triangle_buffer[i];
+  }
+  entry->key = key;
+  entry->num_points = n;
+  entry->num_indices = num_indices;
+  return entry;
+}
+
+void sdl_draw_polygon(list_t *points, rgb_color_t color) {
+  size_t n = list_size(points);
+  assert(n >= 3);
+  polygon_buffer = grow_array(polygon_buffer, &polygon_capacity, n,
+                              sizeof(*polygon_buffer));
+  for (size_t i = 0; i < n; i++) {
+    polygon_buffer[i] = *(vector_t *)list_get(points, i);
+  }
+  polygon_triangles_t *triangles = get_polygon_triangles(points, n);
+  draw_points(polygon_buffer, n, triangles->indices, triangles->num_indices,
+              color);
+}
+
+/**
+ * Turns a decoded image into a texture and frees the image.
+ * Premultiplied images need their own blend mode to be drawn correctly.
+ */
+SDL_Texture *create_image_texture(SDL_Surface *image, bool premultiplied) {
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, image);
+  SDL_FreeSurface(image);
+  if (texture != NULL && premultiplied) {
+    SDL_SetTextureBlendMode(
+        texture, SDL_ComposeCustomBlendMode(
+                     SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                     SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE,
+                     SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                     SDL_BLENDOPERATION_ADD));
+  }
+  return texture;
+}
+
+/**
+ * Gets the texture for an image file, loading it the first time it is used.
+ * Images are identified by their path, which acts as the sprite id.
+ */
+SDL_Texture *get_image_texture(const char *image_path) {
+  for (size_t i = 0; i < num_images; i++) {
+    if (strcmp(images[i].path, image_path) == 0) {
+      return images[i].texture;
+    }
+  }
+  images = grow_array(images, &image_capacity, num_images + 1,
+                      sizeof(*images));
+  images[num_images].path = strdup(image_path);
+  assert(images[num_images].path != NULL);
+  // Use the preloaded image if there is one, to avoid decoding it again
+  bool premultiplied;
+  SDL_Surface *image = assets_get_image(image_path, &premultiplied);
+  if (image != NULL) {
+    images[num_images].texture = create_image_texture(image, premultiplied);
+  } else {
+    images[num_images].texture = IMG_LoadTexture(renderer, image_path);
+  }
+  return images[num_images++].texture;
+}
+
+/**
+ * Turns images that the asset manager has finished decoding into textures,
+ * so they are ready before they are first drawn.
+ */
+void upload_preloaded_images(void) {
+  const char *path;
+  bool premultiplied;
+  SDL_Surface *image;
+  while ((image = assets_take_image(&path, &premultiplied)) != NULL) {
+    images = grow_array(images, &image_capacity, num_images + 1,
+                        sizeof(*images));
+    images[num_images].path = strdup(path);
+    assert(images[num_images].path != NULL);
+    images[num_images++].texture = create_image_texture(image, premultiplied);
+  }
+}
+
+void sdl_free_images(void) {
+  for (size_t i = 0; i < num_images; i++) {
+    free(images[i].path);
+    if (images[i].texture != NULL) {
+      SDL_DestroyTexture(images[i].texture);
+    }
+  }
+  free(images);
+  images = NULL;
+  num_images = 0;
+  image_capacity = 0;
+}
+
+/** Draws an image centered on the given scene coordinate */
+void draw_image(char *image_path, vector_t position) {
   int width;
   int height;
   vector_t inputs = {WINDOW_WIDTH/2, WINDOW_HEIGHT/2};
-  vector_t centroid_pos = get_window_position(body_get_centroid(bod), inputs);
-  //getting undefined reference to `IMG_LoadTexture' & 'IMG_Init'
-  //IMG_Init(IMG_INIT_PNG);
-  SDL_Texture *image = IMG_LoadTexture(renderer, image_info_path);
+  vector_t centroid_pos = get_window_position(position, inputs);
+  SDL_Texture *image = get_image_texture(image_path);
   SDL_QueryTexture( image, NULL, NULL, &width, &height);
   SDL_Rect dimensions;
   dimensions.x = centroid_pos.x - width* 0.9/2;
@@ -254,11 +913,264 @@ void sdl_render_image(char *image_info_path, body_t *bod) {
   dimensions.w = width * 0.9;
   dimensions.h = height * 0.9;
   SDL_RenderCopy(renderer, image, NULL, &dimensions);
+}
 
+void sdl_render_image(char *image_info_path, body_t *bod) {
+  draw_image(image_info_path, body_get_centroid(bod));
 }
 
+/** Destroys the shape texture at the given index of shape_textures */
+void evict_shape_texture(size_t index) {
+  shape_texture_t *entry = &shape_textures[index];
+  SDL_DestroyTexture(entry->texture);
+  shape_cache_bytes -= (size_t)entry->width * entry->height * 4;
+  shape_textures[index] = shape_textures[--num_shape_textures];
+}
 
-void sdl_show(void) {
+/** Destroys every shape texture */
+void clear_shape_cache(void) {
+  while (num_shape_textures > 0) {
+    evict_shape_texture(num_shape_textures - 1);
+  }
+}
+
+/**
+ * Makes room for a texture of the given size by evicting
+ * the least recently used shape textures.
+ */
+void reserve_shape_cache(size_t bytes) {
+  while (num_shape_textures > 0 && shape_cache_bytes + bytes > SHAPE_CACHE_BUDGET) {
+    size_t oldest = 0;
+    for (size_t i = 1; i < num_shape_textures; i++) {
+      if (shape_textures[i].last_used < shape_textures[oldest].last_used) {
+        oldest = i;
+      }
+    }
+    evict_shape_texture(oldest);
+  }
+}
+
+/**
+ * Draws a captured polygon into a new shape texture, anti-aliasing its edges.
+ * Returns NULL if the texture would be too large
+ * or the renderer cannot draw into textures.
+ */
+shape_texture_t *rasterize_shape(frame_snapshot_t *frame, render_item_t *item,
+                                 double scale) {
+  // Undo the body's rotation and convert to pixels, with y pointing down
+  vector_t *points = &frame->points[item->first_point];
+  size_t n = item->num_points;
+  vector_t *pixels = malloc(sizeof(*pixels) * n);
+  assert(pixels != NULL);
+  vector_t min_pixel = {INFINITY, INFINITY}, max_pixel = {-INFINITY, -INFINITY};
+  for (size_t i = 0; i < n; i++) {
+    vector_t local = vec_rotate(vec_subtract(points[i], item->centroid),
+                                -item->angle);
+    pixels[i] = (vector_t){local.x * scale, -local.y * scale};
+    min_pixel = (vector_t){min(min_pixel.x, pixels[i].x),
+                           min(min_pixel.y, pixels[i].y)};
+    max_pixel = (vector_t){max(max_pixel.x, pixels[i].x),
+                           max(max_pixel.y, pixels[i].y)};
+  }
+  int width = ceil(max_pixel.x - min_pixel.x) + 2 * SHAPE_TEXTURE_PADDING,
+      height = ceil(max_pixel.y - min_pixel.y) + 2 * SHAPE_TEXTURE_PADDING;
+  size_t bytes = (size_t)width * height * 4;
+  SDL_Texture *texture = NULL;
+  if (bytes <= MAX_SHAPE_TEXTURE_BYTES) {
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                SDL_TEXTUREACCESS_TARGET, width, height);
+  }
+  SDL_Texture *previous_target = SDL_GetRenderTarget(renderer);
+  if (texture == NULL || SDL_SetRenderTarget(renderer, texture) != 0) {
+    if (texture != NULL) {
+      SDL_DestroyTexture(texture);
+    }
+    free(pixels);
+    return NULL;
+  }
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+  // Move the shape so its bounding box starts at the padding
+  vector_t offset = {SHAPE_TEXTURE_PADDING - min_pixel.x,
+                     SHAPE_TEXTURE_PADDING - min_pixel.y};
+  SDL_Color color = {item->color.r * 255, item->color.g * 255,
+                     item->color.b * 255, 255};
+  vertex_buffer = grow_array(vertex_buffer, &vertex_capacity, n,
+                             sizeof(*vertex_buffer));
+  int16_t *x_points = malloc(sizeof(*x_points) * n),
+          *y_points = malloc(sizeof(*y_points) * n);
+  assert(x_points != NULL);
+  assert(y_points != NULL);
+  for (size_t i = 0; i < n; i++) {
+    vector_t pixel = vec_add(pixels[i], offset);
+    vertex_buffer[i] = (SDL_Vertex){.position = {pixel.x, pixel.y},
+                                    .color = color};
+    x_points[i] = round(pixel.x);
+    y_points[i] = round(pixel.y);
+  }
+
+  // Clear to transparent pixels of the same color, so blended edges keep it
+  SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 0);
+  SDL_RenderClear(renderer);
+  SDL_RenderGeometry(renderer, NULL, vertex_buffer, n,
+                     &frame->indices[item->first_index], item->num_indices);
+  aapolygonRGBA(renderer, x_points, y_points, n, color.r, color.g, color.b,
+                255);
+  SDL_SetRenderTarget(renderer, previous_target);
+  free(pixels);
+  free(x_points);
+  free(y_points);
+
+  reserve_shape_cache(bytes);
+  shape_textures = grow_array(shape_textures, &shape_texture_capacity,
+                              num_shape_textures + 1, sizeof(*shape_textures));
+  shape_texture_t *entry = &shape_textures[num_shape_textures++];
+  *entry = (shape_texture_t){.shape_key = item->shape_key,
+                             .color = item->color,
+                             .scale = scale,
+                             .texture = texture,
+                             .center = {offset.x, offset.y},
+                             .width = width,
+                             .height = height};
+  shape_cache_bytes += bytes;
+  return entry;
+}
+
+/**
+ * Gets the texture for a captured polygon at the given pixel scale,
+ * drawing it the first time it is needed.
+ * Returns NULL if the shape cannot be cached.
+ */
+shape_texture_t *get_shape_texture(frame_snapshot_t *frame,
+                                   render_item_t *item, double scale) {
+  for (size_t i = 0; i < num_shape_textures; i++) {
+    shape_texture_t *entry = &shape_textures[i];
+    if (entry->shape_key == item->shape_key && entry->scale == scale &&
+        entry->color.r == item->color.r && entry->color.g == item->color.g &&
+        entry->color.b == item->color.b) {
+      return entry;
+    }
+  }
+  return rasterize_shape(frame, item, scale);
+}
+
+/**
+ * Draws a captured polygon by copying its cached texture.
+ * Returns false if it has to be filled instead.
+ */
+bool draw_cached_shape(frame_snapshot_t *frame, render_item_t *item) {
+  if (item->shape_key == 0 || item->num_indices == 0) {
+    return false;
+  }
+  vector_t window_center = get_window_center();
+  shape_texture_t *entry =
+      get_shape_texture(frame, item, get_scene_scale(window_center));
+  if (entry == NULL) {
+    return false;
+  }
+  entry->last_used = shape_cache_clock;
+
+  vector_t centroid_pixel = get_window_position(item->centroid, window_center);
+  SDL_FRect destination = {centroid_pixel.x - entry->center.x,
+                           centroid_pixel.y - entry->center.y, entry->width,
+                           entry->height};
+  // SDL measures angles clockwise in degrees, and y points down on screen
+  return SDL_RenderCopyExF(renderer, entry->texture, NULL, &destination,
+                           -item->angle * 180 / M_PI, &entry->center,
+                           SDL_FLIP_NONE) == 0;
+}
+
+/** Draws one captured body, either as its image or as a filled polygon */
+void draw_item(frame_snapshot_t *frame, render_item_t *item) {
+  if (item->image_path != NULL) {
+    draw_image(item->image_path, item->centroid);
+  }
+  // Only draw polygon if image is not being rendered
+  else if (!draw_cached_shape(frame, item)) {
+    draw_points(&frame->points[item->first_point], item->num_points,
+                &frame->indices[item->first_index], item->num_indices,
+                item->color);
+  }
+}
+
+/** Draws a rendered line of text into the given screen rectangle */
+void draw_text_surface(SDL_Surface *surface, vector_t position, vector_t size) {
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+  sdl_render_text(texture, position, size);
+  SDL_DestroyTexture(texture);
+}
+
+/**
+ * Draws the static layer items of a snapshot into static_layer,
+ * (re)creating the texture if the output size changed.
+ * Returns false if render targets are unsupported.
+ */
+bool render_static_layer(frame_snapshot_t *frame) {
+  int width, height;
+  SDL_GetRendererOutputSize(renderer, &width, &height);
+  if (static_layer == NULL || width != static_layer_width ||
+      height != static_layer_height) {
+    if (static_layer != NULL) {
+      SDL_DestroyTexture(static_layer);
+    }
+    static_layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                     SDL_TEXTUREACCESS_TARGET, width, height);
+    static_layer_width = width;
+    static_layer_height = height;
+  }
+  if (static_layer == NULL || SDL_SetRenderTarget(renderer, static_layer) != 0) {
+    return false;
+  }
+
+  sdl_clear();
+  for (size_t i = 0; i < frame->num_items; i++) {
+    if (frame->items[i].static_layer) {
+      draw_item(frame, &frame->items[i]);
+    }
+  }
+  SDL_SetRenderTarget(renderer, NULL);
+  SDL_AtomicSet(&static_layer_dirty, 0);
+  return true;
+}
+
+/** Draws every body and line of text captured in a snapshot */
+void draw_snapshot(frame_snapshot_t *frame) {
+  upload_preloaded_images();
+  shape_cache_clock++;
+  if (SDL_AtomicGet(&shape_cache_lost)) {
+    SDL_AtomicSet(&shape_cache_lost, 0);
+    clear_shape_cache();
+  }
+  if (frame->static_signature != static_layer_signature) {
+    static_layer_signature = frame->static_signature;
+    SDL_AtomicSet(&static_layer_dirty, 1);
+  }
+
+  // Blit the cached static layer in place of clearing the screen
+  bool use_static_layer = frame->static_signature != 0;
+  if (use_static_layer && SDL_AtomicGet(&static_layer_dirty)) {
+    use_static_layer = render_static_layer(frame);
+  }
+  if (use_static_layer) {
+    SDL_RenderCopy(renderer, static_layer, NULL, NULL);
+  } else {
+    sdl_clear();
+  }
+
+  for (size_t i = 0; i < frame->num_items; i++) {
+    render_item_t *item = &frame->items[i];
+    if (!use_static_layer || !item->static_layer) {
+      draw_item(frame, item);
+    }
+  }
+  for (size_t i = 0; i < frame->num_texts; i++) {
+    text_item_t *text = &frame->texts[i];
+    draw_text_surface(text->surface, text->position, text->size);
+  }
+}
+
+/** Draws the scene boundary and puts the finished frame on screen */
+void present_frame(void) {
   // Draw boundary lines
   vector_t window_center = get_window_center();
   vector_t max = vec_add(center, max_diff),
@@ -275,28 +1187,305 @@ void sdl_show(void) {
   free(boundary);
 
   SDL_RenderPresent(renderer);
+
+  if (dump_directory != NULL) {
+    char path[FRAME_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/frame_%05zu.%s", dump_directory,
+             frames_presented, dump_format == FRAME_PNG ? "png" : "rgba");
+    sdl_save_frame(path, dump_format);
+  }
+  frames_presented++;
 }
 
-void sdl_render_scene(scene_t *scene) {
-  sdl_clear();
+/**
+ * Starts a sound on a free mixer channel, cutting off the sound
+ * that has been playing the longest if every channel is busy.
+ */
+void start_sound(int sound) {
+  if (sounds[sound] == NULL) {
+    // Skip the sound if it is still decoding rather than hold up the frame
+    bool pending;
+    sounds[sound] = assets_poll_sound(sound_paths[sound], &pending);
+  }
+  if (sounds[sound] == NULL) {
+    return;
+  }
+  int channel = Mix_PlayChannel(-1, sounds[sound], 0);
+  if (channel == -1) {
+    channel = 0;
+    for (int i = 1; i < SOUND_CHANNELS; i++) {
+      if (channel_started[i] < channel_started[channel]) {
+        channel = i;
+      }
+    }
+    Mix_HaltChannel(channel);
+    channel = Mix_PlayChannel(channel, sounds[sound], 0);
+  }
+  if (channel >= 0 && channel < SOUND_CHANNELS) {
+    channel_started[channel] = SDL_GetTicks();
+  }
+}
+
+/** Starts every sound waiting in sound_queue */
+void play_queued_sounds(void) {
+  int head = SDL_AtomicGet(&sound_queue_head);
+  int tail = SDL_AtomicGet(&sound_queue_tail);
+  while (head != tail) {
+    start_sound(sound_queue[head]);
+    head = (head + 1) & (SOUND_QUEUE_SIZE - 1);
+  }
+  SDL_AtomicSet(&sound_queue_head, head);
+}
+
+void sdl_show(void) {
+  if (render_threaded) {
+    snapshot_publish();
+  } else {
+    present_frame();
+    play_queued_sounds();
+  }
+  input_since_last_frame = false;
+  assets_frame_shown();
+}
+
+void sdl_invalidate_static_layer(void) { SDL_AtomicSet(&static_layer_dirty, 1); }
+
+bool sdl_needs_redraw(scene_t *scene) {
+  // Every frame counts when benchmarking or dumping frames
+  if (headless || input_since_last_frame || SDL_AtomicGet(&static_layer_dirty) ||
+      get_static_layer_signature(scene) != captured_static_signature) {
+    return true;
+  }
   size_t body_count = scene_bodies(scene);
-  // assert(body_count >= 3);
   for (size_t i = 0; i < body_count; i++) {
-    body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-    assert(shape != NULL);
-    assert(body != NULL);
-    char *image_path = body_get_image_path(body);
-    if(image_path != NULL) {
-      sdl_render_image(image_path, body);
+    if (!body_is_static_layer(scene_get_body(scene, i))) {
+      return true;
     }
-    // Only draw polygon if image is not being rendered
-    else{
-      sdl_draw_polygon(shape, body_get_color(body));
+  }
+  return false;
+}
+
+void sdl_wait_for_input(uint32_t timeout_ms) {
+#ifndef __EMSCRIPTEN__
+  // The browser already throttles the main loop, so only block natively
+  if (!render_threaded) {
+    SDL_WaitEventTimeout(NULL, timeout_ms);
+    return;
+  }
+  // Only the render thread may pump events, so poll the queue it fills
+  uint32_t start = SDL_GetTicks();
+  while (SDL_PeepEvents(NULL, 0, SDL_PEEKEVENT, SDL_FIRSTEVENT,
+                        SDL_LASTEVENT) == 0 &&
+         SDL_GetTicks() - start < timeout_ms) {
+    SDL_Delay(IDLE_POLL_MS);
+  }
+#endif
+}
+
+void sdl_render_scene(scene_t *scene) {
+  frame_snapshot_t *frame = get_write_snapshot();
+  snapshot_capture_scene(frame, scene);
+  captured_static_signature = frame->static_signature;
+  if (!render_threaded) {
+    draw_snapshot(frame);
+  }
+}
+
+void sdl_draw_text(char *string, font_t *font, rgb_color_t color,
+                   vector_t position, vector_t size) {
+  SDL_Color textColor = {color.r * 125, color.g * 125, color.b * 125, 125};
+  SDL_Surface *surface = assets_render_text(font, string, textColor);
+  if (surface == NULL) {
+    return;
+  }
+  if (!render_threaded) {
+    draw_text_surface(surface, position, size);
+    SDL_FreeSurface(surface);
+    return;
+  }
+
+  // The surface is freed when the snapshot is reused
+  frame_snapshot_t *frame = get_write_snapshot();
+  frame->texts = grow_array(frame->texts, &frame->text_capacity,
+                            frame->num_texts + 1, sizeof(*frame->texts));
+  frame->texts[frame->num_texts++] =
+      (text_item_t){.surface = surface, .position = position, .size = size};
+}
+
+/** Runs the simulation function, then tells the render thread to stop */
+int run_simulation(void *simulate) {
+  int result = ((SDL_ThreadFunction)simulate)(simulation_aux);
+  SDL_AtomicSet(&simulation_done, 1);
+  return result;
+}
+
+void sdl_run_threaded(SDL_ThreadFunction simulate, void *aux) {
+  sdl_open_window();
+  snapshot_lock = SDL_CreateMutex();
+  snapshot_published = SDL_CreateCond();
+  simulation_aux = aux;
+  render_threaded = true;
+
+  SDL_Thread *simulation =
+      SDL_CreateThread(run_simulation, "simulation", (void *)simulate);
+  assert(simulation != NULL);
+  while (!SDL_AtomicGet(&simulation_done)) {
+    SDL_PumpEvents();
+    play_queued_sounds();
+    frame_snapshot_t *frame = snapshot_take_latest(FRAME_WAIT_MS);
+    if (frame != NULL) {
+      draw_snapshot(frame);
+      present_frame();
     }
-    list_free(shape);
-    assert(body != NULL);
   }
+  SDL_WaitThread(simulation, NULL);
+
+  render_threaded = false;
+  SDL_DestroyCond(snapshot_published);
+  SDL_DestroyMutex(snapshot_lock);
+}
+
+void sdl_enable_headless(void) {
+  // The renderer cannot be switched once the window is open
+  assert(window == NULL);
+  headless = true;
+}
+
+bool sdl_is_headless(void) { return headless; }
+
+/** Writes the pixels of a surface as tightly packed RGBA bytes, row by row */
+bool save_raw_frame(SDL_Surface *frame, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  size_t row_size = frame->w * 4;
+  bool written = true;
+  for (int y = 0; y < frame->h && written; y++) {
+    uint8_t *row = (uint8_t *)frame->pixels + y * frame->pitch;
+    written = fwrite(row, 1, row_size, file) == row_size;
+  }
+  return fclose(file) == 0 && written;
+}
+
+bool sdl_save_frame(const char *path, frame_format_t format) {
+  if (headless_frame == NULL) {
+    return false;
+  }
+  if (format == FRAME_PNG) {
+    return IMG_SavePNG(headless_frame, path) == 0;
+  }
+  return save_raw_frame(headless_frame, path);
+}
+
+void sdl_dump_frames(const char *directory, frame_format_t format) {
+  dump_directory = directory;
+  dump_format = format;
+}
+
+size_t sdl_frames_presented(void) { return frames_presented; }
+
+/** Converts a key name from an input script to an SDL key code, or 0 */
+SDL_Keycode parse_key_name(const char *name) {
+  const char *names[] = {"left", "up", "right", "down", "space"};
+  SDL_Keycode keys[] = {SDLK_LEFT, SDLK_UP, SDLK_RIGHT, SDLK_DOWN, SDLK_SPACE};
+  for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++) {
+    if (strcmp(name, names[i]) == 0) {
+      return keys[i];
+    }
+  }
+  // Any other single 7-bit character stands for itself
+  return strlen(name) == 1 && (name[0] & 0x80) == 0 ? name[0] : 0;
+}
+
+/**
+ * Reads one line of an input script into an event.
+ * Returns false if the line is not a valid event.
+ */
+bool parse_input_line(const char *line, scripted_event_t *step) {
+  char action[INPUT_LINE_LENGTH];
+  char name[INPUT_LINE_LENGTH];
+  int x, y;
+  if (sscanf(line, "%zu %s", &step->frame, action) != 2) {
+    return false;
+  }
+  SDL_Event *event = &step->event;
+  *event = (SDL_Event){0};
+  if (strcmp(action, "quit") == 0) {
+    event->type = SDL_QUIT;
+    return true;
+  }
+  bool key_down = strcmp(action, "key_down") == 0;
+  bool key_repeat = strcmp(action, "key_repeat") == 0;
+  if (key_down || key_repeat || strcmp(action, "key_up") == 0) {
+    if (sscanf(line, "%*s %*s %s", name) != 1) {
+      return false;
+    }
+    event->type = key_down || key_repeat ? SDL_KEYDOWN : SDL_KEYUP;
+    event->key.repeat = key_repeat;
+    event->key.keysym.sym = parse_key_name(name);
+    return event->key.keysym.sym != 0;
+  }
+  bool mouse_down = strcmp(action, "mouse_down") == 0;
+  if (mouse_down || strcmp(action, "mouse_up") == 0) {
+    if (sscanf(line, "%*s %*s %s %d %d", name, &x, &y) != 3) {
+      return false;
+    }
+    event->type = mouse_down ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+    event->button.button = strcmp(name, "right") == 0 ? SDL_BUTTON_RIGHT
+                                                      : SDL_BUTTON_LEFT;
+    event->button.x = x;
+    event->button.y = y;
+    return true;
+  }
+  return false;
+}
+
+bool sdl_play_input(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open input script %s\n", path);
+    return false;
+  }
+  size_t capacity = 0;
+  char line[INPUT_LINE_LENGTH];
+  size_t line_number = 0;
+  bool valid = true;
+  while (valid && fgets(line, sizeof(line), file) != NULL) {
+    line_number++;
+    // Skip blank lines and comments
+    size_t start = strspn(line, " \t\r\n");
+    if (line[start] == '\0' || line[start] == '#') {
+      continue;
+    }
+    input_script = grow_array(input_script, &capacity, input_script_length + 1,
+                              sizeof(*input_script));
+    scripted_event_t *step = &input_script[input_script_length];
+    valid = parse_input_line(line, step) &&
+            (input_script_length == 0 ||
+             step->frame >= input_script[input_script_length - 1].frame);
+    if (!valid) {
+      fprintf(stderr, "%s:%zu: invalid input event: %s", path, line_number,
+              line);
+    }
+    input_script_length++;
+  }
+  fclose(file);
+  if (!valid) {
+    free(input_script);
+    input_script = NULL;
+    input_script_length = 0;
+  }
+  return valid;
+}
+
+void sdl_set_random_seed(unsigned seed) {
+  random_seed = seed;
+  random_seed_set = true;
+}
+
+unsigned sdl_random_seed(void) {
+  return random_seed_set ? random_seed : (unsigned)time(NULL);
 }
 
 void sdl_on_key(key_handler_t handler) { key_handler = handler; }
@@ -306,33 +1495,82 @@ void sdl_on_mouse(mouse_handler_t handler) { mouse_handler = handler; }
 void sdl_at_scene(void *scene) { pacman_scene = scene; }
 
 double time_since_last_tick(void) {
-  clock_t now = clock();
-  double difference = last_clock
-                          ? (double)(now - last_clock) / CLOCKS_PER_SEC
-                          : 0.0; // return 0 the first time this is called
-  last_clock = now;
+  // Pretend frames arrive at a steady rate so runs are reproducible
+  if (headless) {
+    return HEADLESS_TICK;
+  }
+  // clock() measures CPU time used, which stops while the process is waiting
+  // for vsync or input, so use the monotonic high-resolution wall clock
+  uint64_t now = SDL_GetPerformanceCounter();
+  double difference =
+      last_counter ? (double)(now - last_counter) / SDL_GetPerformanceFrequency()
+                   : 0.0; // return 0 the first time this is called
+  last_counter = now;
   return difference;
 }
 
 
 
 
+bool sdl_open_audio(void) {
+  if (!audio_open) {
+    audio_open = Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == 0;
+    if (audio_open) {
+      Mix_AllocateChannels(SOUND_CHANNELS);
+    }
+  }
+  return audio_open;
+}
+
+int sdl_load_sound(const char *path) {
+  if (!sdl_open_audio() || num_sounds == MAX_SOUNDS) {
+    return -1;
+  }
+  sound_paths[num_sounds] = malloc(strlen(path) + 1);
+  assert(sound_paths[num_sounds] != NULL);
+  strcpy(sound_paths[num_sounds], path);
+  // Sounds the asset manager is not loading are decoded now, at startup,
+  // instead of by the frame that first plays them
+  bool pending;
+  sounds[num_sounds] = assets_poll_sound(path, &pending);
+  if (sounds[num_sounds] == NULL && !pending) {
+    sounds[num_sounds] = Mix_LoadWAV(path);
+  }
+  return num_sounds++;
+}
+
+void sdl_play_sound(int sound) {
+  if (sound < 0 || sound >= (int)num_sounds) {
+    return;
+  }
+  int tail = SDL_AtomicGet(&sound_queue_tail);
+  int next = (tail + 1) & (SOUND_QUEUE_SIZE - 1);
+  // Drop the sound rather than wait if the queue is full
+  if (next == SDL_AtomicGet(&sound_queue_head)) {
+    return;
+  }
+  sound_queue[tail] = sound;
+  SDL_AtomicSet(&sound_queue_tail, next);
+}
+
 void play_coin() {
-  Mix_PlayMusic(coin, 1);
+  sdl_play_sound(coin);
 }
 
 void sound_init() {
-  Mix_OpenAudio( 44100, MIX_DEFAULT_FORMAT, 2, 2048);
-  coin = Mix_LoadMUS("assets/coin-drop-1(1).wav");
+  if (coin == -1) {
+    coin = sdl_load_sound("assets/coin-drop-1(1).wav");
+  }
 }
 
 void play_splash() {
-  Mix_PlayMusic(splash, 1);
+  sdl_play_sound(splash);
 }
 
 void splash_init() {
-  Mix_OpenAudio( 44100, MIX_DEFAULT_FORMAT, 2, 2048);
-  splash = Mix_LoadMUS("assets/352105__inspectorj__splash-jumping-e.wav");
+  if (splash == -1) {
+    splash = sdl_load_sound("assets/352105__inspectorj__splash-jumping-e.wav");
+  }
 }
 
 SDL_Texture *sdl_make_text(char *string, TTF_Font *font, rgb_color_t color) {
@@ -0,0 +1,223 @@
+#include "water.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Waves may travel at most this fraction of a column per step,
+// which keeps the integration stable
+const double WATER_MAX_COURANT = 0.9;
+// Longer ticks simulate less time than passed, rather than running away
+const size_t WATER_MAX_SUBSTEPS = 64;
+// Pulls the whole surface back toward its rest level (per second squared),
+// so water pushed down by a splash does not stay down forever
+const double WATER_RESTORING = 4;
+// How quickly the surface beside a body takes on the velocity
+// of the water it displaces (per second)
+const double WATER_DRAG_RATE = 4;
+// Heights and velocities smaller than this are rounded to 0. Otherwise, as
+// waves die down they decay into subnormal numbers, which are about 50 times
+// slower to do arithmetic on.
+const double WATER_NEGLIGIBLE = 1e-9;
+
+typedef struct water {
+  double left;
+  double column_width;
+  size_t num_columns;
+  double rest_level;
+  double wave_speed;
+  double damping;
+  // How far each column is above the rest level, and how fast it is rising.
+  // There is an extra column at each end mirroring its neighbor, so the
+  // update needs no special case for the ends and reflects waves off them.
+  double *height;
+  double *velocity;
+} water_t;
+
+water_t *water_init(double left, double right, size_t num_columns,
+                    double rest_level, double wave_speed, double damping) {
+  assert(num_columns > 0 && right > left);
+  water_t *water = malloc(sizeof(water_t));
+  assert(water != NULL);
+  water->left = left;
+  water->column_width = (right - left) / num_columns;
+  water->num_columns = num_columns;
+  water->rest_level = rest_level;
+  water->wave_speed = wave_speed;
+  water->damping = damping;
+  water->height = calloc(num_columns + 2, sizeof(double));
+  water->velocity = calloc(num_columns + 2, sizeof(double));
+  assert(water->height != NULL && water->velocity != NULL);
+  return water;
+}
+
+void water_reset(water_t *water) {
+  for (size_t i = 0; i < water->num_columns + 2; i++) {
+    water->height[i] = 0;
+    water->velocity[i] = 0;
+  }
+}
+
+void water_free(water_t *water) {
+  free(water->height);
+  free(water->velocity);
+  free(water);
+}
+
+/**
+ * Moves the columns [1, n] forward by one small step. Both loops only read
+ * arrays they do not write, so the compiler can vectorize them.
+ */
+void water_step(double *restrict height, double *restrict velocity, size_t n,
+                double stiffness, double damping, double dt) {
+  height[0] = height[1];
+  height[n + 1] = height[n];
+  for (size_t i = 1; i <= n; i++) {
+    double curvature = height[i - 1] + height[i + 1] - 2 * height[i];
+    double acceleration = stiffness * curvature -
+                          WATER_RESTORING * height[i] - damping * velocity[i];
+    velocity[i] += acceleration * dt;
+  }
+  for (size_t i = 1; i <= n; i++) {
+    double v = fabs(velocity[i]) < WATER_NEGLIGIBLE ? 0 : velocity[i];
+    double h = height[i] + v * dt;
+    velocity[i] = v;
+    height[i] = fabs(h) < WATER_NEGLIGIBLE ? 0 : h;
+  }
+}
+
+void water_tick(water_t *water, double dt) {
+  double max_step =
+      WATER_MAX_COURANT * water->column_width / water->wave_speed;
+  size_t substeps = (size_t)ceil(dt / max_step);
+  if (substeps > WATER_MAX_SUBSTEPS) {
+    substeps = WATER_MAX_SUBSTEPS;
+    dt = substeps * max_step;
+  }
+  if (substeps == 0) {
+    return;
+  }
+  double step = dt / substeps;
+  double stiffness = water->wave_speed * water->wave_speed /
+                     (water->column_width * water->column_width);
+  for (size_t i = 0; i < substeps; i++) {
+    water_step(water->height, water->velocity, water->num_columns, stiffness,
+               water->damping, step);
+  }
+}
+
+/** The position of x in columns, where column i is centered on i + 1 */
+double water_column_position(water_t *water, double x) {
+  return (x - water->left) / water->column_width + 0.5;
+}
+
+double water_get_height(water_t *water, double x) {
+  double position = water_column_position(water, x);
+  if (position <= 1) {
+    return water->rest_level + water->height[1];
+  }
+  if (position >= water->num_columns) {
+    return water->rest_level + water->height[water->num_columns];
+  }
+  size_t column = (size_t)position;
+  double fraction = position - column;
+  return water->rest_level + water->height[column] +
+         fraction * (water->height[column + 1] - water->height[column]);
+}
+
+/**
+ * Finds the columns centered between left and right, clamped to the water.
+ * Returns false if there are none.
+ */
+bool water_columns_between(water_t *water, double left, double right,
+                           size_t *first, size_t *last) {
+  double start = ceil(water_column_position(water, left));
+  double end = floor(water_column_position(water, right));
+  start = start < 1 ? 1 : start;
+  end = end > water->num_columns ? water->num_columns : end;
+  if (start > end) {
+    return false;
+  }
+  *first = (size_t)start;
+  *last = (size_t)end;
+  return true;
+}
+
+double water_get_mean_height(water_t *water, double left, double right) {
+  size_t first, last;
+  if (!water_columns_between(water, left, right, &first, &last)) {
+    return water_get_height(water, (left + right) / 2);
+  }
+  double total = 0;
+  for (size_t i = first; i <= last; i++) {
+    total += water->height[i];
+  }
+  return water->rest_level + total / (last - first + 1);
+}
+
+void water_disturb(water_t *water, list_t *polygon, double velocity,
+                   double dt) {
+  size_t size = list_size(polygon);
+  if (size == 0) {
+    return;
+  }
+  vector_t min = {INFINITY, INFINITY};
+  vector_t max = {-INFINITY, -INFINITY};
+  for (size_t i = 0; i < size; i++) {
+    vector_t point = *(vector_t *)list_get(polygon, i);
+    min = (vector_t){fmin(min.x, point.x), fmin(min.y, point.y)};
+    max = (vector_t){fmax(max.x, point.x), fmax(max.y, point.y)};
+  }
+  // Only bodies going in splash. Splashing as bodies come back out as well
+  // feeds a bobbing body's own waves back into its bobbing.
+  double surface = water_get_mean_height(water, min.x, max.x);
+  if (velocity >= 0 || min.y >= surface || max.y <= surface) {
+    return;
+  }
+  // The water the body pushes out of its way rises on either side of it.
+  // Spread over half the body's width on each side, it rises as fast as the
+  // body sinks. The water under the body is left alone: dragging it along
+  // would move the surface the body floats on with the body.
+  double half_width = (max.x - min.x) / 2;
+  double sides[][2] = {{min.x - half_width, min.x}, {max.x, max.x + half_width}};
+  double blend = fmin(WATER_DRAG_RATE * dt, 1);
+  for (size_t side = 0; side < 2; side++) {
+    size_t first, last;
+    if (!water_columns_between(water, sides[side][0], sides[side][1], &first,
+                               &last)) {
+      continue;
+    }
+    for (size_t i = first; i <= last; i++) {
+      water->velocity[i] += blend * (-velocity - water->velocity[i]);
+    }
+  }
+}
+
+list_t *water_get_polygon(water_t *water, double bottom) {
+  size_t n = water->num_columns;
+  list_t *polygon = list_init(n + 4, free);
+  double right = water->left + n * water->column_width;
+  vector_t corners[] = {{water->left, bottom},
+                        {right, bottom},
+                        {right, water->rest_level + water->height[n]}};
+  for (size_t i = 0; i < sizeof(corners) / sizeof(*corners); i++) {
+    vector_t *corner = malloc(sizeof(vector_t));
+    assert(corner != NULL);
+    *corner = corners[i];
+    list_add(polygon, corner);
+  }
+  // The surface, from right to left
+  for (size_t i = n; i >= 1; i--) {
+    vector_t *point = malloc(sizeof(vector_t));
+    assert(point != NULL);
+    *point = (vector_t){water->left + (i - 0.5) * water->column_width,
+                        water->rest_level + water->height[i]};
+    list_add(polygon, point);
+  }
+  vector_t *corner = malloc(sizeof(vector_t));
+  assert(corner != NULL);
+  *corner = (vector_t){water->left, water->rest_level + water->height[1]};
+  list_add(polygon, corner);
+  return polygon;
+}
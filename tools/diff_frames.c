@@ -0,0 +1,143 @@
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+/**
+ * Compares the frames a demo dumped in headless mode against reference frames,
+ * for image regression tests. Every PNG in the reference directory must have a
+ * matching frame of the same name in the output directory.
+ *
+ * Usage: diff_frames <reference directory> <output directory>
+ *
+ * Frames may differ slightly, since SDL builds antialias edges a little
+ * differently; see the tolerances below. For each frame that differs by more,
+ * the differing pixels are drawn in red over a faded copy of the reference
+ * and saved as diff_<name> in the output directory.
+ */
+
+#define MAX_FRAME_PATH 1024
+// Channels that differ by at most this much count as the same
+const int CHANNEL_TOLERANCE = 8;
+// A frame fails if more than this fraction of its pixels differ
+const double MAX_DIFFERENT_FRACTION = 2e-4;
+
+/** Whether a file name ends in .png */
+bool is_png(const char *name) {
+  size_t length = strlen(name);
+  return length > 4 && strcmp(name + length - 4, ".png") == 0;
+}
+
+int select_png(const struct dirent *entry) { return is_png(entry->d_name); }
+
+/** Loads a PNG as RGBA bytes, or returns NULL if it cannot be read */
+SDL_Surface *load_frame(const char *path) {
+  SDL_Surface *loaded = IMG_Load(path);
+  if (loaded == NULL) {
+    return NULL;
+  }
+  SDL_Surface *frame =
+      SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(loaded);
+  return frame;
+}
+
+/**
+ * Counts the pixels that differ between two frames of the same size,
+ * marking them in diff, which starts as a copy of the reference
+ */
+size_t count_different(SDL_Surface *reference, SDL_Surface *output,
+                       SDL_Surface *diff) {
+  size_t different = 0;
+  for (int y = 0; y < reference->h; y++) {
+    uint8_t *expected = (uint8_t *)reference->pixels + y * reference->pitch;
+    uint8_t *actual = (uint8_t *)output->pixels + y * output->pitch;
+    uint8_t *marked = (uint8_t *)diff->pixels + y * diff->pitch;
+    for (int x = 0; x < reference->w * 4; x += 4) {
+      bool same = true;
+      for (int channel = 0; channel < 4; channel++) {
+        if (abs(expected[x + channel] - actual[x + channel]) >
+            CHANNEL_TOLERANCE) {
+          same = false;
+        }
+      }
+      uint8_t *pixel = &marked[x];
+      if (same) {
+        // Fade towards white so the differences stand out
+        for (int channel = 0; channel < 3; channel++) {
+          pixel[channel] = 192 + pixel[channel] / 4;
+        }
+      } else {
+        pixel[0] = 255;
+        pixel[1] = 0;
+        pixel[2] = 0;
+        different++;
+      }
+      pixel[3] = 255;
+    }
+  }
+  return different;
+}
+
+/** Compares one frame, printing and returning whether it matches */
+bool check_frame(const char *reference_dir, const char *output_dir,
+                 const char *name) {
+  char path[MAX_FRAME_PATH];
+  snprintf(path, sizeof(path), "%s/%s", reference_dir, name);
+  SDL_Surface *reference = load_frame(path);
+  snprintf(path, sizeof(path), "%s/%s", output_dir, name);
+  SDL_Surface *output = load_frame(path);
+  bool matches = false;
+  if (reference == NULL || output == NULL) {
+    printf("%s: missing or unreadable\n", name);
+  } else if (reference->w != output->w || reference->h != output->h) {
+    printf("%s: size %dx%d, expected %dx%d\n", name, output->w, output->h,
+           reference->w, reference->h);
+  } else {
+    SDL_Surface *diff =
+        SDL_ConvertSurfaceFormat(reference, SDL_PIXELFORMAT_RGBA32, 0);
+    size_t different = count_different(reference, output, diff);
+    size_t total = (size_t)reference->w * reference->h;
+    matches = different <= MAX_DIFFERENT_FRACTION * total;
+    if (!matches) {
+      snprintf(path, sizeof(path), "%s/diff_%s", output_dir, name);
+      IMG_SavePNG(diff, path);
+      printf("%s: %zu of %zu pixels differ, see %s\n", name, different, total,
+             path);
+    }
+    SDL_FreeSurface(diff);
+  }
+  SDL_FreeSurface(reference);
+  SDL_FreeSurface(output);
+  return matches;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <reference directory> <output directory>\n",
+            argv[0]);
+    return 1;
+  }
+  struct dirent **names;
+  int num_frames = scandir(argv[1], &names, select_png, alphasort);
+  if (num_frames <= 0) {
+    fprintf(stderr, "No reference frames in %s\n", argv[1]);
+    return 1;
+  }
+  SDL_Init(0);
+  int failed = 0;
+  for (int i = 0; i < num_frames; i++) {
+    if (!check_frame(argv[1], argv[2], names[i]->d_name)) {
+      failed++;
+    }
+    free(names[i]);
+  }
+  free(names);
+  SDL_Quit();
+  printf("%s: %d of %d frames match\n", argv[2], num_frames - failed,
+         num_frames);
+  return failed > 0;
+}
@@ -0,0 +1,273 @@
+#include "pack.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+
+/**
+ * Packs the assets listed in a manifest (see assets_preload()) into one file
+ * that the game can memory-map and use without decoding anything.
+ *
+ * Usage: pack_assets <manifest> <pack> [--premultiply]
+ *
+ * Fonts are packed at the point sizes listed after their path in the manifest,
+ * e.g. "assets/verdana.ttf 40 80". Sounds are converted to the format the game
+ * opens the audio device with.
+ */
+
+#define MAX_MANIFEST_LINE 1024
+#define MAX_ENTRIES 256
+// The audio format that sdl_open_audio() asks for
+const int SOUND_FREQUENCY = 44100;
+const int SOUND_CHANNELS = 2;
+
+pack_entry_t entries[MAX_ENTRIES];
+void *entry_data[MAX_ENTRIES];
+size_t num_entries = 0;
+
+/** Adds an entry whose data has been allocated with malloc() */
+void add_entry(pack_entry_t entry, void *data) {
+  assert(num_entries < MAX_ENTRIES);
+  entries[num_entries] = entry;
+  entry_data[num_entries++] = data;
+}
+
+/** Starts an entry for a file */
+pack_entry_t new_entry(const char *path, pack_kind_t kind) {
+  pack_entry_t entry = {.kind = kind};
+  if (strlen(path) >= PACK_PATH_LENGTH) {
+    fprintf(stderr, "Path too long for pack: %s\n", path);
+    exit(1);
+  }
+  strcpy(entry.path, path);
+  return entry;
+}
+
+bool pack_image(const char *path, bool premultiply) {
+  SDL_Surface *loaded = IMG_Load(path);
+  if (loaded == NULL) {
+    return false;
+  }
+  SDL_Surface *image =
+      SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(loaded);
+  if (image == NULL) {
+    return false;
+  }
+
+  pack_entry_t entry = new_entry(path, PACK_IMAGE);
+  entry.width = image->w;
+  entry.height = image->h;
+  entry.size = (uint64_t)image->w * image->h * 4;
+  entry.flags = premultiply ? PACK_PREMULTIPLIED : 0;
+  uint8_t *pixels = malloc(entry.size);
+  assert(pixels != NULL);
+  for (int y = 0; y < image->h; y++) {
+    memcpy(&pixels[y * image->w * 4],
+           (uint8_t *)image->pixels + y * image->pitch, image->w * 4);
+  }
+  if (premultiply) {
+    for (uint64_t i = 0; i < entry.size; i += 4) {
+      uint8_t alpha = pixels[i + 3];
+      for (int channel = 0; channel < 3; channel++) {
+        pixels[i + channel] = (pixels[i + channel] * alpha + 127) / 255;
+      }
+    }
+  }
+  SDL_FreeSurface(image);
+  add_entry(entry, pixels);
+  return true;
+}
+
+bool pack_font(const char *path, int size) {
+  TTF_Font *font = TTF_OpenFont(path, size);
+  if (font == NULL) {
+    return false;
+  }
+
+  // Render each glyph, then lay them out side by side
+  SDL_Surface *glyphs[PACK_NUM_GLYPHS];
+  SDL_Color white = {255, 255, 255, 255};
+  size_t data_size = sizeof(pack_glyph_t) * PACK_NUM_GLYPHS;
+  pack_glyph_t *layout = malloc(data_size);
+  assert(layout != NULL);
+  uint32_t width = 0, height = TTF_FontHeight(font);
+  for (int i = 0; i < PACK_NUM_GLYPHS; i++) {
+    glyphs[i] = TTF_RenderGlyph_Blended(font, PACK_FIRST_GLYPH + i, white);
+    SDL_Surface *converted =
+        glyphs[i] == NULL
+            ? NULL
+            : SDL_ConvertSurfaceFormat(glyphs[i], SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(glyphs[i]);
+    glyphs[i] = converted;
+    int min_x, max_x, min_y, max_y, advance;
+    if (TTF_GlyphMetrics(font, PACK_FIRST_GLYPH + i, &min_x, &max_x, &min_y,
+                         &max_y, &advance) != 0) {
+      advance = 0;
+    }
+    layout[i].x = width;
+    layout[i].width = glyphs[i] == NULL ? 0 : glyphs[i]->w;
+    layout[i].advance = glyphs[i] == NULL ? 0 : advance;
+    width += layout[i].width;
+    if (glyphs[i] != NULL && (uint32_t)glyphs[i]->h > height) {
+      height = glyphs[i]->h;
+    }
+  }
+  TTF_CloseFont(font);
+
+  pack_entry_t entry = new_entry(path, PACK_FONT);
+  entry.width = width;
+  entry.height = height;
+  entry.font_size = size;
+  entry.size = data_size + (uint64_t)width * height;
+  uint8_t *data = calloc(entry.size, 1);
+  assert(data != NULL);
+  memcpy(data, layout, data_size);
+  uint8_t *coverage = data + data_size;
+  for (int i = 0; i < PACK_NUM_GLYPHS; i++) {
+    if (glyphs[i] == NULL) {
+      continue;
+    }
+    for (int y = 0; y < glyphs[i]->h; y++) {
+      uint8_t *row = (uint8_t *)glyphs[i]->pixels + y * glyphs[i]->pitch;
+      for (int x = 0; x < glyphs[i]->w; x++) {
+        coverage[y * width + layout[i].x + x] = row[4 * x + 3];
+      }
+    }
+    SDL_FreeSurface(glyphs[i]);
+  }
+  free(layout);
+  add_entry(entry, data);
+  return true;
+}
+
+bool pack_sound(const char *path) {
+  SDL_AudioSpec spec;
+  uint8_t *samples;
+  uint32_t length;
+  if (SDL_LoadWAV(path, &spec, &samples, &length) == NULL) {
+    return false;
+  }
+
+  SDL_AudioCVT converter;
+  if (SDL_BuildAudioCVT(&converter, spec.format, spec.channels, spec.freq,
+                        AUDIO_S16LSB, SOUND_CHANNELS, SOUND_FREQUENCY) < 0) {
+    SDL_FreeWAV(samples);
+    return false;
+  }
+  converter.len = length;
+  converter.buf = malloc((size_t)length * converter.len_mult);
+  assert(converter.buf != NULL);
+  memcpy(converter.buf, samples, length);
+  SDL_FreeWAV(samples);
+  if (SDL_ConvertAudio(&converter) != 0) {
+    free(converter.buf);
+    return false;
+  }
+
+  pack_entry_t entry = new_entry(path, PACK_SOUND);
+  entry.size = converter.len_cvt;
+  entry.frequency = SOUND_FREQUENCY;
+  entry.channels = SOUND_CHANNELS;
+  add_entry(entry, converter.buf);
+  return true;
+}
+
+/** Packs one line of the manifest. Returns false if anything failed. */
+bool pack_line(char *line, bool premultiply) {
+  char *path = strtok(line, " \t");
+  const char *extension = strrchr(path, '.');
+  if (extension == NULL) {
+    fprintf(stderr, "Skipping %s\n", path);
+    return true;
+  }
+  if (strcasecmp(extension, ".png") == 0) {
+    return pack_image(path, premultiply);
+  }
+  if (strcasecmp(extension, ".wav") == 0) {
+    return pack_sound(path);
+  }
+  if (strcasecmp(extension, ".ttf") == 0) {
+    char *size;
+    bool packed = true;
+    while ((size = strtok(NULL, " \t")) != NULL) {
+      packed = pack_font(path, atoi(size)) && packed;
+    }
+    return packed;
+  }
+  fprintf(stderr, "Skipping %s\n", path);
+  return true;
+}
+
+/** Writes every entry to the pack file */
+bool write_pack(const char *pack_path) {
+  // Lay out the data after the index
+  uint64_t offset = sizeof(pack_header_t) + sizeof(pack_entry_t) * num_entries;
+  for (size_t i = 0; i < num_entries; i++) {
+    offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+    entries[i].offset = offset;
+    offset += entries[i].size;
+  }
+
+  FILE *pack = fopen(pack_path, "wb");
+  if (pack == NULL) {
+    return false;
+  }
+  pack_header_t header = {.version = PACK_VERSION, .num_entries = num_entries};
+  memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+  bool written = fwrite(&header, sizeof(header), 1, pack) == 1 &&
+                 fwrite(entries, sizeof(*entries), num_entries, pack) ==
+                     num_entries;
+  for (size_t i = 0; i < num_entries && written; i++) {
+    written = fseek(pack, entries[i].offset, SEEK_SET) == 0 &&
+              fwrite(entry_data[i], 1, entries[i].size, pack) ==
+                  entries[i].size;
+  }
+  return fclose(pack) == 0 && written;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s <manifest> <pack> [--premultiply]\n", argv[0]);
+    return 1;
+  }
+  bool premultiply = argc > 3 && strcmp(argv[3], "--premultiply") == 0;
+  FILE *manifest = fopen(argv[1], "r");
+  if (manifest == NULL) {
+    fprintf(stderr, "Could not open %s\n", argv[1]);
+    return 1;
+  }
+  SDL_Init(0);
+  TTF_Init();
+
+  char line[MAX_MANIFEST_LINE];
+  bool packed = true;
+  while (fgets(line, sizeof(line), manifest) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    if (!pack_line(line, premultiply)) {
+      fprintf(stderr, "Could not pack %s\n", line);
+      packed = false;
+    }
+  }
+  fclose(manifest);
+
+  if (!packed || !write_pack(argv[2])) {
+    fprintf(stderr, "Could not write %s\n", argv[2]);
+    return 1;
+  }
+  printf("Packed %zu entries into %s\n", num_entries, argv[2]);
+  for (size_t i = 0; i < num_entries; i++) {
+    free(entry_data[i]);
+  }
+  TTF_Quit();
+  SDL_Quit();
+  return 0;
+}